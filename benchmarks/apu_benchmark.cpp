@@ -0,0 +1,61 @@
+#include "benchmark/benchmark.h"
+#include "../src/gameboy/APU/APU.h"
+
+/**
+ * Audio output that discards the samples, at the sample rate given as benchmark argument.
+ */
+class NullAudioOutput : public IAudioOutput {
+public:
+    explicit NullAudioOutput(double sampleRate) : sampleRate{sampleRate} {}
+
+    void writeSamples(const StereoSample* samples, size_t count) override {
+        benchmark::DoNotOptimize(samples);
+    }
+
+    double getSampleRate() const override {
+        return sampleRate;
+    }
+
+private:
+    double sampleRate;
+};
+
+/**
+ * Synthesizes whole frames of sound with all four channels playing, updated as often as the scheduler does.
+ * The square channels play high notes. The second argument sets NR43, 0x00 runs the noise channel at its
+ * highest frequency, the worst case, 0x55 is a more common hiss.
+ */
+static void BM_APU_Frame(benchmark::State& state) {
+    APU apu;
+    NullAudioOutput output(state.range(0));
+    apu.write(NR52_ADDRESS, 0x80);
+    apu.write(NR50_ADDRESS, 0x77);
+    apu.write(NR51_ADDRESS, 0xFF);
+
+    apu.write(NR11_ADDRESS, 0x80);
+    apu.write(NR12_ADDRESS, 0xF0);
+    apu.write(NR13_ADDRESS, 0xC0);
+    apu.write(NR14_ADDRESS, 0x87);
+    apu.write(NR21_ADDRESS, 0x40);
+    apu.write(NR22_ADDRESS, 0xF0);
+    apu.write(NR23_ADDRESS, 0x00);
+    apu.write(NR24_ADDRESS, 0x87);
+    apu.write(NR30_ADDRESS, 0x80);
+    apu.write(NR32_ADDRESS, 0x20);
+    apu.write(NR33_ADDRESS, 0x00);
+    apu.write(NR34_ADDRESS, 0x86);
+    apu.write(NR42_ADDRESS, 0xF0);
+    apu.write(NR43_ADDRESS, state.range(1));
+    apu.write(NR44_ADDRESS, 0x80);
+
+    for (auto _ : state) {
+        // One line is 114 cycles, passing OAM search, drawing and h-blank
+        for (int line = 0; line < 154; line++) {
+            apu.update(20, &output);
+            apu.update(43, &output);
+            apu.update(51, &output);
+        }
+    }
+}
+BENCHMARK(BM_APU_Frame)->Args({44100, 0x00})->Args({48000, 0x00})->Args({44100, 0x55})
+        ->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,99 @@
+#include <memory>
+#include <vector>
+#include "benchmark/benchmark.h"
+#include "../src/gameboy/CPU/CPU.h"
+
+/**
+ * Places program at the start of an empty cartridge, followed by a jump back to the start,
+ * and executes it for as long as the benchmark runs.
+ */
+static void runProgram(benchmark::State& state, const std::vector<uint8_t>& program) {
+    std::shared_ptr<MMU> mmu = std::make_shared<MMU>();
+    std::unique_ptr<CPU> cpu(new CPU(mmu));
+    std::shared_ptr<Cartridge> cartridge = std::make_shared<Cartridge>();
+    mmu->linkDevices(nullptr, nullptr, nullptr, nullptr, cartridge);
+
+    uint16_t addr = 0;
+    for (uint8_t byte : program) {
+        cartridge->writeTest(addr++, byte);
+    }
+    // JP 0x0000
+    cartridge->writeTest(addr++, 0xC3);
+    cartridge->writeTest(addr++, 0x00);
+    cartridge->writeTest(addr, 0x00);
+
+    // Disable boot ROM
+    mmu->write(0xff50, 0x01);
+
+    int64_t cycles = 0;
+    for (auto _ : state) {
+        cycles += cpu->update();
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["cycles"] = benchmark::Counter(static_cast<double>(cycles), benchmark::Counter::kIsRate);
+}
+
+// Register to register loads, arithmetic and logic
+static void BM_CPU_ALU(benchmark::State& state) {
+    runProgram(state, {
+        0x78,       // LD A, B
+        0x80,       // ADD A, B
+        0x04,       // INC B
+        0xA9,       // XOR C
+        0x0D,       // DEC C
+        0x57,       // LD D, A
+        0x92,       // SUB D
+        0xB3,       // OR E
+        0x1C,       // INC E
+        0xFE, 0x42, // CP 0x42
+        0x09,       // ADD HL, BC
+        0x13,       // INC DE
+    });
+}
+BENCHMARK(BM_CPU_ALU);
+
+// Loads and stores to WRAM and HRAM
+static void BM_CPU_Memory(benchmark::State& state) {
+    runProgram(state, {
+        0x21, 0x00, 0xC0, // LD HL, 0xC000
+        0x7E,             // LD A, (HL)
+        0x22,             // LD (HL+), A
+        0x2A,             // LD A, (HL+)
+        0x77,             // LD (HL), A
+        0xE0, 0x80,       // LDH (0x80), A
+        0xF0, 0x80,       // LDH A, (0x80)
+        0xEA, 0x00, 0xD0, // LD (0xD000), A
+        0xFA, 0x00, 0xD0, // LD A, (0xD000)
+        0xC5,             // PUSH BC
+        0xC1,             // POP BC
+    });
+}
+BENCHMARK(BM_CPU_Memory);
+
+// Relative jumps, calls and returns
+static void BM_CPU_Branch(benchmark::State& state) {
+    runProgram(state, {
+        0xAF,             // XOR A
+        0x20, 0x00,       // JR NZ, 0 (not taken)
+        0x28, 0x00,       // JR Z, 0 (taken)
+        0xCD, 0x10, 0x00, // CALL 0x0010
+        0x18, 0x07,       // JR 7, past the subroutine
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0xC9,             // 0x0010: RET
+    });
+}
+BENCHMARK(BM_CPU_Branch);
+
+// 0xCB prefixed bit operations, rotations and shifts
+static void BM_CPU_CB(benchmark::State& state) {
+    runProgram(state, {
+        0xCB, 0x47, // BIT 0, A
+        0xCB, 0xC0, // SET 0, B
+        0xCB, 0x81, // RES 0, C
+        0xCB, 0x37, // SWAP A
+        0xCB, 0x12, // RL D
+        0xCB, 0x3B, // SRL E
+        0xCB, 0x04, // RLC H
+    });
+}
+BENCHMARK(BM_CPU_CB);
@@ -0,0 +1,88 @@
+#include <string>
+#include <vector>
+#include "benchmark/benchmark.h"
+#include "../src/gameboy/GameBoy.h"
+#include "../src/gameboy/RunAhead.h"
+
+/**
+ * Emulates whole frames of a ROM, the argument enables idle loop skipping.
+ * With renderSkipping the frames are emulated without being drawn, as when fast forwarding.
+ */
+static void runRom(benchmark::State& state, const std::string& rom, bool renderSkipping = false) {
+    GameBoy gameBoy;
+    gameBoy.loadRom("", std::string(ROM_DIRECTORY) + "/" + rom);
+    if (!gameBoy.isOn()) {
+        state.SkipWithError("Unable to load ROM");
+        return;
+    }
+    gameBoy.setIdleLoopSkipping(state.range(0));
+    gameBoy.setRenderSkipping(renderSkipping);
+
+    for (auto _ : state) {
+        while (!gameBoy.isReadyToDraw()) {
+            gameBoy.step(nullptr);
+        }
+        gameBoy.confirmDraw();
+    }
+    state.counters["fps"] = benchmark::Counter(static_cast<double>(state.iterations()), benchmark::Counter::kIsRate);
+}
+
+static void BM_Frame_cpu_instrs(benchmark::State& state) {
+    runRom(state, "cpu_instrs/cpu_instrs.gb");
+}
+BENCHMARK(BM_Frame_cpu_instrs)->Arg(0)->Arg(1)->Unit(benchmark::kMicrosecond);
+
+static void BM_Frame_instr_timing(benchmark::State& state) {
+    runRom(state, "instr_timing/instr_timing.gb");
+}
+BENCHMARK(BM_Frame_instr_timing)->Arg(0)->Arg(1)->Unit(benchmark::kMicrosecond);
+
+static void BM_Frame_cpu_instrs_render_skipping(benchmark::State& state) {
+    runRom(state, "cpu_instrs/cpu_instrs.gb", true);
+}
+BENCHMARK(BM_Frame_cpu_instrs_render_skipping)->Arg(0)->Arg(1)->Unit(benchmark::kMicrosecond);
+
+/**
+ * Emulates whole frames of cpu_instrs, each followed by running the argument number of frames ahead and back,
+ * as the application does with run-ahead enabled.
+ */
+static void BM_Frame_cpu_instrs_run_ahead(benchmark::State& state) {
+    GameBoy gameBoy;
+    gameBoy.loadRom("", std::string(ROM_DIRECTORY) + "/cpu_instrs/cpu_instrs.gb");
+    if (!gameBoy.isOn()) {
+        state.SkipWithError("Unable to load ROM");
+        return;
+    }
+    RunAhead runAhead;
+    std::vector<uint8_t> frame(LCD_WIDTH * LCD_HEIGHT);
+
+    for (auto _ : state) {
+        while (!gameBoy.isReadyToDraw()) {
+            gameBoy.step(nullptr);
+        }
+        gameBoy.confirmDraw();
+        runAhead.run(gameBoy, static_cast<int>(state.range(0)), frame.data());
+    }
+    state.counters["fps"] = benchmark::Counter(static_cast<double>(state.iterations()), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_Frame_cpu_instrs_run_ahead)->Arg(1)->Arg(2)->Unit(benchmark::kMicrosecond);
+
+/**
+ * Saves the state of cpu_instrs and restores it, once per iteration each, as run-ahead does every frame.
+ */
+static void BM_SaveState_and_restore(benchmark::State& state) {
+    GameBoy gameBoy;
+    gameBoy.loadRom("", std::string(ROM_DIRECTORY) + "/cpu_instrs/cpu_instrs.gb");
+    if (!gameBoy.isOn()) {
+        state.SkipWithError("Unable to load ROM");
+        return;
+    }
+    std::vector<uint8_t> saveState(gameBoy.saveStateSize());
+
+    for (auto _ : state) {
+        gameBoy.saveState(saveState.data(), saveState.size());
+        gameBoy.loadState(saveState.data(), saveState.size());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * saveState.size()));
+}
+BENCHMARK(BM_SaveState_and_restore)->Unit(benchmark::kMicrosecond);
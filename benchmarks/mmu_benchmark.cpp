@@ -0,0 +1,76 @@
+#include <memory>
+#include "benchmark/benchmark.h"
+#include "../src/gameboy/MMU/MMU.h"
+#include "../src/gameboy/MMU/Timer.h"
+#include "../src/gameboy/PPU/PPU.h"
+#include "../src/gameboy/APU/APU.h"
+#include "../src/gameboy/Joypad.h"
+
+/**
+ * MMU linked to all devices, the same way as in GameBoy.
+ */
+struct LinkedMMU {
+    std::shared_ptr<MMU> mmu = std::make_shared<MMU>();
+    std::shared_ptr<PPU> ppu = std::make_shared<PPU>(mmu);
+    std::shared_ptr<APU> apu = std::make_shared<APU>();
+    std::shared_ptr<Joypad> joypad = std::make_shared<Joypad>(mmu);
+    std::shared_ptr<Timer> timer = std::make_shared<Timer>(mmu);
+    std::shared_ptr<Cartridge> cartridge = std::make_shared<Cartridge>();
+
+    LinkedMMU() {
+        mmu->linkDevices(ppu, apu, joypad, timer, cartridge);
+        // Disable boot ROM
+        mmu->write(0xff50, 0x01);
+    }
+};
+
+// Start and size of each region, selected by the benchmark argument
+static const uint16_t REGION_START[] = {GAME_ROM_START, VRAM_START, xRAM_START, WRAM_START, OAM_START, IO_START, HRAM_START};
+static const uint16_t REGION_SIZE[] = {0x8000, 0x2000, 0x2000, 0x2000, 0xa0, 0x80, 0x7f};
+static const char* REGION_NAME[] = {"ROM", "VRAM", "xRAM", "WRAM", "OAM", "IO", "HRAM"};
+
+static void BM_MMU_Read(benchmark::State& state) {
+    LinkedMMU linked;
+    uint16_t start = REGION_START[state.range(0)];
+    uint16_t size = REGION_SIZE[state.range(0)];
+    state.SetLabel(REGION_NAME[state.range(0)]);
+
+    uint16_t offset = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(linked.mmu->read(start + offset));
+        offset = (offset + 1) % size;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MMU_Read)->DenseRange(0, 6);
+
+static void BM_MMU_Write(benchmark::State& state) {
+    LinkedMMU linked;
+    uint16_t start = REGION_START[state.range(0)];
+    uint16_t size = REGION_SIZE[state.range(0)];
+    state.SetLabel(REGION_NAME[state.range(0)]);
+
+    // Writes to ROM and xRAM go to the MBC, which reports them without a game loaded, and writes to IO
+    // would start DMA transfers and such, so only the memory regions are measured.
+    uint16_t offset = 0;
+    for (auto _ : state) {
+        linked.mmu->write(start + offset, static_cast<uint8_t>(offset));
+        offset = (offset + 1) % size;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MMU_Write)->Arg(1)->Arg(3)->Arg(4)->Arg(6);
+
+// Timer activated at 65,536Hz, updated once per instruction of 4 cycles
+static void BM_Timer_Update(benchmark::State& state) {
+    std::shared_ptr<MMU> mmu = std::make_shared<MMU>();
+    std::shared_ptr<Timer> timer = std::make_shared<Timer>(mmu);
+    mmu->linkDevices(nullptr, nullptr, nullptr, timer, nullptr);
+    timer->write(TIMER_CONTROL, 0b101);
+
+    for (auto _ : state) {
+        timer->update(4);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Timer_Update);
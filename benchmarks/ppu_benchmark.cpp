@@ -0,0 +1,73 @@
+#include <memory>
+#include <vector>
+#include "benchmark/benchmark.h"
+#include "../src/gameboy/PPU/PPU.h"
+#include "../src/gameboy/SaveState.h"
+
+/**
+ * Renders whole frames, line by line, with the LCDC value given as benchmark argument.
+ * VRAM is filled with a pattern and OAM with 40 sprites spread over the screen, so every layer has something to draw.
+ * With restore the memory is saved and loaded back before every frame, as run-ahead and rewind do.
+ */
+static void renderFrames(benchmark::State& state, bool restore) {
+    std::shared_ptr<MMU> mmu = std::make_shared<MMU>();
+    std::shared_ptr<PPU> ppu = std::make_shared<PPU>(mmu);
+    mmu->linkDevices(ppu, nullptr, nullptr, nullptr, nullptr);
+
+    // Disable boot ROM
+    mmu->write(0xff50, 0x01);
+
+    for (uint16_t addr = VRAM_START; addr <= VRAM_END; addr++) {
+        mmu->write(addr, static_cast<uint8_t>(addr * 7));
+    }
+    for (uint8_t i = 0; i < 40; i++) {
+        mmu->write(OAM_START + i * 4, 16 + (i * 11) % LCD_HEIGHT);
+        mmu->write(OAM_START + i * 4 + 1, 8 + (i * 17) % LCD_WIDTH);
+        mmu->write(OAM_START + i * 4 + 2, i);
+        mmu->write(OAM_START + i * 4 + 3, (i % 4) << 5);
+    }
+    mmu->write(BGP_ADDRESS, 0xE4);
+    mmu->write(OBP0_ADDRESS, 0xE4);
+    mmu->write(OBP1_ADDRESS, 0x1B);
+    mmu->write(WY_ADDRESS, 40);
+    mmu->write(WX_ADDRESS, 47);
+    mmu->write(LCDC_ADDRESS, static_cast<uint8_t>(state.range(0)));
+
+    StateWriter counter(nullptr, 0);
+    mmu->saveState(counter);
+    std::vector<uint8_t> memory(counter.getSize());
+
+    for (auto _ : state) {
+        if (restore) {
+            StateWriter writer(memory.data(), memory.size());
+            mmu->saveState(writer);
+            StateReader reader(memory.data(), memory.size());
+            mmu->loadState(reader);
+        }
+        // One line is 114 cycles, passing OAM search, drawing and h-blank
+        for (int line = 0; line < LCD_HEIGHT + 10; line++) {
+            ppu->update(20);
+            ppu->update(43);
+            ppu->update(51);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * (LCD_HEIGHT + 10));
+}
+
+static void BM_PPU_Frame(benchmark::State& state) {
+    renderFrames(state, false);
+}
+BENCHMARK(BM_PPU_Frame)
+    ->Arg(0x91)  // Background
+    ->Arg(0xB1)  // Background and window
+    ->Arg(0x93)  // Background and sprites
+    ->Arg(0xB7)  // Background, window and 8x16 sprites
+    ->Arg(0x81); // LCD on, nothing displayed
+
+/**
+ * Measures what loading a state adds to the next frame, which only decodes the tiles the state changed.
+ */
+static void BM_PPU_Frame_after_restore(benchmark::State& state) {
+    renderFrames(state, true);
+}
+BENCHMARK(BM_PPU_Frame_after_restore)->Arg(0x91)->Arg(0xB7);
@@ -1,19 +1,25 @@
-
 #include "AudioController.h"
 
+#include <algorithm> // min, max
+
 AudioController::AudioController(AppSettings& settings):
-    settings{settings}
+    device{nullptr}, context{nullptr}, settings{settings}, initialized{false}, source{0}, freeBufferCount{0},
+    sampleRate{AUDIO_SAMPLE_RATE}, averageQueuedSamples{AUDIO_TARGET_SAMPLES}
 {
     init();
 }
 
 AudioController::~AudioController() {
-    alDeleteSources(4, sources);
-    alDeleteBuffers(4, buffers);
-    alcMakeContextCurrent(context);
-    alcDestroyContext(context);
-
-    if(!alcCloseDevice(device))
+    if (initialized) {
+        alSourceStop(source);
+        alDeleteSources(1, &source);
+        alDeleteBuffers(AUDIO_BUFFER_AMOUNT, buffers.data());
+    }
+    if (context) {
+        alcMakeContextCurrent(nullptr);
+        alcDestroyContext(context);
+    }
+    if(device && !alcCloseDevice(device))
         std::cerr << "Field to close device\n";
 }
 
@@ -42,185 +48,97 @@ void AudioController::init() {
         return;
     }
 
-    alGenBuffers(1, &tmpBuffer);
-    alGenBuffers(N_SOURCES, buffers);
-    alGenSources(N_SOURCES, sources);
-
-    for(auto i = 0; i < N_SOURCES; i++) {
-        alSourcef(sources[i], AL_PITCH, 1);
-        alSourcef(sources[i], AL_GAIN, 1.0f);
-        alSource3f(sources[i], AL_POSITION, 0, 0, 0);
-        alSource3f(sources[i], AL_VELOCITY, 0, 0, 0);
-        alSourcei(sources[i], AL_LOOPING, AL_FALSE);
-    }
+    alGenBuffers(AUDIO_BUFFER_AMOUNT, buffers.data());
+    alGenSources(1, &source);
 
-    const unsigned char dutyPatterns[4] = {0x01, 0x81, 0x87, 0x7E};
-    const int stepLength = SQUARE_SAMPLE_RATE / 8;
-    unsigned char value;
-    int j;
-
-    for(int i = 0; i < 4; i++) {
-        j = 0;
-        while(j < SQUARE_SAMPLE_RATE) {
-            value = ((dutyPatterns[i] >> (7 - (j / stepLength))) & 1) * 0xFF;
-            do {
-                duties[i][j] = value;
-                j++;
-            } while(j % stepLength);
-        }
-    }
-
-    uint16_t lfsr7 = 0x7F;
-    uint16_t lfsr15 = 0x7FFF;
-    auto xor_res = 0;
-    for(auto i = 0; i < LFSR15_BUFFER_SIZE; i++) {
-        xor_res = (lfsr15 ^ (lfsr15 >> 1)) & 1;
-        lfsr15 >>= 1;
-        lfsr15 |= xor_res << 14;
-        noise15bit[i] = lfsr15 & 1 ? 0 : (char) 0xFF;
-    }
-
-    for(auto i = 0; i < LFSR7_BUFFER_SIZE; i++) {
-        xor_res = (lfsr7 ^ (lfsr7 >> 1)) & 1;
-        lfsr7 >>= 1;
-        lfsr7 |= xor_res << 6;
-        noise7bit[i] = lfsr7 & 1 ? 0 : (char)0xFF;
-    }
-}
-
-void swap(ALuint *a, ALuint *b) {
-    auto tmp = *a;
-    *a = *b;
-    *b = tmp;
-}
+    alSourcef(source, AL_PITCH, 1);
+    alSourcef(source, AL_GAIN, settings.masterVolume);
+    alSource3f(source, AL_POSITION, 0, 0, 0);
+    alSource3f(source, AL_VELOCITY, 0, 0, 0);
+    alSourcei(source, AL_LOOPING, AL_FALSE);
 
-void AudioController::playSound(int source, uint8_t *soundData, int size, int sampleRate, float volume) {
-    alBufferData(tmpBuffer, AL_FORMAT_MONO8, soundData, size, sampleRate);
-    alSourcef(sources[source], AL_GAIN, volume);
-    alSourceStop(sources[source]);
-    alSourcei(sources[source], AL_BUFFER, tmpBuffer);
-    alSourcePlay(sources[source]);
-    alSourcei(sources[source], AL_LOOPING, 1);
-    swap(&tmpBuffer, buffers + source);
+    freeBuffers = buffers;
+    freeBufferCount = AUDIO_BUFFER_AMOUNT;
+    initialized = true;
 }
 
-/**
- * Plays a square wave sound until stopped
- * @param source index (0 to 3)
- * @param duty (0 = 12.5%, 1 = 25%, 2 = 50%, 3 = 75%)
- * @param frequency the frequency of the sound
- */
-void AudioController::playSquare(int source, char duty, ALsizei frequency, float volume) {
-    //alSourcei(sources[source], AL_BUFFER, 0);
-    alBufferData(
-        tmpBuffer,
-        AL_FORMAT_MONO8,
-        duties[duty],
-        SQUARE_SAMPLE_RATE,
-        SQUARE_SAMPLE_RATE * frequency);
-    alSourcef(sources[source], AL_GAIN, volume);
-    alSourceStop(sources[source]);
-    alSourcei(sources[source], AL_BUFFER, tmpBuffer);
-    alSourcePlay(sources[source]);
-    alSourcei(sources[source], AL_LOOPING, 1);
-    swap(&tmpBuffer, buffers + source);
+void AudioController::writeSamples(const StereoSample *samples, size_t count) {
+    this->samples.push(samples, count);
 }
 
-/**
- * Plays a square wave sound until stopped
- * @param source index (0 to 3)
- * @param duty (0 = 12.5%, 1 = 25%, 2 = 50%, 3 = 75%)
- * @param frequency the values read from the F bits
- */
-void AudioController::playGBSquare(int source, char duty, unsigned short frequency, float volume) {
-    this->playSquare(source, duty, 131072.0/(2048 - frequency), volume);
+double AudioController::getSampleRate() const {
+    return sampleRate;
 }
 
-void AudioController::stopSource(int source) {
-    alSourceRewind(sources[source]);
+void AudioController::updateSampleRate() {
+    // The queue changes in steps of whole buffers, so it is averaged over several frames
+    averageQueuedSamples += (getQueuedSamples() - averageQueuedSamples) * AUDIO_AVERAGE_WEIGHT;
+    double deviation = (AUDIO_TARGET_SAMPLES - averageQueuedSamples) / AUDIO_TARGET_SAMPLES;
+    deviation = std::max(-1.0, std::min(deviation, 1.0));
+    sampleRate = AUDIO_SAMPLE_RATE * (1 + AUDIO_MAX_RATE_ADJUSTMENT * deviation);
 }
 
-void AudioController::playWave(int source, std::array<uint8_t, 16> waveForm, ALsizei frequency, float volume) {
-    auto wave = new char[32];
-    uint8_t form;
-    for(auto i = 0; i < 16; i++) {
-        form = waveForm[i] & 0xF;
-        wave[i*2] = form * form;
-        form = (waveForm[i] & 0xF0) >> 4;
-        wave[i*2+1] = form * form;
+size_t AudioController::getQueuedSamples() const {
+    if (!initialized) {
+        return 0;
     }
-
-    alBufferData(
-            tmpBuffer,
-            AL_FORMAT_MONO8,
-            wave,
-            32,
-            32 * frequency);
-    alSourcef(sources[source], AL_GAIN, volume);
-    alSourceStop(sources[source]);
-    alSourcei(sources[source], AL_BUFFER, tmpBuffer);
-    alSourcePlay(sources[source]);
-    alSourcei(sources[source], AL_LOOPING, 1);
-
-    delete[] wave;
-    swap(&tmpBuffer, buffers + source);
-}
-
-void AudioController::playGBWave(int source, std::array<uint8_t, 16> waveForm, ALsizei frequency, float volume) {
-    this->playWave(source, waveForm, 131072.0/(2048 - frequency), volume);
+    ALint queued = 0;
+    ALint sourceState = AL_INITIAL;
+    alGetSourcei(source, AL_BUFFERS_QUEUED, &queued);
+    alGetSourcei(source, AL_SOURCE_STATE, &sourceState);
+    if (sourceState != AL_PLAYING && sourceState != AL_PAUSED) {
+        // A stopped source has played its processed buffers and none of the others
+        ALint processed = 0;
+        alGetSourcei(source, AL_BUFFERS_PROCESSED, &processed);
+        return (queued - processed) * AUDIO_BUFFER_SIZE;
+    }
+    // The offset is counted from the first buffer queued, including processed buffers not unqueued yet
+    ALint offset = 0;
+    alGetSourcei(source, AL_SAMPLE_OFFSET, &offset);
+    return std::max(0, queued * AUDIO_BUFFER_SIZE - offset);
 }
 
-void AudioController::playNoise(int source, bool is_7_bit_mode, ALsizei frequency, float volume) {
-    if(is_7_bit_mode) {
-        playSound(source, noise7bit, LFSR7_BUFFER_SIZE, frequency, volume);
-    } else {
-        playSound(source, noise15bit, LFSR15_BUFFER_SIZE, frequency, volume);
+void AudioController::streamSamples() {
+    if (!initialized) {
+        // Nothing can be played, but the queue should not fill up
+        while (samples.pop(bufferSamples.data(), bufferSamples.size())) {}
+        return;
+    }
+    alSourcef(source, AL_GAIN, settings.masterVolume);
+    unqueueProcessedBuffers();
+
+    while (freeBufferCount > 0 && samples.size() >= AUDIO_BUFFER_SIZE) {
+        samples.pop(bufferSamples.data(), AUDIO_BUFFER_SIZE);
+        ALuint buffer = freeBuffers[--freeBufferCount];
+        alBufferData(buffer, AL_FORMAT_STEREO16, bufferSamples.data(), AUDIO_BUFFER_SIZE * sizeof(StereoSample),
+                     AUDIO_SAMPLE_RATE);
+        alSourceQueueBuffers(source, 1, &buffer);
     }
-}
 
-void AudioController::setVolume(int source, float volume) {
-    alSourcef(sources[source], AL_GAIN, volume * settings.masterVolume);
+    // The source stops by itself when it runs out of buffers, it is restarted once a few are queued again
+    ALint sourceState;
+    alGetSourcei(source, AL_SOURCE_STATE, &sourceState);
+    if (sourceState != AL_PLAYING && AUDIO_BUFFER_AMOUNT - freeBufferCount >= AUDIO_START_BUFFERS) {
+        alSourcePlay(source);
+    }
 }
 
 void AudioController::stopSound() {
-    for(int i=0;i<N_SOURCES;i++){
-        stopSource(i);
+    while (samples.pop(bufferSamples.data(), bufferSamples.size())) {}
+    if (!initialized) {
+        return;
     }
+    // Every buffer is processed once the source is stopped
+    alSourceStop(source);
+    unqueueProcessedBuffers();
 }
 
-void AudioController::stepSound(uint8_t readyToPlay, APUState *state) {
-    //1st square
-    if (readyToPlay & 1) {
-        if (state->enableSquareA) {
-            playGBSquare(0, state->dutySquareA, state->frequencySquareA, state->volumeSquareA * settings.masterVolume);
-        } else {
-            stopSource(0);
-        }
-    }
-
-    //2nd square
-    if (readyToPlay & 2) {
-        if (state->enableSquareB) {
-            playGBSquare(1, state->dutySquareB, state->frequencySquareB, state->volumeSquareB * settings.masterVolume);
-        } else {
-            stopSource(1);
-        }
-    }
-
-    //Wave
-    if (readyToPlay & 4) {
-        if (state->enableWave) {
-            playGBWave(2, state->waveform, state->frequencyWave, state->volumeWave * settings.masterVolume);
-        } else {
-            stopSource(2);
-        }
-    }
-    //Noise
-    if(readyToPlay & 8) {
-        if(state->enableNoise) {
-            playNoise(3, state->is7BitMode, state->frequencyNoise, state->volumeNoise * settings.masterVolume);
-        } else {
-            stopSource(3);
-        }
+void AudioController::unqueueProcessedBuffers() {
+    ALint processed = 0;
+    alGetSourcei(source, AL_BUFFERS_PROCESSED, &processed);
+    while (processed-- > 0) {
+        ALuint buffer;
+        alSourceUnqueueBuffers(source, 1, &buffer);
+        freeBuffers[freeBufferCount++] = buffer;
     }
 }
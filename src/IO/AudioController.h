@@ -4,20 +4,30 @@
 #include <AL/al.h>
 #include <iostream>
 #include <array>
-#include "../gameboy/APU/IVolumeController.h"
-#include "../gameboy/APU/APUState.h"
+#include "../gameboy/APU/IAudioOutput.h"
 #include "../application/AppSettings.h"
+#include "../helpers/SPSCQueue.h"
 
+#define AUDIO_SAMPLE_RATE       44100
+#define AUDIO_QUEUE_SIZE        8192    //Samples waiting to be streamed, about 190 ms
+#define AUDIO_BUFFER_SIZE       512     //Samples per OpenAL buffer, about 12 ms
+#define AUDIO_BUFFER_AMOUNT     8
+#define AUDIO_START_BUFFERS     3       //Buffers queued before playback starts, or restarts after running out
+#define AUDIO_TARGET_SAMPLES    2048    //Samples kept queued while playing, about 46 ms
+#define AUDIO_MAX_RATE_ADJUSTMENT 0.005 //Largest relative change of the sample rate, too small to hear
+#define AUDIO_AVERAGE_WEIGHT    0.0625  //Weight of the latest frame in the average of queued samples
 
 /**
- * The AudioController is what plays all sounds from the emulator. It supports a set of functions which can play
- * sounds similar to the original Game Boy
+ * The AudioController is what plays all sounds from the emulator. The samples synthesized by the APU are
+ * written to a queue by the emulation thread, which streams them from it to an OpenAL source through a small
+ * set of queued buffers after every frame, so the device does not depend on the main loop being responsive.
+ * The clock of the audio device never runs at exactly the emulated rate, so the sample rate asked of the APU
+ * is adjusted slightly to keep the amount of queued samples steady.
  */
-class AudioController : public IVolumeController {
+class AudioController : public IAudioOutput {
 public:
     /**
-     * Connects to audio device, and creates buffers and sources.
-     * Also creates audio data buffers used in playSquare and playNoise.
+     * Connects to audio device, and creates buffers and the source the samples are streamed to.
      *
      * @param settings audio volume strategy, givens the master volume of the application
      */
@@ -29,91 +39,74 @@ public:
     ~AudioController();
 
     /**
-     * Plays any sound with the given audio data
+     * Adds samples to the queue of samples to play. Samples that do not fit in the queue are dropped.
+     * Only to be called from the thread running the emulation.
      *
-     * @param source is a value from 0 to 3, specifies which source to use
-     * @param soundData has all the audio samples which will be played, 0x00 == -1 .. 0xFF == 1
-     * @param size is the length of the soundData array
-     * @param sampleRate is how many samples to play per second
-     * @param volume specifies a value from 0.0 to 1.0, i.e no sound to max volume
+     * @param samples stereo samples at AUDIO_SAMPLE_RATE
+     * @param count number of samples
      */
-    void playSound(int source, uint8_t *soundData, int size, int sampleRate, float volume);
+    void writeSamples(const StereoSample* samples, size_t count) override;
 
     /**
-     * Plays square wave according to specified frequency and duty
-     *
-     * @param source is a value from 0 to 3, specifies which source to use
-     * @param duty defines waveform (0b00 == _______‾, 0b01 == ‾______‾, 0b10 == ‾____‾‾‾, 0b11 == _‾‾‾‾‾‾_)
-     * @param frequency value read from the NRx4 and NRx3 registers in the Game Boy
-     * @param volume specifies a value from 0.0 to 1.0, i.e no sound to max volume
+     * @return the sample rate the samples should be written at, the sample rate of the audio device adjusted
+     * by updateSampleRate
      */
-    void playGBSquare(int source, char duty, unsigned short frequency, float volume);
+    double getSampleRate() const override;
 
     /**
-     * Plays audio with custom waveform
-     *
-     * @param source is a value from 0 to 3, specifies which source to use
-     * @param waveForm is 32 4-bit samples, 0x0 == -1, 0xF == 1
-     * @param frequency value read from the NRx4 and NRx3 registers in the Game Boy
-     * @param volume specifies a value from 0.0 to 1.0, i.e no sound to max volume
+     * Adjusts the sample rate returned by getSampleRate by at most AUDIO_MAX_RATE_ADJUSTMENT, up when fewer than
+     * AUDIO_TARGET_SAMPLES are queued on the device on average and down when more are. Only to be called from
+     * the thread calling writeSamples, once per frame.
      */
-    void playGBWave(int source, std::array<uint8_t, 16> waveForm, ALsizei frequency, float volume);
+    void updateSampleRate();
 
     /**
-     * Plays noise audio for drums, base or other effects
-     * 7 bit LFSR results in a loop after 0x7F samples and 15 bit LFSR loops after 0x7FFF samples. 7 bit LFSR
-     * therefore make a more instrument-like sound.
-     *
-     * @param source is a value from 0 to 3, specifies which source to use
-     * @param is_7_bit_mode if true the LFSR is 7 bits long, otherwise it is 15 bits
-     * @param frequency calculated from the NR43 register
-     * @param volume specifies a value from 0.0 to 1.0, i.e no sound to max volume
+     * Samples written but not streamed yet are not counted, as they do not keep the device playing.
+     * @return the number of samples queued on the audio device that have not been played yet
      */
-    void playNoise(int source, bool is_7_bit_mode, ALsizei frequency, float volume);
+    size_t getQueuedSamples() const;
 
     /**
-     * Sets the volume of a specific source
-     *
-     * @param source is a value from 0 to 3, specifies which source to use
-     * @param volume specifies a value from 0.0 to 1.0, i.e no sound to max volume
+     * @return whether samples are played, false if no audio device could be opened
      */
-    void setVolume(int source, float volume) override;
+    bool isActive() const {
+        return initialized;
+    }
 
     /**
-     * Stops all sources from playing
+     * Moves queued samples to OpenAL buffers that have finished playing, and starts playing once enough
+     * samples are buffered. Needs to be called regularly, at least once per frame, from the thread calling
+     * writeSamples.
      */
-    void stopSound();
+    void streamSamples();
 
     /**
-     * Updates all audio sources according to the new APU state
-     *
-     * @param readyToPlay what sources should update their sound, bit x -> source x should change sound
-     * @param state the new audio state which shows what source should be played with what settings
+     * Stops playing and drops all samples that have not been played. Not to be called at the same time as
+     * writeSamples or streamSamples.
      */
-    void stepSound(uint8_t readyToPlay, APUState *state);
+    void stopSound();
 
 private:
-    const static int N_SOURCES = 4;
-    const static int SQUARE_SAMPLE_RATE = 32;
-    const static int LFSR7_BUFFER_SIZE = 0x7F;
-    const static int LFSR15_BUFFER_SIZE = 0x7FFF;
+    typedef SPSCQueue<StereoSample, AUDIO_QUEUE_SIZE> SampleQueue;
 
     ALCdevice* device;
     ALCcontext* context;
     AppSettings& settings;
+    bool initialized;
+
+    ALuint source;
+    std::array<ALuint, AUDIO_BUFFER_AMOUNT> buffers{};
+    // Buffers not queued on the source, the first freeBufferCount are valid
+    std::array<ALuint, AUDIO_BUFFER_AMOUNT> freeBuffers{};
+    int freeBufferCount;
 
-    ALuint tmpBuffer;
-    ALuint buffers[N_SOURCES];
-    ALuint sources[N_SOURCES];
+    // Only used by the thread calling writeSamples
+    double sampleRate;
+    double averageQueuedSamples;
 
-    unsigned char noise15bit[LFSR15_BUFFER_SIZE];
-    unsigned char noise7bit[LFSR7_BUFFER_SIZE];
-    unsigned char duties[N_SOURCES][SQUARE_SAMPLE_RATE];
+    SampleQueue samples;
+    std::array<StereoSample, AUDIO_BUFFER_SIZE> bufferSamples{};
 
     void init();
-    void playSquare(int source, char duty, ALsizei frequency, float volume);
-    void stopSource(int source);
-    void playWave(int source, std::array<uint8_t, 16> waveForm, ALsizei frequency, float volume);
+    void unqueueProcessedBuffers();
 };
-
-
@@ -1,9 +1,13 @@
 #include "Controller.h"
 
-Controller::Controller(AppSettings& settings, GuiView& guiView, GameBoy& gameBoy):
-    settings{settings}, guiView{guiView}, gameBoy{gameBoy}
+#include <iostream>
+
+Controller::Controller(AppSettings& settings, GuiView& guiView, InputQueue& inputQueue):
+    settings{settings}, guiView{guiView}, inputQueue{inputQueue}
 {
     savedEmulationSpeed = settings.emulationSpeedMultiplier;
+    rewinding = false;
+    recordingMovie = false;
 }
 
 State Controller::handleSDLEvents(State state) {
@@ -34,6 +38,12 @@ State Controller::handleSDLEvents(State state) {
                     savedEmulationSpeed = settings.emulationSpeedMultiplier;
                     settings.emulationSpeedMultiplier = MAX_EMULATION_SPEED_FLOAT;
                 }
+                if (key == settings.keyBinds.rewind.keyVal) {
+                    rewinding = true;
+                }
+                if (key == settings.keyBinds.recordMovie.keyVal && state == State::EMULATION) {
+                    recordingMovie = !recordingMovie;
+                }
                 if (state == State::EMULATION) {
                     handleEmulatorInputPress(key);
                 }
@@ -43,6 +53,9 @@ State Controller::handleSDLEvents(State state) {
                 if (key == settings.keyBinds.turboMode.keyVal) {
                     settings.emulationSpeedMultiplier = savedEmulationSpeed;
                 }
+                if (key == settings.keyBinds.rewind.keyVal) {
+                    rewinding = false;
+                }
                 if (state == State::EMULATION) {
                     handleEmulatorInputRelease(key);
                 }
@@ -52,47 +65,61 @@ State Controller::handleSDLEvents(State state) {
     return state;
 }
 
+bool Controller::isRewinding() const {
+    return rewinding;
+}
+
+bool Controller::isRecordingMovie() const {
+    return recordingMovie;
+}
+
 void Controller::handleEmulatorInputPress(SDL_Keycode key) {
     // Left and right can not be pressed simultaneously, the same goes for up and down!
     if (key == settings.keyBinds.left.keyVal) {
-        gameBoy.joypadInput(JOYPAD_RIGHT, JOYPAD_RELEASE);
-        gameBoy.joypadInput(JOYPAD_LEFT, JOYPAD_PRESS);
+        joypadInput(JOYPAD_RIGHT, JOYPAD_RELEASE);
+        joypadInput(JOYPAD_LEFT, JOYPAD_PRESS);
     } else if (key == settings.keyBinds.right.keyVal) {
-        gameBoy.joypadInput(JOYPAD_LEFT, JOYPAD_RELEASE);
-        gameBoy.joypadInput(JOYPAD_RIGHT, JOYPAD_PRESS);
+        joypadInput(JOYPAD_LEFT, JOYPAD_RELEASE);
+        joypadInput(JOYPAD_RIGHT, JOYPAD_PRESS);
     } else if (key == settings.keyBinds.up.keyVal) {
-        gameBoy.joypadInput(JOYPAD_DOWN, JOYPAD_RELEASE);
-        gameBoy.joypadInput(JOYPAD_UP, JOYPAD_PRESS);
+        joypadInput(JOYPAD_DOWN, JOYPAD_RELEASE);
+        joypadInput(JOYPAD_UP, JOYPAD_PRESS);
     } else if (key == settings.keyBinds.down.keyVal) {
-        gameBoy.joypadInput(JOYPAD_UP, JOYPAD_RELEASE);
-        gameBoy.joypadInput(JOYPAD_DOWN, JOYPAD_PRESS);
+        joypadInput(JOYPAD_UP, JOYPAD_RELEASE);
+        joypadInput(JOYPAD_DOWN, JOYPAD_PRESS);
     } else if (key == settings.keyBinds.a.keyVal) {
-        gameBoy.joypadInput(JOYPAD_A, JOYPAD_PRESS);
+        joypadInput(JOYPAD_A, JOYPAD_PRESS);
     } else if (key == settings.keyBinds.b.keyVal) {
-        gameBoy.joypadInput(JOYPAD_B, JOYPAD_PRESS);
+        joypadInput(JOYPAD_B, JOYPAD_PRESS);
     } else if (key == settings.keyBinds.start.keyVal) {
-        gameBoy.joypadInput(JOYPAD_START, JOYPAD_PRESS);
+        joypadInput(JOYPAD_START, JOYPAD_PRESS);
     } else if (key == settings.keyBinds.select.keyVal) {
-        gameBoy.joypadInput(JOYPAD_SELECT, JOYPAD_PRESS);
+        joypadInput(JOYPAD_SELECT, JOYPAD_PRESS);
     }
 }
 
 void Controller::handleEmulatorInputRelease(SDL_Keycode key) {
     if (key == settings.keyBinds.left.keyVal) {
-        gameBoy.joypadInput(JOYPAD_LEFT, JOYPAD_RELEASE);
+        joypadInput(JOYPAD_LEFT, JOYPAD_RELEASE);
     } else if (key == settings.keyBinds.right.keyVal) {
-        gameBoy.joypadInput(JOYPAD_RIGHT, JOYPAD_RELEASE);
+        joypadInput(JOYPAD_RIGHT, JOYPAD_RELEASE);
     } else if (key == settings.keyBinds.up.keyVal) {
-        gameBoy.joypadInput(JOYPAD_UP, JOYPAD_RELEASE);
+        joypadInput(JOYPAD_UP, JOYPAD_RELEASE);
     } else if (key == settings.keyBinds.down.keyVal) {
-        gameBoy.joypadInput(JOYPAD_DOWN, JOYPAD_RELEASE);
+        joypadInput(JOYPAD_DOWN, JOYPAD_RELEASE);
     } else if (key == settings.keyBinds.a.keyVal) {
-        gameBoy.joypadInput(JOYPAD_A, JOYPAD_RELEASE);
+        joypadInput(JOYPAD_A, JOYPAD_RELEASE);
     } else if (key == settings.keyBinds.b.keyVal) {
-        gameBoy.joypadInput(JOYPAD_B, JOYPAD_RELEASE);
+        joypadInput(JOYPAD_B, JOYPAD_RELEASE);
     } else if (key == settings.keyBinds.start.keyVal) {
-        gameBoy.joypadInput(JOYPAD_START, JOYPAD_RELEASE);
+        joypadInput(JOYPAD_START, JOYPAD_RELEASE);
     } else if (key == settings.keyBinds.select.keyVal) {
-        gameBoy.joypadInput(JOYPAD_SELECT, JOYPAD_RELEASE);
+        joypadInput(JOYPAD_SELECT, JOYPAD_RELEASE);
+    }
+}
+
+void Controller::joypadInput(uint8_t key, uint8_t action) {
+    if (!inputQueue.push({key, action})) {
+        std::cerr << "Input queue is full, input is lost" << std::endl;
     }
-}
\ No newline at end of file
+}
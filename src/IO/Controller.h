@@ -4,15 +4,30 @@
 
 #include "../application/State.h" // State
 #include "../application/AppSettings.h" // Key binds
-#include "../gameboy/GameBoy.h" // Communication with game boy joypad and joypad constants
+#include "../gameboy/GameBoy.h" // Joypad constants
+#include "../helpers/SPSCQueue.h"
 
 #include "GuiView.h"
+
+#define INPUT_QUEUE_SIZE 64
+
+/**
+ * A joypad button being pressed or released, passed from the event thread to the emulation thread.
+ */
+struct JoypadEvent {
+    uint8_t key;
+    uint8_t action;
+};
+
+typedef SPSCQueue<JoypadEvent, INPUT_QUEUE_SIZE> InputQueue;
+
 /**
  * Application delegates the sdl event handling to this class.
+ * Joypad input is sent to the emulation thread through a queue.
  */
 class Controller {
 public:
-    explicit Controller(AppSettings& settings, GuiView& guiView, GameBoy& gameBoy);
+    explicit Controller(AppSettings& settings, GuiView& guiView, InputQueue& inputQueue);
 
     /**
     * Handles SDL Events including keyboard input.
@@ -23,11 +38,24 @@ public:
     */
     State handleSDLEvents(State state);
 
+    /**
+     * Returns whether the rewind key is held down, the emulation should then step backwards.
+     */
+    bool isRewinding() const;
+
+    /**
+     * Returns whether an input movie should be recorded, toggled by the record movie key.
+     */
+    bool isRecordingMovie() const;
+
 private:
     void handleEmulatorInputPress(SDL_Keycode key);
     void handleEmulatorInputRelease(SDL_Keycode key);
+    void joypadInput(uint8_t key, uint8_t action);
     AppSettings& settings;
     GuiView& guiView;
-    GameBoy& gameBoy;
+    InputQueue& inputQueue;
     float savedEmulationSpeed;
+    bool rewinding;
+    bool recordingMovie;
 };
\ No newline at end of file
@@ -348,6 +348,7 @@ void GuiView::showToolbar() {
         }
         if (ImGui::BeginMenu("Emulation")) {
             generateEmulationSpeedItems();
+            generateRunAheadItems();
             ImGui::EndMenu();
         }
         if (ImGui::BeginMenu("Controller")) {
@@ -378,6 +379,23 @@ void GuiView::generateEmulationSpeedItems(){
     }
 }
 
+void GuiView::generateRunAheadItems(){
+    if (ImGui::BeginMenu("Run-ahead")) {
+        for (int frames = 0; frames <= MAX_RUN_AHEAD_FRAMES; frames++) {
+            std::stringstream ss;
+            if (frames == 0) {
+                ss << "Off";
+            } else {
+                ss << frames << (frames == 1 ? " frame" : " frames");
+            }
+            if (ImGui::MenuItem(ss.str().c_str(), "", settings.runAheadFrames == frames)) {
+                settings.runAheadFrames = frames;
+            }
+        }
+        ImGui::EndMenu();
+    }
+}
+
 void GuiView::generateWindowedSizeItems(){
     if (ImGui::BeginMenu("Windowed Size")) {
         float sizeMultiplier = MIN_WINDOW_SIZE_MULTIPLIER;
@@ -129,6 +129,7 @@ private:
 
     // Other ----------------------------------------
     void generateEmulationSpeedItems();
+    void generateRunAheadItems();
     void generateWindowedSizeItems();
 
     void prepareCenteredWindow();
@@ -1,6 +1,8 @@
 #include "RenderView.h" // implements
 
 #include <sstream>
+#include <cstring> // memcpy
+#include <memory> // make_unique
 
 #include "shaders.h"
 #include "../helpers/ErrorReport.h"
@@ -13,6 +15,7 @@ RenderView::RenderView(AppSettings& settings, PaletteHandler& paletteHandler):
     y = 0;
     width = 0;
     height = 0;
+    pixelBufferIndex = 0;
 }
 
 void RenderView::initGL() {
@@ -45,7 +48,23 @@ void RenderView::initGL() {
     // be loaded.
     renderShaderProgram = loadShaderProgram(paletteVert, paletteFrag);
     fxShaderProgram = 0; // TODO Implement post process fx
+
+    // The screen texture is allocated once and then only updated
     glGenTextures(1, &screenTexture);
+    glBindTexture(GL_TEXTURE_2D, screenTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, LCD_WIDTH, LCD_HEIGHT, 0, GL_RED, GL_UNSIGNED_BYTE, nullptr);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenBuffers(PIXEL_BUFFER_AMOUNT, pixelBuffers);
+    for (GLuint pixelBuffer : pixelBuffers) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, LCD_WIDTH * LCD_HEIGHT, nullptr, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    if (glErrorFound(glErrorLog)) { FATAL_ERROR(glErrorLog); }
 }
 
 void RenderView::render() const {
@@ -76,29 +95,25 @@ void RenderView::clear() const {
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 }
 
-void RenderView::setScreenTexture(uint8_t textureData[]) {
+void RenderView::setScreenTexture(const uint8_t frameBuffer[]) {
     std::string glErrorLog;
 
-    // Free previous texture. It is the only gl resource that needs to be deleted continuously in this code since
-    // the texture is replaced so often.
-    if (screenTexture != 0) {
-        glDeleteTextures(1, &screenTexture);
-    }
+    pixelBufferIndex = (pixelBufferIndex + 1) % PIXEL_BUFFER_AMOUNT;
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffers[pixelBufferIndex]);
 
-    glGenTextures(1, &screenTexture);
-    glBindTexture(GL_TEXTURE_2D, screenTexture);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexImage2D(GL_TEXTURE_2D,
-                 0,
-                 GL_RED,
-                 LCD_WIDTH,
-                 LCD_HEIGHT,
-                 0,
-                 GL_RED,
-                 GL_UNSIGNED_BYTE,
-                 textureData);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    // Invalidating the buffer lets the driver hand out new memory instead of waiting for a previous upload
+    void* pixels = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, LCD_WIDTH * LCD_HEIGHT,
+                                    GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (pixels) {
+        std::memcpy(pixels, frameBuffer, LCD_WIDTH * LCD_HEIGHT);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+        // Copies from the bound pixel buffer, the last argument is an offset into it
+        glBindTexture(GL_TEXTURE_2D, screenTexture);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, LCD_WIDTH, LCD_HEIGHT, GL_RED, GL_UNSIGNED_BYTE, nullptr);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
     if (glErrorFound(glErrorLog)) { FATAL_ERROR(glErrorLog); }
 }
 
@@ -29,11 +29,13 @@ public:
     void clear() const;
 
     /**
-     * Sets the current texture of this view. The texture is a one channel bitmap.
+     * Sets the current texture of this view. The texture is the frame buffer of the PPU, one color number (0-3) per
+     * pixel, which is mapped to the colors of the current palette when rendered. The texture is updated in place
+     * through a pixel buffer object, so no GL objects are created.
      *
-     * @param textureData
+     * @param frameBuffer LCD_WIDTH * LCD_HEIGHT color numbers
      */
-    void setScreenTexture(uint8_t textureData[]);
+    void setScreenTexture(const uint8_t frameBuffer[]);
 
     /**
      * Sets the position of the viewport.
@@ -53,6 +55,7 @@ public:
 
 private:
     const static int VERTEX_AMOUNT = 6;
+    const static int PIXEL_BUFFER_AMOUNT = 2;
 
     AppSettings& settings;
     PaletteHandler& paletteHandler;
@@ -64,6 +67,9 @@ private:
     int height;
     GLuint vertexArrayObject;
     GLuint screenTexture;
+    // Alternated between frames, so that writing one does not wait for the upload from the other
+    GLuint pixelBuffers[PIXEL_BUFFER_AMOUNT];
+    int pixelBufferIndex;
     GLuint renderShaderProgram;
     GLuint fxShaderProgram;
 
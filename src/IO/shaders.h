@@ -8,20 +8,21 @@ const std::string paletteFrag = "#version 420\n"
                                 "layout(location = 0) out vec4 fragmentColor;\n"
                                 "in vec2 texCoord;\n"
                                 "layout (binding = 0) uniform sampler2D screenTex;\n"
-                                "const float C1_MAX = 0.25f;\n"
-                                "const float C2_MAX = 0.50f;\n"
-                                "const float C3_MAX = 0.75f;\n"
+                                "const float C1_MIN = 2.5f;\n"
+                                "const float C2_MIN = 1.5f;\n"
+                                "const float C3_MIN = 0.5f;\n"
                                 "uniform vec3 c1;\n"
                                 "uniform vec3 c2;\n"
                                 "uniform vec3 c3;\n"
                                 "uniform vec3 c4;\n"
                                 "void main() \n"
                                 "{\n"
-                                "vec4 texColor = texture(screenTex, texCoord);\n"
-                                "vec3 color = texColor.rrr;\n"
-                                "if (texColor.r <= C1_MAX) color = c1;\n"
-                                "else if (texColor.r <= C2_MAX) color = c2;\n"
-                                "else if (texColor.r <= C3_MAX) color = c3;\n"
+                                "// The texture holds the color numbers 0-3 of the PPU, 0 being the lightest\n"
+                                "float colorNumber = texture(screenTex, texCoord).r * 255.f;\n"
+                                "vec3 color;\n"
+                                "if (colorNumber >= C1_MIN) color = c1;\n"
+                                "else if (colorNumber >= C2_MIN) color = c2;\n"
+                                "else if (colorNumber >= C3_MIN) color = c3;\n"
                                 "else color = c4;\n"
                                 "fragmentColor = vec4(color, 1.f);\n"
                                 "}";
@@ -8,7 +8,9 @@
 #include "../gameboy/Definitions.h"
 
 AppSettings::AppSettings():
-        romPath{".."}, emulationSpeedMultiplier{1.f}, windowedWidth{LCD_WIDTH * MIN_WINDOW_SIZE_MULTIPLIER},
+        romPath{".."}, emulationSpeedMultiplier{1.f}, rewindBufferSize{DEFAULT_REWIND_BUFFER_SIZE},
+        rewindKeyframeInterval{DEFAULT_REWIND_KEYFRAME_INTERVAL}, runAheadFrames{0},
+        windowedWidth{LCD_WIDTH * MIN_WINDOW_SIZE_MULTIPLIER},
         windowedHeight{LCD_HEIGHT * MIN_WINDOW_SIZE_MULTIPLIER}, fullscreen{false}, keepAspectRatio{true},
         paletteNumber{0}, masterVolume{0.25f}
 {
@@ -96,6 +98,18 @@ void AppSettings::loadSettings() {
                 } else if (key == kbTurboKey && valueIsValidKeyCode) {
                     keyBinds.turboMode.keyVal = naturalValue;
                     keyBinds.turboMode.keyBind = SDL_GetKeyName(naturalValue);
+                } else if (key == kbRewindKey && valueIsValidKeyCode) {
+                    keyBinds.rewind.keyVal = naturalValue;
+                    keyBinds.rewind.keyBind = SDL_GetKeyName(naturalValue);
+                } else if (key == kbRecordMovieKey && valueIsValidKeyCode) {
+                    keyBinds.recordMovie.keyVal = naturalValue;
+                    keyBinds.recordMovie.keyBind = SDL_GetKeyName(naturalValue);
+                } else if (key == rewindBufferSizeKey && naturalValue <= MAX_REWIND_BUFFER_SIZE) {
+                    rewindBufferSize = naturalValue;
+                } else if (key == rewindKeyframeIntervalKey && naturalValue >= 1) {
+                    rewindKeyframeInterval = naturalValue;
+                } else if (key == runAheadFramesKey && naturalValue <= MAX_RUN_AHEAD_FRAMES) {
+                    runAheadFrames = naturalValue;
                 } else if (key == windowWidthKey && (naturalValue >= LCD_WIDTH * MIN_WINDOW_SIZE_MULTIPLIER)) {
                     windowedWidth = naturalValue;
                 } else if (key == windowHeightKey && (naturalValue >= LCD_HEIGHT * MIN_WINDOW_SIZE_MULTIPLIER)) {
@@ -145,6 +159,15 @@ void AppSettings::saveSettings() {
         file << kbUpKey << "=" << keyBinds.up.keyVal << std::endl;
         file << kbDownKey << "=" << keyBinds.down.keyVal << std::endl;
         file << kbTurboKey << "=" << keyBinds.turboMode.keyVal << std::endl;
+        file << kbRewindKey << "=" << keyBinds.rewind.keyVal << std::endl;
+        file << kbRecordMovieKey << "=" << keyBinds.recordMovie.keyVal << std::endl;
+        file << std::endl;
+        file << "% Memory used for rewinding in MB, 0 disables rewinding. Must be at most " << MAX_REWIND_BUFFER_SIZE << "." << std::endl;
+        file << rewindBufferSizeKey << "=" << rewindBufferSize << std::endl;
+        file << "% Frames from one complete snapshot to the next, larger values use less memory per frame." << std::endl;
+        file << rewindKeyframeIntervalKey << "=" << rewindKeyframeInterval << std::endl;
+        file << "% Frames emulated ahead of the one displayed to hide input latency, 0 disables it. Must be at most " << MAX_RUN_AHEAD_FRAMES << "." << std::endl;
+        file << runAheadFramesKey << "=" << runAheadFrames << std::endl;
         file << std::endl;
         file << "% Must be larger than or equal to " << LCD_WIDTH * MIN_WINDOW_SIZE_MULTIPLIER << std::endl;
         file << windowWidthKey << "=" << windowedWidth << std::endl;
@@ -17,6 +17,9 @@ public:
     // Emulation settings
     KeyBinds keyBinds;
     float emulationSpeedMultiplier;
+    int rewindBufferSize; // in MB
+    int rewindKeyframeInterval; // in frames
+    int runAheadFrames;
 
     // Screen settings
     int windowedWidth;
@@ -43,6 +46,12 @@ private:
     inline static const std::string kbUpKey = "keyBind_up";
     inline static const std::string kbDownKey = "keyBind_down";
     inline static const std::string kbTurboKey = "keyBind_turbo";
+    inline static const std::string kbRewindKey = "keyBind_rewind";
+    inline static const std::string kbRecordMovieKey = "keyBind_recordMovie";
+
+    inline static const std::string rewindBufferSizeKey = "rewindBufferSize";
+    inline static const std::string rewindKeyframeIntervalKey = "rewindKeyframeInterval";
+    inline static const std::string runAheadFramesKey = "runAheadFrames";
 
     inline static const std::string windowWidthKey = "windowWidth";
     inline static const std::string windowHeightKey = "windowedHeight";
@@ -5,6 +5,7 @@
 #include <chrono> // time
 #include <thread> // sleep
 #include <cmath>
+#include <algorithm> // copy, max
 
 #include "../helpers/AppTimer.h"
 #include "../helpers/ErrorReport.h"
@@ -12,8 +13,12 @@
 
 Application::Application():
     framesUntilStep{0}, windowWidth{settings.windowedWidth}, windowHeight{settings.windowedHeight},
-    state{State::MENU}, audio(settings), renderView(settings, paletteHandler),
-    guiView(settings, paletteHandler), controller(settings, guiView, gameBoy)
+    state{State::MENU},
+    rewindBuffer(static_cast<size_t>(settings.rewindBufferSize) * 1024 * 1024, settings.rewindKeyframeInterval),
+    recordingMovie{false}, audio(settings), emulationSpeed{settings.emulationSpeedMultiplier}, rewinding{false},
+    movieRequested{false}, runAheadFrames{settings.runAheadFrames}, emulating{false},
+    terminating{false}, renderView(settings, paletteHandler), guiView(settings, paletteHandler),
+    controller(settings, guiView, inputQueue)
 {
     initSDL(); // Creates gl context and sdl window. This needs to be called before other inits.
     renderView.initGL();
@@ -21,7 +26,12 @@ Application::Application():
     correctViewport();
 
     guiView.setLoadRomCallback([this](std::string&& romPath) -> void {
+        std::lock_guard<std::mutex> lock(emulationMutex);
+        // A movie only holds one game, recording continues with a new movie of the next game
+        stopMovie();
         gameBoy.loadRom("../roms/gb/boot_lameboy_big.gb", romPath);
+        this->romPath = romPath;
+        rewindBuffer.clear();
     });
 
     guiView.setExitMenuCallback([this]() -> void {
@@ -45,6 +55,8 @@ Application::Application():
        x = windowWidth * 0.5f;
        y = windowHeight * 0.5f;
     });
+
+    emulationThread = std::thread(&Application::emulationLoop, this);
 }
 
 
@@ -61,32 +73,32 @@ void Application::run() {
 
         // Clear renderView
         renderView.clear();
-        // Step through emulation until playspeed number of frames are produced, then display the last one.
-        if (state == State::EMULATION && gameBoy.isOn()) {
-            stepEmulation();
-            if (gameBoy.isReadyToDraw()) {
-                gameBoy.confirmDraw();
-            }
-            renderView.setScreenTexture(gameBoy.getScreenTexture().get());
+        // Display the latest frame produced by the emulation loop
+        if (frames.update()) {
+            renderView.setScreenTexture(frames.front().data());
         }
         renderView.render();
 
         this->state = controller.handleSDLEvents(state);
+        emulationSpeed = settings.emulationSpeedMultiplier;
+        runAheadFrames = settings.runAheadFrames;
+        movieRequested = controller.isRecordingMovie();
+        // Rewinding would cut frames out of the movie being recorded
+        rewinding = controller.isRewinding() && !movieRequested;
+        // The emulation loop is paused while the menu is open
+        setEmulating(state == State::EMULATION && gameBoy.isOn());
         // Render menu
         if (state == State::MENU) {
-            audio.stopSound();
             guiView.updateAndRender(window);
         }
         SDL_GL_SwapWindow(window);
 
         // Time application to 60Hz
-        float msSinceTick = timer.msSinceTick();
-        if (msSinceTick < frameTime) {
-            int msToSleep = frameTime - msSinceTick;
-            std::this_thread::sleep_for(std::chrono::milliseconds(msToSleep));
-        }
+        timer.sleepUntil(frameTime);
     }
 
+    stopEmulationThread();
+    stopMovie();
     if (gameBoy.save()) {
         std::cout << "Saved successfully" << std::endl;
     } else {
@@ -162,10 +174,110 @@ void Application::terminate() {
     SDL_Quit();
 }
 
+void Application::emulationLoop() {
+    using namespace std::chrono;
+    const auto frameDuration = duration_cast<steady_clock::duration>(duration<double>(1.0 / LCD_REFRESH_RATE));
+    auto nextFrame = steady_clock::now();
+
+    std::unique_lock<std::mutex> lock(emulationMutex);
+    while (true) {
+        emulationResumed.wait(lock, [this]() { return emulating || terminating; });
+        if (terminating) {
+            break;
+        }
+
+        // Input is applied as the keys held down for the next frame, the same way a movie is replayed
+        JoypadEvent event;
+        while (inputQueue.pop(event)) {
+            if (event.action == JOYPAD_PRESS) {
+                frameInput.press(event.key);
+            } else {
+                frameInput.release(event.key);
+            }
+        }
+        gameBoy.setJoypadState(frameInput.nextFrame());
+
+        // A replay has no boot ROM, so recording waits until the boot ROM is done
+        if (movieRequested && !recordingMovie && !gameBoy.isBooting()) {
+            startMovie();
+        } else if (!movieRequested && recordingMovie) {
+            stopMovie();
+        }
+
+        // Step through emulation until playspeed number of frames are produced, then publish the last one.
+        if (rewinding) {
+            stepBack();
+        } else {
+            stepEmulation();
+        }
+        if (gameBoy.isReadyToDraw()) {
+            gameBoy.confirmDraw();
+        }
+        // Run-ahead is only worth it when input matters, not while rewinding or fast forwarding
+        bool ranAhead = runAheadFrames > 0 && emulationSpeed == 1 && !rewinding &&
+                        runAhead.run(gameBoy, runAheadFrames, frames.back().data());
+        if (!ranAhead) {
+            const uint8_t* frameBuffer = gameBoy.getFrameBuffer();
+            std::copy(frameBuffer, frameBuffer + LCD_WIDTH * LCD_HEIGHT, frames.back().begin());
+        }
+        frames.publish();
+        // The samples are streamed here rather than by the main loop, so that a stall there does not starve
+        // the audio device, and while holding the lock, as the main loop stops the sound when pausing
+        audio.streamSamples();
+        audio.updateSampleRate();
+        size_t queuedSamples = audio.getQueuedSamples();
+
+        // Time emulation to 60Hz, without holding the lock so that the main loop can pause it meanwhile
+        lock.unlock();
+        nextFrame += frameDuration;
+        auto now = steady_clock::now();
+        if (nextFrame < now) {
+            // Fell behind, for example after being paused, do not try to catch up
+            nextFrame = now;
+        }
+        if (audio.isActive() && emulationSpeed == 1 && !rewinding) {
+            // While sound is playing it is what the emulation needs to keep up with
+            if (queuedSamples < AUDIO_BUFFER_SIZE) {
+                // About to run out of samples
+                nextFrame = now;
+            } else if (queuedSamples > 2 * AUDIO_TARGET_SAMPLES) {
+                // Far ahead of the audio device, wait until the queue is back at its target
+                auto ahead = duration<double>((double)(queuedSamples - AUDIO_TARGET_SAMPLES) / AUDIO_SAMPLE_RATE);
+                nextFrame = std::max(nextFrame, now + duration_cast<steady_clock::duration>(ahead));
+            }
+        }
+        std::this_thread::sleep_until(nextFrame);
+        lock.lock();
+    }
+}
+
+void Application::setEmulating(bool enabled) {
+    if (emulating == enabled) {
+        return;
+    }
+    // The emulation loop is between two frames once the lock is acquired
+    std::lock_guard<std::mutex> lock(emulationMutex);
+    emulating = enabled;
+    if (!emulating) {
+        audio.stopSound();
+    }
+    emulationResumed.notify_one();
+}
+
+void Application::stopEmulationThread() {
+    {
+        std::lock_guard<std::mutex> lock(emulationMutex);
+        terminating = true;
+    }
+    emulationResumed.notify_one();
+    emulationThread.join();
+}
+
 void Application::stepEmulation() {
-    if (settings.emulationSpeedMultiplier == 1) {
+    float speed = emulationSpeed;
+    if (speed == 1) {
         gameBoyStep();
-    } else if (settings.emulationSpeedMultiplier < 1) {
+    } else if (speed < 1) {
         stepSlowly();
     } else {
         stepFast();
@@ -173,7 +285,10 @@ void Application::stepEmulation() {
 }
 
 void Application::stepFast() {
-    for (int i = 0; i < settings.emulationSpeedMultiplier; i++) {
+    float speed = emulationSpeed;
+    for (int i = 0; i < speed; i++) {
+        // Only the last frame is displayed, the others do not need to be drawn
+        gameBoy.setRenderSkipping(i + 1 < speed);
         gameBoyStep();
     }
 }
@@ -181,7 +296,7 @@ void Application::stepFast() {
 void Application::stepSlowly() {
     if (framesUntilStep <= 0) {
         gameBoyStep();
-        framesUntilStep = 1 / settings.emulationSpeedMultiplier;
+        framesUntilStep = 1 / emulationSpeed;
     }
     framesUntilStep--;
 }
@@ -191,17 +306,40 @@ void Application::gameBoyStep() {
         //Actually discards frame until settings->playSpeed number of frames have been produced.
         gameBoy.confirmDraw();
     }
+    if (recordingMovie) {
+        movie.recordFrame(gameBoy.getJoypadState());
+    }
     while (!gameBoy.isReadyToDraw()) {
         gameBoy.step(&audio);
     }
+    if (settings.rewindBufferSize > 0) {
+        rewindBuffer.record(gameBoy);
+    }
+}
 
-    auto playSound = gameBoy.isReadyToPlaySound();
-    if (playSound) {
-        audio.stepSound(playSound, gameBoy.getAPUState());
-        gameBoy.confirmPlay();
+void Application::stepBack() {
+    // No samples are produced while rewinding, so the sound stops once the queued samples have played
+    rewindBuffer.stepBack(gameBoy);
+}
+
+void Application::startMovie() {
+    // Only fails without a game or while booting, and is not started then
+    recordingMovie = movie.startRecording(gameBoy);
+    if (recordingMovie) {
+        std::cout << "Recording movie" << std::endl;
     }
 }
 
+void Application::stopMovie() {
+    if (!recordingMovie) {
+        return;
+    }
+    recordingMovie = false;
+    std::string path = romPath + ".movie";
+    if (movie.save(path)) {
+        std::cout << "Saved movie of " << movie.getFrameCount() << " frames: " << path << std::endl;
+    }
+}
 
 void Application::correctWindowSize() {
     int newWidth, newHeight;
@@ -1,5 +1,11 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 #include "AppSettings.h"
 #include "State.h"
 #include "../IO/RenderView.h"
@@ -7,8 +13,20 @@
 #include "../IO/GuiView.h"
 #include "../IO/Controller.h"
 #include "../gameboy/GameBoy.h"
+#include "../gameboy/RewindBuffer.h"
+#include "../gameboy/InputMovie.h"
+#include "../gameboy/RunAhead.h"
+#include "../gameboy/FrameInput.h"
+#include "../helpers/TripleBuffer.h"
+
+// The frame buffer of the PPU, one color number per pixel
+typedef std::array<uint8_t, LCD_WIDTH * LCD_HEIGHT> ScreenTexture;
+
 /**
- * This class contains the main loop of the Emulator.
+ * This class contains the main loop of the Emulator, which handles events and renders, and the emulation loop,
+ * which runs on its own thread. Frames are passed to the main loop through a triple buffer and joypad input is
+ * passed to the emulation loop through a queue, so neither loop waits for the other.
+ * With run-ahead enabled, the frames passed to the main loop are emulated ahead of the game and thrown away.
  */
 
 class Application {
@@ -31,8 +49,32 @@ private:
     PaletteHandler paletteHandler;
 
     GameBoy gameBoy;
+    RewindBuffer rewindBuffer;
+    InputMovie movie;
+    RunAhead runAhead;
+    // Only used by the emulation loop, turns the input from the main loop into the keys held down every frame
+    FrameInput frameInput;
+    // Guarded by emulationMutex like gameBoy, the path of the loaded game and whether movie is being recorded
+    std::string romPath;
+    bool recordingMovie;
     AudioController audio;
 
+    // Shared between the main loop and the emulation loop
+    InputQueue inputQueue;
+    TripleBuffer<ScreenTexture> frames;
+    std::atomic<float> emulationSpeed;
+    std::atomic<bool> rewinding;
+    std::atomic<bool> movieRequested;
+    std::atomic<int> runAheadFrames;
+
+    // Held by the emulation loop while it uses gameBoy or rewindBuffer
+    std::mutex emulationMutex;
+    std::condition_variable emulationResumed;
+    // Guarded by emulationMutex, only changed by the main loop
+    bool emulating;
+    bool terminating;
+    std::thread emulationThread;
+
     // Explicitly constructed in constructor.
     RenderView renderView;
     GuiView guiView;
@@ -40,6 +82,23 @@ private:
 
     void initSDL();
     void terminate();
+    /**
+     * Runs on the emulation thread. Emulates one frame at a time at the Game Boy refresh rate while emulating is set,
+     * publishes the frames to the main loop and streams the samples to the audio device. While sound is playing at
+     * normal speed, the frames are instead timed to keep the samples queued on the device near their target, so it
+     * neither runs out nor adds latency.
+     * At normal speed, with run-ahead enabled, the frame published is emulated ahead of the game.
+     * */
+    void emulationLoop();
+    /**
+     * Pauses or resumes the emulation loop. When paused, the main loop may use gameBoy freely.
+     * @param enabled whether the emulation loop should run.
+     * */
+    void setEmulating(bool enabled);
+    /**
+     * Stops the emulation loop and waits for the emulation thread to finish.
+     * */
+    void stopEmulationThread();
     /**
      * Steps the emulation depending on settings.emulationSpeedMultiplier.
      * */
@@ -57,6 +116,18 @@ private:
      * gameBoyStep steps the Game Boy once.
      * */
     void gameBoyStep();
+    /**
+     * Steps the emulation back to the latest frame recorded in the rewind buffer.
+     * */
+    void stepBack();
+    /**
+     * Starts recording an input movie of the loaded game from the current frame.
+     * */
+    void startMovie();
+    /**
+     * Stops recording the input movie, if one is being recorded, and saves it next to the game ROM.
+     * */
+    void stopMovie();
     /**
     * Makes sure the window dimensions updates to match changes in RenderView dimensions.
     */
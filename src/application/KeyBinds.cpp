@@ -1,6 +1,6 @@
 #include "KeyBinds.h"
 KeyBinds::KeyBinds():
-    keyBinds({&a, &b, &start, &select, &left, &right, &up, &down, &turboMode}), nonMappableKeys({SDLK_ESCAPE})
+    keyBinds({&a, &b, &start, &select, &left, &right, &up, &down, &turboMode, &rewind, &recordMovie}), nonMappableKeys({SDLK_ESCAPE})
 {
     a.keyVal = SDLK_j;
     b.keyVal = SDLK_h;
@@ -11,6 +11,8 @@ KeyBinds::KeyBinds():
     up.keyVal = SDLK_w;
     down.keyVal = SDLK_s;
     turboMode.keyVal = SDLK_SPACE;
+    rewind.keyVal = SDLK_BACKSPACE;
+    recordMovie.keyVal = SDLK_r;
 
     for(int i=0; i < keyBinds.capacity(); i++){
         keyBinds[i]->keyBind = SDL_GetKeyName(keyBinds[i]->keyVal);
@@ -25,6 +27,8 @@ KeyBinds::KeyBinds():
     up.actionDescription = "Gamepad Up";
     down.actionDescription = "Gamepad Down";
     turboMode.actionDescription = "Turbo Mode";
+    rewind.actionDescription = "Rewind";
+    recordMovie.actionDescription = "Record Movie";
 }
 
 bool KeyBinds::editKeyBinds(const bool keysDown[], int keyBindIndex) {
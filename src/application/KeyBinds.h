@@ -30,6 +30,8 @@ public:
     action up;
     action down;
     action turboMode;
+    action rewind;
+    action recordMovie;
     std::vector<action*> keyBinds;
 
     KeyBinds();
@@ -1,8 +1,11 @@
 #include "APU.h"
 
-APU::APU() {
-    accumulatedCycles = 0;
-    readyToPlay = 0;
+#include <algorithm> // min
+
+APU::APU() :
+    leftBuffer{APU_SAMPLE_BATCH_SIZE + APU_SAMPLE_BUFFER_SIZE},
+    rightBuffer{APU_SAMPLE_BATCH_SIZE + APU_SAMPLE_BUFFER_SIZE}
+{
     accumulatedCycles = 0;
     state = 0;
     volumeEnvelopeA = 0;
@@ -81,7 +84,6 @@ void APU::write(uint16_t address, uint8_t data) {
         case NR10_ADDRESS:
             NR10 = data;
             sweepReset();
-            readyToPlay |= 1;
             return;
         case NR11_ADDRESS:
             NR11 = data;
@@ -89,7 +91,6 @@ void APU::write(uint16_t address, uint8_t data) {
         case NR12_ADDRESS:
             NR12 = data;
             volumeReset(0);
-            readyToPlay |= 1;
             return;
         case NR13_ADDRESS:
             NR13 = data;
@@ -107,7 +108,6 @@ void APU::write(uint16_t address, uint8_t data) {
         case NR22_ADDRESS:
             NR22 = data;
             volumeReset(1);
-            readyToPlay |= 2;
             return;
         case NR23_ADDRESS:
             NR23 = data;
@@ -121,7 +121,6 @@ void APU::write(uint16_t address, uint8_t data) {
             return;
         case NR30_ADDRESS:
             NR30 = data;
-            readyToPlay |= 4;
             return;
         case NR31_ADDRESS:
             NR31 = data;
@@ -129,7 +128,6 @@ void APU::write(uint16_t address, uint8_t data) {
         case NR32_ADDRESS:
             NR32 = data;
             volumeReset(2);
-            readyToPlay |= 4;
             return;
         case NR33_ADDRESS:
             NR33 = data;
@@ -147,7 +145,6 @@ void APU::write(uint16_t address, uint8_t data) {
         case NR42_ADDRESS:
             NR42 = data;
             volumeReset(3);
-            readyToPlay |= 8;
             return;
         case NR43_ADDRESS:
             NR43 = data;
@@ -168,9 +165,6 @@ void APU::write(uint16_t address, uint8_t data) {
         case NR52_ADDRESS:
             NR52 = data & 0x80;
             reset();
-            if(!(NR52 & 0x80)) {
-                readyToPlay |= 0xF;
-            }
             return;
         default:
             return;
@@ -207,6 +201,8 @@ void APU::reset() {
                       0x00, 0xff, 0x00, 0xff,
                       0x00, 0xff, 0x00, 0xff,
                       0x00, 0xff, 0x00, 0xff};
+
+    lfsr = 0x7FFF;
 }
 
 void APU::volumeReset(uint8_t source) {
@@ -253,22 +249,24 @@ void APU::triggerEvent(uint8_t source) {
             //If length counter is zero, it is set to 64
             lengthCounterA = NR11 & 0x3F ? NR11 & 0x3F : 0x40;
             sweepReset();
-            readyToPlay |= 1;
+            squareTimers[0] = squarePeriod(0);
             break;
         case 1:
             //If length counter is zero, it is set to 64
             lengthCounterB = NR21 & 0x3F ? NR21 & 0x3F : 0x40;
-            readyToPlay |= 2;
+            squareTimers[1] = squarePeriod(1);
             break;
         case 2:
             //If length counter is zero, it is set to 256
             lengthCounterWave = NR31 ? NR11 : 0x100;
-            readyToPlay |= 4;
+            waveTimer = wavePeriod();
+            wavePosition = 0;
             break;
         case 3:
             //If length counter is zero, it is set to 64
             lengthCounterNoise = NR41 & 0x3F ? NR41 & 0x3F : 0x40;
-            readyToPlay |= 8;
+            noiseTimer = noisePeriod();
+            lfsr = 0x7FFF;
             break;
     }
     volumeReset(source);
@@ -278,33 +276,29 @@ void APU::lengthStep() {
     if((NR14 & 0x40) && lengthCounterA) {
         if(!--lengthCounterA) {
             NR14 &= 0x7F;
-            readyToPlay |= 1;
         }
     }
 
     if((NR24 & 0x40) && lengthCounterB) {
         if(!--lengthCounterB) {
             NR24 &= 0x7F;
-            readyToPlay |= 2;
         }
     }
 
     if((NR34 & 0x40) && lengthCounterWave) {
         if(!--lengthCounterWave) {
             NR34 &= 0x7F;
-            readyToPlay |= 4;
         }
     }
 
     if((NR44 & 0x40) && lengthCounterNoise) {
         if(!--lengthCounterNoise) {
             NR44 &= 0x7F;
-            readyToPlay |= 8;
         }
     }
 }
 
-void APU::volEnvelopeStep(IVolumeController* vc) {
+void APU::volEnvelopeStep() {
     if((NR12 & 0x7) && !--periodEnvelopeA) {
         periodEnvelopeA = NR12 & 0x7;
         //If in increment mode and envelope can be incremented
@@ -315,7 +309,6 @@ void APU::volEnvelopeStep(IVolumeController* vc) {
         if(!(NR12 & 8) && volumeEnvelopeA) {
             volumeEnvelopeA--;
         }
-        vc->setVolume(0, (float)volumeEnvelopeA / 15.0f);
     }
 
     if((NR22 & 0x7) && !--periodEnvelopeB) {
@@ -328,7 +321,6 @@ void APU::volEnvelopeStep(IVolumeController* vc) {
         if(!(NR22 & 8) && volumeEnvelopeB) {
             volumeEnvelopeB--;
         }
-        vc->setVolume(1, (float)volumeEnvelopeB / 15.0f);
     }
 
     if((NR42 & 0x7) && !--periodEnvelopeNoise) {
@@ -341,7 +333,6 @@ void APU::volEnvelopeStep(IVolumeController* vc) {
         if(!(NR42 & 8) && volumeEnvelopeNoise) {
             volumeEnvelopeNoise--;
         }
-        vc->setVolume(3, (float)volumeEnvelopeNoise / 15.0f);
     }
 }
 
@@ -350,13 +341,23 @@ void APU::sweepStep() {
         sweepShadowRegister = calculateSweep();
         if(sweepShadowRegister > 0x7FF) {
             NR14 &= 0x7F;
+        } else {
+            //The new frequency is written back to the frequency registers
+            NR13 = sweepShadowRegister & 0xFF;
+            NR14 = (NR14 & 0xF8) | (sweepShadowRegister >> 8);
         }
         sweepCounter = (NR10 >> 4) & 7;
-        readyToPlay |= 1;
     }
 }
 
-void APU::update(uint16_t cpuCycles, IVolumeController* vc) {
+void APU::update(uint16_t cpuCycles, IAudioOutput* output) {
+    //The registers have not changed since the last update, so the samples until now are synthesized first
+    if (output) {
+        synthesize(cpuCycles * 4, output);
+    } else {
+        advanceChannels(cpuCycles * 4);
+    }
+
     accumulatedCycles += cpuCycles;
     if(accumulatedCycles < CLOCK_CYCLE_THRESHOLD) {
         return;
@@ -370,41 +371,306 @@ void APU::update(uint16_t cpuCycles, IVolumeController* vc) {
         lengthStep();
     }
     if(state == 7) {
-        volEnvelopeStep(vc);
+        volEnvelopeStep();
     }
     if(state % 4 == 2) {
         sweepStep();
     }
 }
-uint8_t APU::isReadyToPlaySound() {
-    return readyToPlay;
+uint32_t APU::cyclesUntilNextEvent() const {
+    if (accumulatedCycles >= CLOCK_CYCLE_THRESHOLD) {
+        return 0;
+    }
+    return CLOCK_CYCLE_THRESHOLD - accumulatedCycles;
+}
+
+void APU::synthesize(int clockCycles, IAudioOutput* output) {
+    if (output->getSampleRate() != sampleRate) {
+        sampleRate = output->getSampleRate();
+        clocksPerSample = std::max(1, (int)(APU_CLOCK_RATE / sampleRate));
+        leftBuffer.setRates(APU_CLOCK_RATE, sampleRate);
+        rightBuffer.setRates(APU_CLOCK_RATE, sampleRate);
+    }
+    while (clockCycles > 0) {
+        int chunk = std::min(clockCycles, APU_SYNTHESIS_CHUNK);
+        //The registers may have changed since the last chunk
+        for (uint8_t channel = 0; channel < 4; channel++) {
+            updateLevel(channel, 0);
+        }
+        stepChannels(chunk);
+        leftBuffer.endFrame(chunk);
+        rightBuffer.endFrame(chunk);
+        clockCycles -= chunk;
+
+        //The samples are written in batches, most updates are shorter than a sample
+        if (leftBuffer.samplesAvailable() < APU_SAMPLE_BATCH_SIZE) {
+            continue;
+        }
+        size_t count = leftBuffer.readSamples(leftSamples.data(), leftSamples.size());
+        rightBuffer.readSamples(rightSamples.data(), count);
+        for (size_t i = 0; i < count; i++) {
+            sampleBuffer[i] = {leftSamples[i], rightSamples[i]};
+        }
+        output->writeSamples(sampleBuffer.data(), count);
+    }
+}
+
+void APU::stepChannels(int clockCycles) {
+    //Each timer holds the clock cycles until the next step of its channel, which can be before the chunk starts
+    for (uint8_t channel = 0; channel < 2; channel++) {
+        int period = squarePeriod(channel);
+        int time = squareTimers[channel];
+        for (; time <= clockCycles; time += period) {
+            squarePositions[channel] = (squarePositions[channel] + 1) % 8;
+            updateLevel(channel, std::max(time, 0));
+        }
+        squareTimers[channel] = time - clockCycles;
+    }
+
+    int period = wavePeriod();
+    int time = waveTimer;
+    for (; time <= clockCycles; time += period) {
+        wavePosition = (wavePosition + 1) % 32;
+        updateLevel(2, std::max(time, 0));
+    }
+    waveTimer = time - clockCycles;
+
+    //The noise channel can step many times per sample, so it is only stepped while playing
+    if (NR44 & 0x80) {
+        stepNoise(clockCycles);
+    }
+}
+
+void APU::advanceChannels(int clockCycles) {
+    //Whole periods are skipped at once, the positions wrap around
+    for (uint8_t channel = 0; channel < 2; channel++) {
+        int period = squarePeriod(channel);
+        if (squareTimers[channel] <= clockCycles) {
+            int steps = (clockCycles - squareTimers[channel]) / period + 1;
+            squarePositions[channel] = (squarePositions[channel] + steps) % 8;
+            squareTimers[channel] += steps * period;
+        }
+        squareTimers[channel] -= clockCycles;
+    }
+
+    int period = wavePeriod();
+    if (waveTimer <= clockCycles) {
+        int steps = (clockCycles - waveTimer) / period + 1;
+        wavePosition = (wavePosition + steps) % 32;
+        waveTimer += steps * period;
+    }
+    waveTimer -= clockCycles;
+
+    //The LFSR has to be stepped one by one
+    if (NR44 & 0x80) {
+        int noise = noisePeriod();
+        for (; noiseTimer <= clockCycles; noiseTimer += noise) {
+            stepLFSR();
+        }
+        noiseTimer -= clockCycles;
+    }
+}
+
+void APU::stepNoise(int clockCycles) {
+    int period = noisePeriod();
+    int time = noiseTimer;
+    if (period * 4 > clocksPerSample) {
+        for (; time <= clockCycles; time += period) {
+            stepLFSR();
+            updateLevel(3, std::max(time, 0));
+        }
+        noiseTimer = time - clockCycles;
+        return;
+    }
+
+    //With several steps per sample only their average is added, once per sample, so the work does not grow
+    //with the frequency
+    int volume = (NR52 & 0x80) ? volumeEnvelopeNoise * 64 : 0;
+    for (int start = 0; start < clockCycles; start += clocksPerSample) {
+        int end = std::min(start + clocksPerSample, clockCycles);
+        //The clock cycles the output is high minus those it is low
+        int sum = 0;
+        int last = start;
+        for (; time <= end; time += period) {
+            int stepTime = std::max(time, last);
+            sum += lfsr & 1 ? last - stepTime : stepTime - last;
+            last = stepTime;
+            stepLFSR();
+        }
+        sum += lfsr & 1 ? last - end : end - last;
+        setLevel(3, start, sum * volume / (end - start));
+    }
+    noiseTimer = time - clockCycles;
+}
+
+void APU::stepLFSR() {
+    uint16_t xorResult = (lfsr ^ (lfsr >> 1)) & 1;
+    lfsr = (lfsr >> 1) | (xorResult << 14);
+    if (NR43 & 8) { //In 7 bit mode the result is also put in bit 6
+        lfsr = (lfsr & ~0x40) | (xorResult << 6);
+    }
+}
+
+void APU::updateLevel(uint8_t channel, uint32_t clockTime) {
+    //At most 4 * 15 * 8 per side, scaled to the range of a 16 bit sample
+    setLevel(channel, clockTime, channelOutput(channel) * 64);
+}
+
+void APU::setLevel(uint8_t channel, uint32_t clockTime, int output) {
+    int left = NR51 & (0x10 << channel) ? output * (((NR50 >> 4) & 0x7) + 1) : 0;
+    int right = NR51 & (0x01 << channel) ? output * ((NR50 & 0x7) + 1) : 0;
+
+    std::array<int, 2>& levels = channelLevels[channel];
+    if (left != levels[0]) {
+        leftBuffer.addDelta(clockTime, left - levels[0]);
+        levels[0] = left;
+    }
+    if (right != levels[1]) {
+        rightBuffer.addDelta(clockTime, right - levels[1]);
+        levels[1] = right;
+    }
+}
+
+int APU::channelOutput(uint8_t channel) const {
+    if (!(NR52 & 0x80)) {
+        return 0;
+    }
+    switch (channel) {
+        case 0:
+            if (NR14 & 0x80) {
+                bool high = (DUTY_PATTERNS[(NR11 >> 6) & 0x3] >> (7 - squarePositions[0])) & 1;
+                return high ? volumeEnvelopeA : -volumeEnvelopeA;
+            }
+            return 0;
+        case 1:
+            if (NR24 & 0x80) {
+                bool high = (DUTY_PATTERNS[(NR21 >> 6) & 0x3] >> (7 - squarePositions[1])) & 1;
+                return high ? volumeEnvelopeB : -volumeEnvelopeB;
+            }
+            return 0;
+        case 2: {
+            uint8_t waveVolume = (NR32 >> 5) & 0x3;
+            if ((NR34 & 0x80) && (NR30 & 0x80) && waveVolume) {
+                //Two samples per byte, the upper one first. The volume shifts the samples right
+                uint8_t waveByte = wavePatternRAM[wavePosition / 2];
+                uint8_t waveSample = wavePosition % 2 ? waveByte & 0xF : waveByte >> 4;
+                uint8_t shift = waveVolume - 1;
+                return 2 * (waveSample >> shift) - (0xF >> shift);
+            }
+            return 0;
+        }
+        default:
+            if (NR44 & 0x80) {
+                return lfsr & 1 ? -volumeEnvelopeNoise : volumeEnvelopeNoise;
+            }
+            return 0;
+    }
+}
+
+int APU::squarePeriod(uint8_t channel) const {
+    uint16_t frequency = channel ? ((NR24 & 0x7) << 8) | NR23 : ((NR14 & 0x7) << 8) | NR13;
+    return (2048 - frequency) * 4;
+}
+
+int APU::wavePeriod() const {
+    uint16_t frequency = ((NR34 & 0x7) << 8) | NR33;
+    return (2048 - frequency) * 2;
+}
+
+int APU::noisePeriod() const {
+    uint8_t divisorCode = NR43 & 0x7;
+    int divisor = divisorCode ? divisorCode * 16 : 8;
+    return divisor << (NR43 >> 4);
 }
 
-void APU::confirmPlay() {
-    readyToPlay = 0;
+void APU::saveState(StateWriter &writer) const {
+    writer.write(NR10);
+    writer.write(NR11);
+    writer.write(NR12);
+    writer.write(NR13);
+    writer.write(NR14);
+    writer.write(NR21);
+    writer.write(NR22);
+    writer.write(NR23);
+    writer.write(NR24);
+    writer.write(NR30);
+    writer.write(NR31);
+    writer.write(NR32);
+    writer.write(NR33);
+    writer.write(NR34);
+    writer.write(wavePatternRAM);
+    writer.write(NR41);
+    writer.write(NR42);
+    writer.write(NR43);
+    writer.write(NR44);
+    writer.write(NR50);
+    writer.write(NR51);
+    writer.write(NR52);
+    writer.write(accumulatedCycles);
+    writer.write(state);
+    writer.write(periodEnvelopeA);
+    writer.write(volumeEnvelopeA);
+    writer.write(lengthCounterA);
+    writer.write(sweepCounter);
+    writer.write(sweepShadowRegister);
+    writer.write(sweepEnabled);
+    writer.write(periodEnvelopeB);
+    writer.write(volumeEnvelopeB);
+    writer.write(lengthCounterB);
+    writer.write(lengthCounterWave);
+    writer.write(periodEnvelopeNoise);
+    writer.write(volumeEnvelopeNoise);
+    writer.write(lengthCounterNoise);
+    writer.write(squareTimers);
+    writer.write(squarePositions);
+    writer.write(waveTimer);
+    writer.write(wavePosition);
+    writer.write(noiseTimer);
+    writer.write(lfsr);
 }
 
-//Returns the state of the
-APUState* APU::getAPUState() {
-    return new APUState{
-        (NR14 & 0x80) && (NR52 & 0x80),
-        (uint8_t)((NR11 >> 6) & 0x3),
-        sweepShadowRegister,
-        (float)volumeEnvelopeA / 15.0f,
-
-        (NR24 & 0x80) && (NR52 & 0x80),
-        (uint8_t)((NR21 >> 6) & 0x3),
-        (uint16_t)((((uint16_t)(NR24 & 0x7)) << 8) + NR23),
-        (float)volumeEnvelopeB / 15.0f,
-
-        (NR34 & 0x80) && (NR30 & 0x80) && (NR52 & 0x80),
-        wavePatternRAM,
-        (uint16_t)((((uint16_t)(NR34 & 0x7)) << 8) + NR33),
-        WAVE_VOLUMES[(NR32 >> 5) & 0x3],
-
-        (NR44 & 0x80) && (NR52 & 0x80),
-        (int)((524288.0 / (NR43 & 0x07 ? NR43 & 0x07 : 0.5f)) / (2 << (NR43 >> 4))),
-        (float)volumeEnvelopeNoise / 15.0f,
-        (bool)(NR43 & 8)
-    };
+void APU::loadState(StateReader &reader) {
+    reader.read(NR10);
+    reader.read(NR11);
+    reader.read(NR12);
+    reader.read(NR13);
+    reader.read(NR14);
+    reader.read(NR21);
+    reader.read(NR22);
+    reader.read(NR23);
+    reader.read(NR24);
+    reader.read(NR30);
+    reader.read(NR31);
+    reader.read(NR32);
+    reader.read(NR33);
+    reader.read(NR34);
+    reader.read(wavePatternRAM);
+    reader.read(NR41);
+    reader.read(NR42);
+    reader.read(NR43);
+    reader.read(NR44);
+    reader.read(NR50);
+    reader.read(NR51);
+    reader.read(NR52);
+    reader.read(accumulatedCycles);
+    reader.read(state);
+    reader.read(periodEnvelopeA);
+    reader.read(volumeEnvelopeA);
+    reader.read(lengthCounterA);
+    reader.read(sweepCounter);
+    reader.read(sweepShadowRegister);
+    reader.read(sweepEnabled);
+    reader.read(periodEnvelopeB);
+    reader.read(volumeEnvelopeB);
+    reader.read(lengthCounterB);
+    reader.read(lengthCounterWave);
+    reader.read(periodEnvelopeNoise);
+    reader.read(volumeEnvelopeNoise);
+    reader.read(lengthCounterNoise);
+    reader.read(squareTimers);
+    reader.read(squarePositions);
+    reader.read(waveTimer);
+    reader.read(wavePosition);
+    reader.read(noiseTimer);
+    reader.read(lfsr);
 }
@@ -34,16 +34,24 @@
 
 #define CLOCK_CYCLE_THRESHOLD 2048  //4194304/(512 * 4)
 
+#define APU_CLOCK_RATE 4194304          //Channel timers count clock cycles, four per CPU cycle
+#define APU_SAMPLE_BUFFER_SIZE 256      //Samples written to the output at once at most
+#define APU_SAMPLE_BATCH_SIZE 64        //Samples collected before they are written to the output, about 1.5 ms
+#define APU_SYNTHESIS_CHUNK 4096        //Clock cycles synthesized at once, at most 188 samples at 192 kHz
+
 #include <cstdint>
 #include <array>
-#include "APUState.h"
-#include "IVolumeController.h"
+#include "BlipBuffer.h"
+#include "IAudioOutput.h"
+#include "../SaveState.h"
 
 /**
  * This class emulates the functionality of the Game Boy APU.
  * Reading and writing to the APU registers is managed by this class and events are triggered according to the
  * documentation.
- * The state of the APU can be retrieved in order to mimic the audio output, normally handled by a DAC and mixer.
+ * The four channels are synthesized in emulated time, mixed according to NR50 and NR51 and written as stereo
+ * samples to an audio output. Only the steps of the mixed signal are computed, they are turned into band-limited
+ * samples at the sample rate of the output by a BlipBuffer per side.
  */
 class APU {
 public:
@@ -69,27 +77,30 @@ public:
     void reset();
 
     /**
-     * Updates the APU timers and trigger events accordingly
+     * Synthesizes the samples for the cycles that have passed, then updates the APU timers and triggers
+     * events accordingly
      * @param cpuCycles the number of CPU cycles which has passed
-     * @param vc is the volume controller which can change the volume of specific sources
+     * @param output receives the synthesized samples, if nullptr no samples are synthesized but the channels still
+     * advance
      */
-    void update(uint16_t cpuCycles, IVolumeController* vc);
+    void update(uint16_t cpuCycles, IAudioOutput* output);
 
     /**
-     * Indicates if the status of one or more channels has changed
-     * @return bit x == 1 -> source x has changed and the output should change
+     * @return the number of CPU cycles until the next frame sequencer step
      */
-    uint8_t isReadyToPlaySound();
+    uint32_t cyclesUntilNextEvent() const;
 
     /**
-     * Resets readyToPlay
+     * Write the state of the APU to a save state.
+     * @param writer save state to write to
      */
-    void confirmPlay();
+    void saveState(StateWriter& writer) const;
 
     /**
-     * @return the state of all audio channels, and the waveform of the wave channel
+     * Restore the state of the APU from a save state.
+     * @param reader save state to read from
      */
-    APUState* getAPUState();
+    void loadState(StateReader& reader);
 
 private:
     uint8_t NR10{};
@@ -119,7 +130,6 @@ private:
     uint8_t NR51{};
     uint8_t NR52;
 
-    uint8_t readyToPlay;
     int accumulatedCycles;
     uint8_t state;
 
@@ -140,7 +150,27 @@ private:
     uint8_t volumeEnvelopeNoise{};
     uint16_t lengthCounterNoise{};
 
-    const float WAVE_VOLUMES[4] = {0.0f, 0.25f, 0.125f, 0.0675f};
+    //Waveforms of the square channels, one bit per step
+    const uint8_t DUTY_PATTERNS[4] = {0x01, 0x81, 0x87, 0x7E};
+
+    //Synthesis state, the clock cycles until each channel moves to its next step
+    std::array<int, 2> squareTimers{};
+    std::array<uint8_t, 2> squarePositions{};
+    int waveTimer{};
+    uint8_t wavePosition{};
+    int noiseTimer{};
+    uint16_t lfsr{};
+
+    //The sample rate the blip buffers are set to and the clock cycles per sample at that rate
+    double sampleRate{};
+    int clocksPerSample{1};
+    BlipBuffer leftBuffer;
+    BlipBuffer rightBuffer;
+    //What each channel currently adds to the left and right side
+    std::array<std::array<int, 2>, 4> channelLevels{};
+    std::array<int16_t, APU_SAMPLE_BUFFER_SIZE> leftSamples{};
+    std::array<int16_t, APU_SAMPLE_BUFFER_SIZE> rightSamples{};
+    std::array<StereoSample, APU_SAMPLE_BUFFER_SIZE> sampleBuffer{};
 
     void volumeReset(uint8_t source);
     void sweepReset();
@@ -148,8 +178,48 @@ private:
 
     void triggerEvent(uint8_t source);
     void lengthStep();
-    void volEnvelopeStep(IVolumeController* vc);
+    void volEnvelopeStep();
     void sweepStep();
+
+    //Synthesis methods
+    /**
+     * Synthesizes the samples of a number of clock cycles with the current state of the channels.
+     * @param clockCycles clock cycles to synthesize.
+     * @param output receives the samples.
+     */
+    void synthesize(int clockCycles, IAudioOutput* output);
+    /**
+     * Moves the channels a number of clock cycles forward, adding a step to the blip buffers whenever the
+     * output of a channel changes.
+     * @param clockCycles clock cycles, at most APU_SYNTHESIS_CHUNK.
+     */
+    void stepChannels(int clockCycles);
+    /**
+     * Moves the channels a number of clock cycles forward like stepChannels, without adding steps to the blip
+     * buffers. Used when no samples are synthesized, so the state does not depend on whether they are.
+     * @param clockCycles clock cycles.
+     */
+    void advanceChannels(int clockCycles);
+    void stepNoise(int clockCycles);
+    void stepLFSR();
+    /**
+     * Adds a step to the blip buffers if the mixed output of a channel has changed.
+     * @param channel the channel, 0 to 3.
+     * @param clockTime the time of the change in clock cycles from the start of the chunk.
+     */
+    void updateLevel(uint8_t channel, uint32_t clockTime);
+    /**
+     * Adds a step to the blip buffers if the mixed output of a channel differs from a new output.
+     * @param output the new output of the channel, scaled by 64.
+     */
+    void setLevel(uint8_t channel, uint32_t clockTime, int output);
+    /**
+     * @return the current output of a channel, between -15 and 15.
+     */
+    int channelOutput(uint8_t channel) const;
+    int squarePeriod(uint8_t channel) const;
+    int wavePeriod() const;
+    int noisePeriod() const;
 };
 
 
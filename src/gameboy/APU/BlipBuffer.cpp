@@ -0,0 +1,74 @@
+#include "BlipBuffer.h"
+
+#include <algorithm> // copy, fill, min
+#include <cmath>
+
+const BlipBuffer::Kernel BlipBuffer::kernel = BlipBuffer::createKernel();
+
+BlipBuffer::BlipBuffer(size_t capacity) :
+    factor{0}, offset{0}, integrator{0}, buffer(capacity + BLIP_KERNEL_WIDTH + 1)
+{}
+
+void BlipBuffer::setRates(double clockRate, double sampleRate) {
+    factor = (uint64_t)std::llround(sampleRate / clockRate * ((uint64_t)1 << BLIP_FRACTION_BITS));
+}
+
+void BlipBuffer::endFrame(uint32_t clockDuration) {
+    offset += clockDuration * factor;
+}
+
+size_t BlipBuffer::samplesAvailable() const {
+    return offset >> BLIP_FRACTION_BITS;
+}
+
+size_t BlipBuffer::readSamples(int16_t* out, size_t count) {
+    size_t available = samplesAvailable();
+    count = std::min(count, available);
+
+    //The buffer holds the steps, summing them gives the signal. Part of the sum is removed again every sample,
+    //which slowly pulls the signal back to 0
+    int64_t sum = integrator;
+    for (size_t i = 0; i < count; i++) {
+        sum += buffer[i];
+        int64_t sample = sum >> BLIP_UNIT_BITS;
+        out[i] = (int16_t)std::min<int64_t>(std::max<int64_t>(sample, INT16_MIN), INT16_MAX);
+        sum -= sample << (BLIP_UNIT_BITS - BLIP_BASS_SHIFT);
+    }
+    integrator = sum;
+
+    //The steps not read yet, and the tails of the kernels past them, are moved to the start
+    size_t remaining = available - count + BLIP_KERNEL_WIDTH;
+    std::copy(buffer.begin() + count, buffer.begin() + count + remaining, buffer.begin());
+    std::fill(buffer.begin() + remaining, buffer.begin() + remaining + count, 0);
+    offset -= (uint64_t)count << BLIP_FRACTION_BITS;
+    return count;
+}
+
+BlipBuffer::Kernel BlipBuffer::createKernel() {
+    Kernel result{};
+    const int phases = 1 << BLIP_PHASE_BITS;
+    const int unit = 1 << BLIP_UNIT_BITS;
+    const double pi = std::acos(-1.0);
+    for (int phase = 0; phase < phases; phase++) {
+        //A sinc centered BLIP_KERNEL_WIDTH / 2 samples after the step, with a Blackman window
+        std::array<double, BLIP_KERNEL_WIDTH> impulse{};
+        double total = 0;
+        for (int i = 0; i < BLIP_KERNEL_WIDTH; i++) {
+            double x = i - BLIP_KERNEL_WIDTH / 2 - (double)phase / phases;
+            double sinc = x == 0 ? 1 : std::sin(pi * x) / (pi * x);
+            double window = 0.42 + 0.5 * std::cos(2 * pi * x / BLIP_KERNEL_WIDTH) +
+                            0.08 * std::cos(4 * pi * x / BLIP_KERNEL_WIDTH);
+            impulse[i] = sinc * window;
+            total += impulse[i];
+        }
+
+        //Rounding errors are added to the center, so every phase sums to exactly one unit
+        int sum = 0;
+        for (int i = 0; i < BLIP_KERNEL_WIDTH; i++) {
+            result[phase][i] = (int32_t)std::lround(impulse[i] / total * unit);
+            sum += result[phase][i];
+        }
+        result[phase][BLIP_KERNEL_WIDTH / 2] += unit - sum;
+    }
+    return result;
+}
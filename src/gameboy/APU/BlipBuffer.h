@@ -0,0 +1,89 @@
+#pragma once
+
+#include <array>
+#include <cstddef> // size_t
+#include <cstdint>
+#include <vector>
+
+#define BLIP_KERNEL_WIDTH   16      //Samples each step is spread over
+#define BLIP_PHASE_BITS     6       //The position of a step within a sample is rounded to 1/64 sample
+#define BLIP_FRACTION_BITS  32      //Fixed point precision of sample positions
+#define BLIP_UNIT_BITS      14      //Fixed point precision of the kernel, leaves room for 16 bit deltas in 32 bits
+#define BLIP_BASS_SHIFT     9       //Strength of the high-pass filter removing DC offset, lower is stronger
+
+/**
+ * This class resamples a signal that is only known by its steps, such as the output of an APU channel, into
+ * samples at a lower sample rate without aliasing.
+ * Every step is added as a band-limited step, a windowed sinc kernel spread over the following samples, so the
+ * work depends on the number of steps and not on the clock rate of the signal. The samples are then produced
+ * by summing the steps in one pass.
+ * Steps are added in frames of clock cycles. The output is delayed by BLIP_KERNEL_WIDTH / 2 samples.
+ */
+class BlipBuffer {
+public:
+    /**
+     * @param capacity the maximum number of samples that can be produced before they are read.
+     */
+    explicit BlipBuffer(size_t capacity);
+
+    /**
+     * Sets the rate of the clock the steps are timed by, and the rate of the samples produced.
+     * Can be changed between frames, the samples already produced are not affected.
+     * @param clockRate clock cycles per second.
+     * @param sampleRate samples per second.
+     */
+    void setRates(double clockRate, double sampleRate);
+
+    /**
+     * Adds a step to the signal.
+     * @param clockTime the time of the step in clock cycles from the start of the frame.
+     * @param delta the change of the signal.
+     */
+    void addDelta(uint32_t clockTime, int delta) {
+        uint64_t position = offset + clockTime * factor;
+        size_t index = position >> BLIP_FRACTION_BITS;
+        if (index + BLIP_KERNEL_WIDTH > buffer.size()) {
+            return;
+        }
+        const auto& phase = kernel[(position >> (BLIP_FRACTION_BITS - BLIP_PHASE_BITS)) & ((1 << BLIP_PHASE_BITS) - 1)];
+        int32_t* out = &buffer[index];
+        for (int i = 0; i < BLIP_KERNEL_WIDTH; i++) {
+            out[i] += phase[i] * delta;
+        }
+    }
+
+    /**
+     * Ends the current frame, the samples up to its end can then be read.
+     * @param clockDuration the length of the frame in clock cycles. Steps of the next frame are timed from here.
+     */
+    void endFrame(uint32_t clockDuration);
+
+    /**
+     * @return the number of samples that can be read.
+     */
+    size_t samplesAvailable() const;
+
+    /**
+     * Reads and removes samples.
+     * @param out set to the samples.
+     * @param count maximum number of samples to read.
+     * @return the number of samples read.
+     */
+    size_t readSamples(int16_t* out, size_t count);
+
+private:
+    typedef std::array<std::array<int32_t, BLIP_KERNEL_WIDTH>, 1 << BLIP_PHASE_BITS> Kernel;
+
+    //Sample positions per clock cycle, and the position of the start of the frame, in fixed point
+    uint64_t factor;
+    uint64_t offset;
+    int64_t integrator;
+    std::vector<int32_t> buffer;
+
+    /**
+     * Builds the kernel of a band-limited step for each phase. Each phase sums to 1 << BLIP_UNIT_BITS, so that
+     * the samples after a step sum to exactly the size of the step.
+     */
+    static Kernel createKernel();
+    static const Kernel kernel;
+};
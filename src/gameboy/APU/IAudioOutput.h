@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef> // size_t
+#include <cstdint>
+
+/**
+ * A sample of the stereo output of the APU.
+ */
+struct StereoSample {
+    int16_t left;
+    int16_t right;
+};
+
+/**
+ * This class is used to allow an external part, such as an audio device, to receive the samples
+ * synthesized by the APU.
+ */
+class IAudioOutput {
+public:
+    /**
+     * Receives samples synthesized by the APU, in the order they were produced.
+     * @param samples the samples.
+     * @param count number of samples.
+     */
+    virtual void writeSamples(const StereoSample* samples, size_t count) = 0;
+
+    /**
+     * @return the number of samples per second of emulated time the APU should produce.
+     */
+    virtual double getSampleRate() const = 0;
+};
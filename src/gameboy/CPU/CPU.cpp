@@ -1,4 +1,5 @@
 #include "CPU.h"
+#include <algorithm> // copy, equal
 #include <iostream> // cpuDump
 #include "../Definitions.h" //IF-bits
 
@@ -17,18 +18,25 @@ void CPU::reset() {
     HL.all_16 = 0x00;
     F.all_8 = 0x0;
     IME = 0;
+    idleLoop.armed = false;
+    // Memory may have changed
+    idleLoop.analyzed = false;
+    idleLoopCycles = 0;
 }
 
 
-int CPU::update() {
+int CPU::update(int haltCycles) {
     if (isInterrupted()) {
         return handleInterrupts();
     }
 
     if (halt) {
-        return 1;
+        return haltCycles;
     }
 
+    if (idleLoopDetection) {
+        return executeInstructionDetectingIdleLoop();
+    }
     return executeInstruction();
 }
 void CPU::skipBootRom() {
@@ -55,6 +63,216 @@ bool CPU::getStop() const {
     return stop;
 }
 
+void CPU::saveState(StateWriter &writer) const {
+    writer.write(PC);
+    writer.write(SP.all_16);
+    writer.write(A);
+    writer.write(BC.all_16);
+    writer.write(DE.all_16);
+    writer.write(HL.all_16);
+    writer.write(F.all_8);
+    writer.write(static_cast<uint8_t>(IME));
+    writer.write(stop);
+    writer.write(halt);
+}
+
+void CPU::loadState(StateReader &reader) {
+    reader.read(PC);
+    reader.read(SP.all_16);
+    reader.read(A);
+    reader.read(BC.all_16);
+    reader.read(DE.all_16);
+    reader.read(HL.all_16);
+    reader.read(F.all_8);
+    IME = reader.read<uint8_t>();
+    reader.read(stop);
+    reader.read(halt);
+
+    // The loop being detected is not part of the state. The analysis is kept, it is only reused after checking
+    // that the code is unchanged
+    idleLoop.armed = false;
+    idleLoopCycles = 0;
+}
+
+void CPU::setIdleLoopDetection(bool enabled) {
+    idleLoopDetection = enabled;
+    idleLoop.armed = false;
+    // Memory may have changed
+    idleLoop.analyzed = false;
+    idleLoopCycles = 0;
+}
+
+bool CPU::idleLoopReadsTimer() const {
+    return idleLoop.readsTimer;
+}
+
+int CPU::executeInstructionDetectingIdleLoop() {
+    // Leaving the loop, for example to handle an interrupt, ends the iteration
+    if (idleLoop.armed && (PC < idleLoop.start || PC > idleLoop.jump)) {
+        idleLoop.armed = false;
+    }
+    int cycles = executeInstruction();
+    if (idleLoop.armed) {
+        idleLoop.cycles += cycles;
+    }
+    return cycles;
+}
+
+void CPU::detectIdleLoop(uint16_t jumpAddress) {
+    // Only backward jumps close a loop, and long loops are never idle loops
+    if (!idleLoopDetection || PC > jumpAddress) {
+        return;
+    }
+    if (jumpAddress - PC > IDLE_LOOP_MAX_LENGTH) {
+        idleLoop.armed = false;
+        idleLoop.cycles = 0;
+        return;
+    }
+    std::array<uint16_t, 4> registers = idleLoopRegisters();
+    if (idleLoop.armed && idleLoop.start == PC && idleLoop.jump == jumpAddress && idleLoop.registers == registers) {
+        // Same state as the previous iteration, the loop will repeat until a polled register changes
+        idleLoopCycles = idleLoop.cycles;
+    } else {
+        // Most loops are not idle loops, and are only decoded again if the code may have changed
+        if (!isIdleLoopAnalyzed(PC, jumpAddress)) {
+            idleLoop.idle = analyzeIdleLoop(PC, jumpAddress);
+            idleLoop.analyzed = true;
+            idleLoop.pointerKinds = idleLoopPointerKinds();
+            // ROM is never written, other code is compared to a copy
+            idleLoop.code = idleLoopCode(PC, jumpAddress);
+            idleLoop.codeInRom = idleLoop.code && jumpAddress < GAME_ROM_END;
+            if (idleLoop.code && !idleLoop.codeInRom) {
+                std::copy(idleLoop.code, idleLoop.code + (jumpAddress - PC + 2), idleLoop.codeBytes.begin());
+            } else if (!idleLoop.code) {
+                // Such as HRAM, where games often wait for OAM DMA
+                for (uint16_t i = 0; i < jumpAddress - PC + 2; i++) {
+                    idleLoop.codeBytes[i] = memory->read(PC + i);
+                }
+            }
+        }
+        idleLoop.armed = idleLoop.idle;
+        idleLoop.start = PC;
+        idleLoop.jump = jumpAddress;
+        idleLoop.registers = registers;
+    }
+    idleLoop.cycles = 0;
+}
+
+bool CPU::isIdleLoopAnalyzed(uint16_t start, uint16_t jumpAddress) const {
+    if (!idleLoop.analyzed || idleLoop.start != start || idleLoop.jump != jumpAddress) {
+        return false;
+    }
+    const uint8_t* code = idleLoopCode(start, jumpAddress);
+    if (code != idleLoop.code) {
+        return false;
+    }
+    uint16_t length = jumpAddress - start + 2;
+    if (!code) {
+        for (uint16_t i = 0; i < length; i++) {
+            if (memory->read(start + i) != idleLoop.codeBytes[i]) {
+                return false;
+            }
+        }
+    } else if (!idleLoop.codeInRom && !std::equal(code, code + length, idleLoop.codeBytes.begin())) {
+        return false;
+    }
+    return idleLoop.pointerKinds == idleLoopPointerKinds();
+}
+
+const uint8_t* CPU::idleLoopCode(uint16_t start, uint16_t jumpAddress) const {
+    // The analysis reads at most the byte after the jump
+    const uint8_t* code = memory->readPointer(start);
+    const uint8_t* end = memory->readPointer(jumpAddress + 1);
+    return code && end == code + (jumpAddress + 1 - start) ? code : nullptr;
+}
+
+bool CPU::analyzeIdleLoop(uint16_t start, uint16_t jumpAddress) {
+    if (jumpAddress - start > IDLE_LOOP_MAX_LENGTH) {
+        return false;
+    }
+    idleLoop.readsTimer = false;
+
+    uint16_t addr = start;
+    while (addr < jumpAddress) {
+        uint8_t opcode = memory->read(addr);
+        uint8_t x = opcode >> 6;
+        uint8_t y = (opcode >> 3) & 0b111;
+        uint8_t z = opcode & 0b111;
+
+        if (opcode == 0x00) {
+            // NOP
+            addr += 1;
+        } else if (opcode == 0xF0) {
+            // LDH A, (a8)
+            if (!isPolledRegister(0xFF00 + memory->read(addr + 1))) {
+                return false;
+            }
+            addr += 2;
+        } else if (opcode == 0xF2) {
+            // LD A, (C)
+            if (!isPolledRegister(0xFF00 + BC.low_8)) {
+                return false;
+            }
+            addr += 1;
+        } else if (opcode == 0xFA) {
+            // LD A, (a16)
+            if (!isPolledRegister(combineBytes(memory->read(addr + 1), memory->read(addr + 2)))) {
+                return false;
+            }
+            addr += 3;
+        } else if ((x == 1 && opcode != 0x76) || x == 2) {
+            // LD r, r' and ALU operations with A, where (HL) can only be read
+            if ((x == 1 && y == 6) || (z == 6 && !isPolledRegister(HL.all_16))) {
+                return false;
+            }
+            addr += 1;
+        } else if (x == 3 && z == 6) {
+            // ALU operations with A and d8
+            addr += 2;
+        } else if (opcode == 0xCB) {
+            // BIT b, r
+            uint8_t cbOpcode = memory->read(addr + 1);
+            if ((cbOpcode >> 6) != 1 || ((cbOpcode & 0b111) == 6 && !isPolledRegister(HL.all_16))) {
+                return false;
+            }
+            addr += 2;
+        } else if (x == 0 && z == 0 && y >= 4) {
+            // JR NZ, JR Z, JR NC, JR C
+            addr += 2;
+        } else if (x == 3 && z == 2 && y < 4) {
+            // JP NZ, JP Z, JP NC, JP C
+            addr += 3;
+        } else {
+            return false;
+        }
+    }
+    return addr == jumpAddress;
+}
+
+bool CPU::isPolledRegister(uint16_t addr) {
+    if (IO_TIMER_START <= addr && addr <= IO_TIMER_END) {
+        idleLoop.readsTimer = true;
+        return true;
+    }
+    return addr == INTERRUPT_FLAG || (IO_LCD_START <= addr && addr <= IO_LCD_END);
+}
+
+uint8_t CPU::idleLoopPointerKinds() const {
+    uint8_t kinds = 0;
+    uint16_t pointers[] = {HL.all_16, static_cast<uint16_t>(0xFF00 + BC.low_8)};
+    for (int i = 0; i < 2; i++) {
+        uint16_t addr = pointers[i];
+        bool timer = IO_TIMER_START <= addr && addr <= IO_TIMER_END;
+        bool polled = timer || addr == INTERRUPT_FLAG || (IO_LCD_START <= addr && addr <= IO_LCD_END);
+        kinds |= (polled << (2 * i)) | (timer << (2 * i + 1));
+    }
+    return kinds;
+}
+
+std::array<uint16_t, 4> CPU::idleLoopRegisters() const {
+    return {static_cast<uint16_t>((A << 8) | F.all_8), BC.all_16, DE.all_16, HL.all_16};
+}
+
 void nop() {}
 
 
@@ -508,1644 +726,408 @@ uint16_t combineBytes(uint8_t firstByte, uint8_t secondByte) {
 }
 
 
-int CPU::executeInstruction() {
-    RegisterPair tmpReg;
-    switch (readAndIncPc()) {
-        case 0x00:
+template<uint8_t index>
+uint8_t& CPU::register8() {
+    static_assert(index < 8 && index != 6, "Operand 6 is (HL) and not a register");
+    if constexpr (index == 0) {
+        return BC.high_8;
+    } else if constexpr (index == 1) {
+        return BC.low_8;
+    } else if constexpr (index == 2) {
+        return DE.high_8;
+    } else if constexpr (index == 3) {
+        return DE.low_8;
+    } else if constexpr (index == 4) {
+        return HL.high_8;
+    } else if constexpr (index == 5) {
+        return HL.low_8;
+    } else {
+        return A;
+    }
+}
+
+template<uint8_t index>
+uint8_t CPU::readOperand8() {
+    if constexpr (index == 6) {
+        return memory->read(HL.all_16);
+    } else {
+        return register8<index>();
+    }
+}
+
+template<uint8_t index>
+RegisterPair& CPU::register16() {
+    static_assert(index < 4, "There are only four register pairs");
+    if constexpr (index == 0) {
+        return BC;
+    } else if constexpr (index == 1) {
+        return DE;
+    } else if constexpr (index == 2) {
+        return HL;
+    } else {
+        return SP;
+    }
+}
+
+template<uint8_t operation>
+void CPU::aluA(uint8_t value) {
+    if constexpr (operation == 0) {
+        addA(value, false);
+    } else if constexpr (operation == 1) {
+        addA(value, true);
+    } else if constexpr (operation == 2) {
+        subA(value, false);
+    } else if constexpr (operation == 3) {
+        subA(value, true);
+    } else if constexpr (operation == 4) {
+        andA(value);
+    } else if constexpr (operation == 5) {
+        xorA(value);
+    } else if constexpr (operation == 6) {
+        orA(value);
+    } else {
+        compareA(value);
+    }
+}
+
+template<uint8_t opcode>
+int CPU::instruction() {
+    // Opcodes are decoded as xxyyyzzz, with yyy split into ppq where the operand tables apply.
+    constexpr uint8_t x = opcode >> 6;
+    constexpr uint8_t y = (opcode >> 3) & 0x07;
+    constexpr uint8_t z = opcode & 0x07;
+    constexpr uint8_t p = y >> 1;
+    constexpr uint8_t q = y & 0x01;
+
+    if constexpr (opcode == 0x76) {
+        haltOp();
+        return 1;
+    } else if constexpr (x == 1) {
+        // LD r, r'
+        if constexpr (y == 6) {
+            storeAddr(HL.all_16, register8<z>());
+            return 2;
+        } else {
+            loadIm8(register8<y>(), readOperand8<z>());
+            return z == 6 ? 2 : 1;
+        }
+    } else if constexpr (x == 2) {
+        // ALU A, r
+        aluA<y>(readOperand8<z>());
+        return z == 6 ? 2 : 1;
+    } else if constexpr (x == 0 && z == 0) {
+        if constexpr (y == 0) {
             nop();
             return 1;
-        case 0x01:
-            loadIm16(read16AndIncPc(), BC);
-            return 3;
-        case 0x02:
-            storeAddr(BC.all_16, A);
-            return 2;
-        case 0x03:
-            increment16(BC.all_16);
-            return 2;
-        case 0x04:
-            increment8(BC.high_8);
-            return 1;
-        case 0x05:
-            decrement8(BC.high_8);
-            return 1;
-        case 0x06:
-            loadIm8(BC.high_8, readAndIncPc());
-            return 2;
-        case 0x07: //RLCA
-            rlc(A);
-            F.z = 0;
-            return 1;
-        case 0x08:
+        } else if constexpr (y == 1) {
             //special case, not using read_and_inc PC
             storeAddr(combineBytes(memory->read(PC), memory->read(PC + 1)), SP.low_8);
             storeAddr(combineBytes(memory->read(PC), memory->read(PC + 1)) + 1, SP.high_8);
             PC += 2;
             return 5;
-        case 0x09:
-            addHL(BC);
-            return 2;
-        case 0x0A:
-            loadImp(BC.all_16, A);
-            return 2;
-        case 0x0B:
-            decrement16(BC.all_16);
-            return 2;
-        case 0x0C:
-            increment8(BC.low_8);
-            return 1;
-        case 0x0D:
-            decrement8(BC.low_8);
-            return 1;
-        case 0x0E:
-            loadIm8(BC.low_8, readAndIncPc());
-            return 2;
-        case 0x0F: //RRCA
-            rrc(A);
-            F.all_8 &= 0x10;
-            return 1;
-        case 0x10:
+        } else if constexpr (y == 2) {
             stopOp();
             //Says it should take 2 bytes.
             PC++;
             return 1;
-        case 0x11:
-            loadIm16(read16AndIncPc(), DE);
-            return 3;
-        case 0x12:
-            storeAddr(DE.all_16, A);
-            return 2;
-        case 0x13:
-            increment16(DE.all_16);
-            return 2;
-        case 0x14:
-            increment8(DE.high_8);
-            return 1;
-        case 0x15:
-            decrement8(DE.high_8);
-            return 1;
-        case 0x16:
-            loadIm8(DE.high_8, readAndIncPc());
-            return 2;
-        case 0x17: //RLA
-            rl(A);
-            F.z = 0;
-            return 1;
-        case 0x18:
+        } else if constexpr (y == 3) {
+            uint16_t jumpAddress = PC - 1;
             jumpRelative(readAndIncPc());
+            detectIdleLoop(jumpAddress);
             return 3;
-        case 0x19:
-            addHL(DE);
-            return 2;
-        case 0x1A:
-            loadImp(DE.all_16, A);
-            return 2;
-        case 0x1B:
-            decrement16(DE.all_16);
-            return 2;
-        case 0x1C:
-            increment8(DE.low_8);
-            return 1;
-        case 0x1D:
-            decrement8(DE.low_8);
-            return 1;
-        case 0x1E:
-            loadIm8(DE.low_8, readAndIncPc());
-            return 2;
-        case 0x1F: //RRA
-            rr(A);
-            F.z = 0; // Special case
-            return 1;
-        case 0x20:
-            if (jumpRelativeZ(readAndIncPc(), false))
-                return 3;
-            else
-                return 2;
-        case 0x21:
-
-            loadIm16(read16AndIncPc(), HL);
+        } else {
+            // JR NZ, JR Z, JR NC, JR C
+            uint16_t jumpAddress = PC - 1;
+            bool jumped;
+            if constexpr (y < 6) {
+                jumped = jumpRelativeZ(readAndIncPc(), q);
+            } else {
+                jumped = jumpRelativeC(readAndIncPc(), q);
+            }
+            if (jumped) {
+                detectIdleLoop(jumpAddress);
+            }
+            return jumped ? 3 : 2;
+        }
+    } else if constexpr (x == 0 && z == 1) {
+        if constexpr (q == 0) {
+            loadIm16(read16AndIncPc(), register16<p>());
             return 3;
-        case 0x22:
-            storeAddr(HL.all_16, A);
-            increment16(HL.all_16);
-            return 2;
-        case 0x23:
-            increment16(HL.all_16);
-            return 2;
-        case 0x24:
-            increment8(HL.high_8);
-            return 1;
-        case 0x25:
-            decrement8(HL.high_8);
-            return 1;
-        case 0x26:
-            loadIm8(HL.high_8, readAndIncPc());
-            return 2;
-        case 0x27:
-            daa();
-            return 1;
-        case 0x28:
-            if (jumpRelativeZ(readAndIncPc(), true))
-                return 3;
-            else
-                return 2;
-        case 0x29:
-            addHL(HL);
+        } else {
+            addHL(register16<p>());
             return 2;
-        case 0x2A:
-            loadImp(HL.all_16, A);
+        }
+    } else if constexpr (x == 0 && z == 2) {
+        // Indirect loads through BC, DE, HL+ and HL-
+        constexpr uint8_t pair = p < 2 ? p : 2;
+        if constexpr (q == 0) {
+            storeAddr(register16<pair>().all_16, A);
+        } else {
+            loadImp(register16<pair>().all_16, A);
+        }
+        if constexpr (p == 2) {
             increment16(HL.all_16);
-            return 2;
-        case 0x2B:
-            decrement16(HL.all_16);
-            return 2;
-        case 0x2C:
-            increment8(HL.low_8);
-            return 1;
-        case 0x2D:
-            decrement8(HL.low_8);
-            return 1;
-        case 0x2E:
-            loadIm8(HL.low_8, readAndIncPc());
-            return 2;
-        case 0x2F:
-            cpl();
-            return 1;
-        case 0x30:
-            if (jumpRelativeC(readAndIncPc(), false))
-                return 3;
-            else
-                return 2;
-        case 0x31:
-            loadIm16(read16AndIncPc(), SP);
-            return 3;
-        case 0x32:
-            storeAddr(HL.all_16, A);
+        } else if constexpr (p == 3) {
             decrement16(HL.all_16);
-            return 2;
-        case 0x33:
-            increment16(SP.all_16);
-            return 2;
-        case 0x34:
+        }
+        return 2;
+    } else if constexpr (x == 0 && z == 3) {
+        if constexpr (q == 0) {
+            increment16(register16<p>().all_16);
+        } else {
+            decrement16(register16<p>().all_16);
+        }
+        return 2;
+    } else if constexpr (x == 0 && z == 4) {
+        if constexpr (y == 6) {
             incrementAddr(HL.all_16);
             return 3;
-        case 0x35:
+        } else {
+            increment8(register8<y>());
+            return 1;
+        }
+    } else if constexpr (x == 0 && z == 5) {
+        if constexpr (y == 6) {
             decrementAddr(HL.all_16);
             return 3;
-        case 0x36:
+        } else {
+            decrement8(register8<y>());
+            return 1;
+        }
+    } else if constexpr (x == 0 && z == 6) {
+        if constexpr (y == 6) {
             storeAddr(HL.all_16, readAndIncPc());
             return 3;
-        case 0x37:
+        } else {
+            loadIm8(register8<y>(), readAndIncPc());
+            return 2;
+        }
+    } else if constexpr (x == 0 && z == 7) {
+        if constexpr (y == 0) { //RLCA
+            rlc(A);
+            F.z = 0;
+        } else if constexpr (y == 1) { //RRCA
+            rrc(A);
+            F.all_8 &= 0x10;
+        } else if constexpr (y == 2) { //RLA
+            rl(A);
+            F.z = 0;
+        } else if constexpr (y == 3) { //RRA
+            rr(A);
+            F.z = 0; // Special case
+        } else if constexpr (y == 4) {
+            daa();
+        } else if constexpr (y == 5) {
+            cpl();
+        } else if constexpr (y == 6) { //SCF
             F.all_8 &= 0x80;
             F.c = 1;
-            return 1;
-        case 0x38:
-            if (jumpRelativeC(readAndIncPc(), true))
-                return 3;
-            else
-                return 2;
-        case 0x39:
-            addHL(SP);
-            return 2;
-        case 0x3A:
-            loadImp(HL.all_16, A);
-            decrement16(HL.all_16);
-            return 2;
-        case 0x3B:
-            decrement16(SP.all_16);
-            return 2;
-        case 0x3C:
-            increment8(A);
-            return 1;
-        case 0x3D:
-            decrement8(A);
-            return 1;
-        case 0x3E:
-            loadIm8(A, readAndIncPc());
-            return 2;
-        case 0x3F:
+        } else {
             ccf();
+        }
+        return 1;
+    } else if constexpr (z == 0) {
+        if constexpr (y < 4) {
+            // RET NZ, RET Z, RET NC, RET C
+            bool returned;
+            if constexpr (p == 0) {
+                returned = retZ(q);
+            } else {
+                returned = retC(q);
+            }
+            return returned ? 5 : 2;
+        } else if constexpr (y == 4) {
+            storeAddr(0xFF00 + readAndIncPc(), A);
+            return 3;
+        } else if constexpr (y == 5) {
+            addSignedToRegPair(SP, readAndIncPc());
+            return 4;
+        } else if constexpr (y == 6) {
+            loadImp(0xFF00 + readAndIncPc(), A);
+            return 3;
+        } else {
+            HL = SP;
+            addSignedToRegPair(HL, readAndIncPc());
+            return 3;
+        }
+    } else if constexpr (z == 1) {
+        if constexpr (opcode == 0xF1) {
+            RegisterPair tmpReg;
+            popSP(tmpReg);
+            A = tmpReg.high_8;
+            F.all_8 = tmpReg.low_8;
+            return 3;
+        } else if constexpr (q == 0) {
+            popSP(register16<p>());
+            return 3;
+        } else if constexpr (p == 0) {
+            ret(false);
+            return 4;
+        } else if constexpr (p == 1) {
+            ret(true);
+            return 4;
+        } else if constexpr (p == 2) {
+            jump(HL.all_16);
             return 1;
-        case 0x40:
-            //This is stoopid.
-            loadIm8(BC.high_8, BC.high_8);
-            return 1;
-        case 0x41:
-            loadIm8(BC.high_8, BC.low_8);
-            return 1;
-        case 0x42:
-            loadIm8(BC.high_8, DE.high_8);
-            return 1;
-        case 0x43:
-            loadIm8(BC.high_8, DE.low_8);
-            return 1;
-        case 0x44:
-            loadIm8(BC.high_8, HL.high_8);
-            return 1;
-        case 0x45:
-            loadIm8(BC.high_8, HL.low_8);
-            return 1;
-        case 0x46:
-            loadIm8(BC.high_8, memory->read(HL.all_16));
-            return 2;
-        case 0x47:
-            loadIm8(BC.high_8, A);
-            return 1;
-        case 0x48:
-            loadIm8(BC.low_8, BC.high_8);
-            return 1;
-        case 0x49:
-            loadIm8(BC.low_8, BC.low_8);
-            return 1;
-        case 0x4A:
-            loadIm8(BC.low_8, DE.high_8);
-            return 1;
-        case 0x4B:
-            loadIm8(BC.low_8, DE.low_8);
-            return 1;
-        case 0x4C:
-            loadIm8(BC.low_8, HL.high_8);
-            return 1;
-        case 0x4D:
-            loadIm8(BC.low_8, HL.low_8);
-            return 1;
-        case 0x4E:
-            loadIm8(BC.low_8, memory->read(HL.all_16));
-            return 2;
-        case 0x4F:
-            loadIm8(BC.low_8, A);
-            return 1;
-        case 0x50:
-            loadIm8(DE.high_8, BC.high_8);
-            return 1;
-        case 0x51:
-            loadIm8(DE.high_8, BC.low_8);
-            return 1;
-        case 0x52:
-            loadIm8(DE.high_8, DE.high_8);
-            return 1;
-        case 0x53:
-            loadIm8(DE.high_8, DE.low_8);
-            return 1;
-        case 0x54:
-            loadIm8(DE.high_8, HL.high_8);
-            return 1;
-        case 0x55:
-            loadIm8(DE.high_8, HL.low_8);
-            return 1;
-        case 0x56:
-            loadIm8(DE.high_8, memory->read(HL.all_16));
-            return 2;
-        case 0x57:
-            loadIm8(DE.high_8, A);
-            return 1;
-        case 0x58:
-            loadIm8(DE.low_8, BC.high_8);
-            return 1;
-        case 0x59:
-            loadIm8(DE.low_8, BC.low_8);
-            return 1;
-        case 0x5A:
-            loadIm8(DE.low_8, DE.high_8);
-            return 1;
-        case 0x5B:
-            loadIm8(DE.low_8, DE.low_8);
-            return 1;
-        case 0x5C:
-            loadIm8(DE.low_8, HL.high_8);
-            return 1;
-        case 0x5D:
-            loadIm8(DE.low_8, HL.low_8);
-            return 1;
-        case 0x5E:
-            loadIm8(DE.low_8, memory->read(HL.all_16));
-            return 2;
-        case 0x5F:
-            loadIm8(DE.low_8, A);
-            return 1;
-        case 0x60:
-            loadIm8(HL.high_8, BC.high_8);
-            return 1;
-        case 0x61:
-            loadIm8(HL.high_8, BC.low_8);
-            return 1;
-        case 0x62:
-            loadIm8(HL.high_8, DE.high_8);
-            return 1;
-        case 0x63:
-            loadIm8(HL.high_8, DE.low_8);
-            return 1;
-        case 0x64:
-            loadIm8(HL.high_8, HL.high_8);
-            return 1;
-        case 0x65:
-            loadIm8(HL.high_8, HL.low_8);
-            return 1;
-        case 0x66:
-            loadIm8(HL.high_8, memory->read(HL.all_16));
-            return 2;
-        case 0x67:
-            loadIm8(HL.high_8, A);
-            return 1;
-        case 0x68:
-            loadIm8(HL.low_8, BC.high_8);
-            return 1;
-        case 0x69:
-            loadIm8(HL.low_8, BC.low_8);
-            return 1;
-        case 0x6A:
-            loadIm8(HL.low_8, DE.high_8);
-            return 1;
-        case 0x6B:
-            loadIm8(HL.low_8, DE.low_8);
-            return 1;
-        case 0x6C:
-            loadIm8(HL.low_8, HL.high_8);
-            return 1;
-        case 0x6D:
-            loadIm8(HL.low_8, HL.low_8);
-            return 1;
-        case 0x6E:
-            loadIm8(HL.low_8, memory->read(HL.all_16));
-            return 2;
-        case 0x6F:
-            loadIm8(HL.low_8, A);
-            return 1;
-        case 0x70:
-            storeAddr(HL.all_16, BC.high_8);
-            return 2;
-        case 0x71:
-            storeAddr(HL.all_16, BC.low_8);
-            return 2;
-        case 0x72:
-            storeAddr(HL.all_16, DE.high_8);
-            return 2;
-        case 0x73:
-            storeAddr(HL.all_16, DE.low_8);
-            return 2;
-        case 0x74:
-            storeAddr(HL.all_16, HL.high_8);
-            return 2;
-        case 0x75:
-            storeAddr(HL.all_16, HL.low_8);
-            return 2;
-        case 0x76:
-            haltOp();
-            return 1;
-        case 0x77:
-            storeAddr(HL.all_16, A);
+        } else {
+            loadIm16(HL.all_16, SP);
             return 2;
-        case 0x78:
-            loadIm8(A, BC.high_8);
-            return 1;
-        case 0x79:
-            loadIm8(A, BC.low_8);
-            return 1;
-        case 0x7A:
-            loadIm8(A, DE.high_8);
-            return 1;
-        case 0x7B:
-            loadIm8(A, DE.low_8);
-            return 1;
-        case 0x7C:
-            loadIm8(A, HL.high_8);
-            return 1;
-        case 0x7D:
-            loadIm8(A, HL.low_8);
-            return 1;
-        case 0x7E:
-            loadIm8(A, memory->read(HL.all_16));
+        }
+    } else if constexpr (z == 2) {
+        if constexpr (y < 4) {
+            // JP NZ, JP Z, JP NC, JP C
+            uint16_t jumpAddress = PC - 1;
+            bool jumped;
+            if constexpr (p == 0) {
+                jumped = jumpZ(read16AndIncPc(), q);
+            } else {
+                jumped = jumpC(read16AndIncPc(), q);
+            }
+            if (jumped) {
+                detectIdleLoop(jumpAddress);
+            }
+            return jumped ? 4 : 3;
+        } else if constexpr (y == 4) {
+            storeAddr(0xFF00 + BC.low_8, A);
             return 2;
-        case 0x7F:
-            loadIm8(A, A);
-            return 1;
-        case 0x80:
-            addA(BC.high_8, false);
-            return 1;
-        case 0x81:
-            addA(BC.low_8, false);
-            return 1;
-        case 0x82:
-            addA(DE.high_8, false);
-            return 1;
-        case 0x83:
-            addA(DE.low_8, false);
-            return 1;
-        case 0x84:
-            addA(HL.high_8, false);
-            return 1;
-        case 0x85:
-            addA(HL.low_8, false);
-            return 1;
-        case 0x86:
-            addA(memory->read(HL.all_16), false);
+        } else if constexpr (y == 5) {
+            memory->write(read16AndIncPc(), A);
+            return 4;
+        } else if constexpr (y == 6) {
+            loadImp(0xFF00 + BC.low_8, A);
             return 2;
-        case 0x87:
-            addA(A, false);
-            return 1;
-        case 0x88:
-            addA(BC.high_8, true);
-            return 1;
-        case 0x89:
-            addA(BC.low_8, true);
-            return 1;
-        case 0x8A:
-            addA(DE.high_8, true);
-            return 1;
-        case 0x8B:
-            addA(DE.low_8, true);
-            return 1;
-        case 0x8C:
-            addA(HL.high_8, true);
-            return 1;
-        case 0x8D:
-            addA(HL.low_8, true);
-            return 1;
-        case 0x8E:
-            addA(memory->read(HL.all_16), true);
-            return 2;
-        case 0x8F:
-            addA(A, true);
-            return 1;
-        case 0x90:
-            subA(BC.high_8, false);
-            return 1;
-        case 0x91:
-            subA(BC.low_8, false);
-            return 1;
-        case 0x92:
-            subA(DE.high_8, false);
-            return 1;
-        case 0x93:
-            subA(DE.low_8, false);
-            return 1;
-        case 0x94:
-            subA(HL.high_8, false);
-            return 1;
-        case 0x95:
-            subA(HL.low_8, false);
-            return 1;
-        case 0x96:
-            subA(memory->read(HL.all_16), false);
-            return 2;
-        case 0x97:
-            subA(A, false);
-            return 1;
-        case 0x98:
-            subA(BC.high_8, true);
-            return 1;
-        case 0x99:
-            subA(BC.low_8, true);
-            return 1;
-        case 0x9A:
-            subA(DE.high_8, true);
-            return 1;
-        case 0x9B:
-            subA(DE.low_8, true);
-            return 1;
-        case 0x9C:
-            subA(HL.high_8, true);
-            return 1;
-        case 0x9D:
-            subA(HL.low_8, true);
-            return 1;
-        case 0x9E:
-            subA(memory->read(HL.all_16), true);
-            return 2;
-        case 0x9F:
-            subA(A, true);
-            return 1;
-        case 0xA0:
-            andA(BC.high_8);
-            return 1;
-        case 0xA1:
-            andA(BC.low_8);
-            return 1;
-        case 0xA2:
-            andA(DE.high_8);
-            return 1;
-        case 0xA3:
-            andA(DE.low_8);
-            return 1;
-        case 0xA4:
-            andA(HL.high_8);
-            return 1;
-        case 0xA5:
-            andA(HL.low_8);
-            return 1;
-        case 0xA6:
-            andA(memory->read(HL.all_16));
-            return 2;
-        case 0xA7:
-            andA(A);
-            return 1;
-        case 0xA8:
-            xorA(BC.high_8);
-            return 1;
-        case 0xA9:
-            xorA(BC.low_8);
-            return 1;
-        case 0xAA:
-            xorA(DE.high_8);
-            return 1;
-        case 0xAB:
-            xorA(DE.low_8);
-            return 1;
-        case 0xAC:
-            xorA(HL.high_8);
-            return 1;
-        case 0xAD:
-            xorA(HL.low_8);
-            return 1;
-        case 0xAE:
-            xorA(memory->read(HL.all_16));
-            return 2;
-        case 0xAF:
-            xorA(A);
-            return 1;
-        case 0xB0:
-            orA(BC.high_8);
-            return 1;
-        case 0xB1:
-            orA(BC.low_8);
-            return 1;
-        case 0xB2:
-            orA(DE.high_8);
-            return 1;
-        case 0xB3:
-            orA(DE.low_8);
-            return 1;
-        case 0xB4:
-            orA(HL.high_8);
-            return 1;
-        case 0xB5:
-            orA(HL.low_8);
-            return 1;
-        case 0xB6:
-            orA(memory->read(HL.all_16));
-            return 2;
-        case 0xB7:
-            orA(A);
-            return 1;
-        case 0xB8:
-            compareA(BC.high_8);
-            return 1;
-        case 0xB9:
-            compareA(BC.low_8);
-            return 1;
-        case 0xBA:
-            compareA(DE.high_8);
-            return 1;
-        case 0xBB:
-            compareA(DE.low_8);
-            return 1;
-        case 0xBC:
-            compareA(HL.high_8);
-            return 1;
-        case 0xBD:
-            compareA(HL.low_8);
-            return 1;
-        case 0xBE:
-            compareA(memory->read(HL.all_16));
-            return 2;
-        case 0xBF:
-            compareA(A);
-            return 1;
-        case 0xC0:
-            if (retZ(false))
-                return 5;
-            else
-                return 2;
-        case 0xC1:
-            popSP(BC);
-            return 3;
-        case 0xC2:
-            if (jumpZ(read16AndIncPc(), false))
-                return 4;
-            else
-                return 3;
-        case 0xC3:
-            jump(read16AndIncPc());
-            return 4;
-        case 0xC4:
-            PC += 2;
-            if (callZ(memory->read(PC - 2), memory->read(PC - 1), false)) {
-                return 6;
-            } else {
-                return 3;
-            }
-        case 0xC5:
-            pushSP(BC);
-            return 4;
-        case 0xC6:
-            addA(readAndIncPc(), false);
-            return 2;
-        case 0xC7:
-            reset(0);
-            return 4;
-        case 0xC8:
-            if (retZ(true))
-                return 5;
-            else
-                return 2;
-        case 0xC9:
-            ret(false);
-            return 4;
-        case 0xCA:
-            if (jumpZ(read16AndIncPc(), true))
-                return 4;
-            else
-                return 3;
-        case 0xCB:
-            return CBOps();
-        case 0xCC:
-            PC += 2;
-            if (callZ(memory->read(PC - 2), memory->read(PC - 1), true)) {
-                return 6;
-            } else {
-                return 3;
-            }
-        case 0xCD:
-            PC += 2;
-            call(memory->read(PC - 2), memory->read(PC - 1));
-            return 6;
-        case 0xCE:
-            addA(readAndIncPc(), true);
-            return 2;
-        case 0xCF:
-            reset(1);
-            return 4;
-        case 0xD0:
-            if (retC(false))
-                return 5;
-            else
-                return 2;
-        case 0xD1:
-            popSP(DE);
-            return 3;
-        case 0xD2:
-            if (jumpC(read16AndIncPc(), false))
-                return 4;
-            else
-                return 3;
-        case 0xD4:
-            PC += 2;
-            if (callC(memory->read(PC - 2), memory->read(PC - 1), false)) {
-                return 6;
-            } else {
-                return 3;
-            }
-        case 0xD5:
-            pushSP(DE);
-            return 4;
-        case 0xD6:
-            subA(readAndIncPc(), false);
-            return 2;
-        case 0xD7:
-            reset(2);
-            return 4;
-        case 0xD8:
-            if (retC(true))
-                return 5;
-            else
-                return 2;
-        case 0xD9:
-            ret(true);
-            return 4;
-        case 0xDA:
-            if (jumpC(read16AndIncPc(), true))
-                return 4;
-            else
-                return 3;
-        case 0xDC:
-            PC += 2;
-            if (callC(memory->read(PC - 2), memory->read(PC - 1), true)) {
-                return 6;
-            } else {
-                return 3;
-            }
-        case 0xDE:
-            subA(readAndIncPc(), true);
-            return 2;
-        case 0xDF:
-            reset(3);
-            return 4;
-        case 0xE0:
-            storeAddr(0xFF00 + readAndIncPc(), A);
-            return 3;
-        case 0xE1:
-            popSP(HL);
-            return 3;
-        case 0xE2:
-            storeAddr(0xFF00 + BC.low_8, A);
-            return 2;
-        case 0xE5:
-            pushSP(HL);
-            return 4;
-        case 0xE6:
-            andA(readAndIncPc());
-            return 2;
-        case 0xE7:
-            reset(4);
-            return 4;
-        case 0xE8:
-            addSignedToRegPair(SP, readAndIncPc());
-            return 4;
-        case 0xE9:
-            jump(HL.all_16);
-            return 1;
-        case 0xEA:
-            memory->write(read16AndIncPc(), A);
-            return 4;
-        case 0xEE:
-            xorA(readAndIncPc());
-            return 2;
-        case 0xEF:
-            reset(5);
-            return 4;
-        case 0xF0:
-            loadImp(0xFF00 + readAndIncPc(), A);
-            return 3;
-        case 0xF1:
-            popSP(tmpReg);
-            A = tmpReg.high_8;
-            F.all_8 = tmpReg.low_8;
-            return 3;
-        case 0xF2:
-            loadImp(0xFF00 + BC.low_8, A);
-            return 2;
-        case 0xF3:
-            IME = 0;
-            return 1;
-        case 0xF5:
-            tmpReg.high_8 = A;
-            tmpReg.low_8 = F.all_8 & 0xF0;
-            pushSP(tmpReg);
-            return 4;
-        case 0xF6:
-            orA(readAndIncPc());
-            return 2;
-        case 0xF7:
-            reset(6);
-            return 4;
-        case 0xF8:
-            HL = SP;
-            addSignedToRegPair(HL, readAndIncPc());
-            return 3;
-        case 0xF9:
-            loadIm16(HL.all_16, SP);
-            return 2;
-        case 0xFA:
+        } else {
             loadImp(read16AndIncPc(), A);
             return 4;
-        case 0xFB:
-            IME = 1;
-            return 1;
-        case 0xFE:
-            compareA(readAndIncPc());
-            return 2;
-        case 0xFF:
-            reset(7);
-            return 4;
-        default:
-            nop();
-            return 1;
+        }
+    } else if constexpr (opcode == 0xC3) {
+        uint16_t jumpAddress = PC - 1;
+        jump(read16AndIncPc());
+        detectIdleLoop(jumpAddress);
+        return 4;
+    } else if constexpr (opcode == 0xCB) {
+        return CBOps();
+    } else if constexpr (opcode == 0xF3) {
+        IME = 0;
+        return 1;
+    } else if constexpr (opcode == 0xFB) {
+        IME = 1;
+        return 1;
+    } else if constexpr (z == 4 && y < 4) {
+        // CALL NZ, CALL Z, CALL NC, CALL C
+        PC += 2;
+        bool called;
+        if constexpr (p == 0) {
+            called = callZ(memory->read(PC - 2), memory->read(PC - 1), q);
+        } else {
+            called = callC(memory->read(PC - 2), memory->read(PC - 1), q);
+        }
+        return called ? 6 : 3;
+    } else if constexpr (opcode == 0xF5) {
+        RegisterPair tmpReg;
+        tmpReg.high_8 = A;
+        tmpReg.low_8 = F.all_8 & 0xF0;
+        pushSP(tmpReg);
+        return 4;
+    } else if constexpr (z == 5 && q == 0) {
+        pushSP(register16<p>());
+        return 4;
+    } else if constexpr (opcode == 0xCD) {
+        PC += 2;
+        call(memory->read(PC - 2), memory->read(PC - 1));
+        return 6;
+    } else if constexpr (z == 6) {
+        // ALU A, d8
+        aluA<y>(readAndIncPc());
+        return 2;
+    } else if constexpr (z == 7) {
+        reset(y);
+        return 4;
+    } else {
+        // Unused opcodes (0xD3, 0xDB, 0xDD, 0xE3, 0xE4, 0xEB, 0xEC, 0xED, 0xF4, 0xFC, 0xFD)
+        nop();
+        return 1;
     }
+}
 
+template<uint8_t operation, uint8_t bitNr>
+void CPU::cbOperation(uint8_t &reg) {
+    if constexpr (operation == 0) {
+        // Rotations and shifts
+        if constexpr (bitNr == 0) {
+            rlc(reg);
+        } else if constexpr (bitNr == 1) {
+            rrc(reg);
+        } else if constexpr (bitNr == 2) {
+            rl(reg);
+        } else if constexpr (bitNr == 3) {
+            rr(reg);
+        } else if constexpr (bitNr == 4) {
+            sla(reg);
+        } else if constexpr (bitNr == 5) {
+            sra(reg);
+        } else if constexpr (bitNr == 6) {
+            reg = swapBits(reg);
+        } else {
+            srl(reg);
+        }
+    } else if constexpr (operation == 2) {
+        res(bitNr, reg);
+    } else {
+        set(bitNr, reg);
+    }
+}
 
+template<uint8_t opcode>
+int CPU::cbInstruction() {
+    constexpr uint8_t x = opcode >> 6;
+    constexpr uint8_t y = (opcode >> 3) & 0x07;
+    constexpr uint8_t z = opcode & 0x07;
+
+    if constexpr (x == 1) {
+        bit(y, readOperand8<z>());
+        return z == 6 ? 3 : 2;
+    } else if constexpr (z == 6) {
+        uint8_t tmpVal = memory->read(HL.all_16);
+        cbOperation<x, y>(tmpVal);
+        storeAddr(HL.all_16, tmpVal);
+        return 4;
+    } else {
+        cbOperation<x, y>(register8<z>());
+        return 2;
+    }
 }
 
-int CPU::CBOps() {
-    uint8_t tmpVal = 0;
-    switch (readAndIncPc()) {
-        case 0x00:
-            rlc(BC.high_8);
-            return 2;
-        case 0x01:
-            rlc(BC.low_8);
-            return 2;
-        case 0x02:
-            rlc(DE.high_8);
-            return 2;
-        case 0x03:
-            rlc(DE.low_8);
-            return 2;
-        case 0x04:
-            rlc(HL.high_8);
-            return 2;
-        case 0x05:
-            rlc(HL.low_8);
-            return 2;
-        case 0x06:
-            tmpVal = memory->read(HL.all_16);
-            rlc(tmpVal);
-            storeAddr(HL.all_16, tmpVal);
-            return 4;
-        case 0x07:
-            rlc(A);
-            return 2;
-        case 0x08:
-            rrc(BC.high_8);
-            return 2;
-        case 0x09:
-            rrc(BC.low_8);
-            return 2;
-        case 0x0A:
-            rrc(DE.high_8);
-            return 2;
-        case 0x0B:
-            rrc(DE.low_8);
-            return 2;
-        case 0x0C:
-            rrc(HL.high_8);
-            return 2;
-        case 0x0D:
-            rrc(HL.low_8);
-            return 2;
-        case 0x0E:
-            tmpVal = memory->read(HL.all_16);
-            rrc(tmpVal);
-            storeAddr(HL.all_16, tmpVal);
-            return 4;
-        case 0x0F:
-            rrc(A);
-            return 2;
-        case 0x10:
-            rl(BC.high_8);
-            return 2;
-        case 0x11:
-            rl(BC.low_8);
-            return 2;
-        case 0x12:
-            rl(DE.high_8);
-            return 2;
-        case 0x13:
-            rl(DE.low_8);
-            return 2;
-        case 0x14:
-            rl(HL.high_8);
-            return 2;
-        case 0x15:
-            rl(HL.low_8);
-            return 2;
-        case 0x16:
-            tmpVal = memory->read(HL.all_16);
-            rl(tmpVal);
-            storeAddr(HL.all_16, tmpVal);
-            return 4;
-        case 0x17:
-            rl(A);
-            return 2;
-        case 0x18:
-            rr(BC.high_8);
-            return 2;
-        case 0x19:
-            rr(BC.low_8);
-            return 2;
-        case 0x1A:
-            rr(DE.high_8);
-            return 2;
-        case 0x1B:
-            rr(DE.low_8);
-            return 2;
-        case 0x1C:
-            rr(HL.high_8);
-            return 2;
-        case 0x1D:
-            rr(HL.low_8);
-            return 2;
-        case 0x1E:
-            tmpVal = memory->read(HL.all_16);
-            rr(tmpVal);
-            storeAddr(HL.all_16, tmpVal);
-            return 4;
-        case 0x1F:
-            rr(A);
-            return 2;
-        case 0x20:
-            sla(BC.high_8);
-            return 2;
-        case 0x21:
-            sla(BC.low_8);
-            return 2;
-        case 0x22:
-            sla(DE.high_8);
-            return 2;
-        case 0x23:
-            sla(DE.low_8);
-            return 2;
-        case 0x24:
-            sla(HL.high_8);
-            return 2;
-        case 0x25:
-            sla(HL.low_8);
-            return 2;
-        case 0x26:
-            tmpVal = memory->read(HL.all_16);
-            sla(tmpVal);
-            memory->write(HL.all_16, tmpVal);
-            return 4;
-        case 0x27:
-            sla(A);
-            return 2;
-        case 0x28:
-            sra(BC.high_8);
-            return 2;
-        case 0x29:
-            sra(BC.low_8);
-            return 2;
-        case 0x2A:
-            sra(DE.high_8);
-            return 2;
-        case 0x2B:
-            sra(DE.low_8);
-            return 2;
-        case 0x2C:
-            sra(HL.high_8);
-            return 2;
-        case 0x2D:
-            sra(HL.low_8);
-            return 2;
-        case 0x2E:
-            tmpVal = memory->read(HL.all_16);
-            sra(tmpVal);
-            memory->write(HL.all_16, tmpVal);
-            return 4;
-        case 0x2F:
-            sra(A);
-            return 2;
-        case 0x30:
-            BC.high_8 = swapBits(BC.high_8);
-            return 2;
-        case 0x31:
-            BC.low_8 = swapBits(BC.low_8);
-            return 2;
-        case 0x32:
-            DE.high_8 = swapBits(DE.high_8);
-            return 2;
-        case 0x33:
-            DE.low_8 = swapBits(DE.low_8);
-            return 2;
-        case 0x34:
-            HL.high_8 = swapBits(HL.high_8);
-            return 2;
-        case 0x35:
-            HL.low_8 = swapBits(HL.low_8);
-            return 2;
-        case 0x36:
-            storeAddr(HL.all_16, swapBits(memory->read(HL.all_16)));
-            return 4;
-        case 0x37:
-            A = swapBits(A);
-            return 2;
-        case 0x38:
-            srl(BC.high_8);
-            return 2;
-        case 0x39:
-            srl(BC.low_8);
-            return 2;
-        case 0x3A:
-            srl(DE.high_8);
-            return 2;
-        case 0x3B:
-            srl(DE.low_8);
-            return 2;
-        case 0x3C:
-            srl(HL.high_8);
-            return 2;
-        case 0x3D:
-            srl(HL.low_8);
-            return 2;
-        case 0x3E:
-            tmpVal = memory->read(HL.all_16);
-            srl(tmpVal);
-            memory->write(HL.all_16, tmpVal);
-            return 4;
-        case 0x3F:
-            srl(A);
-            return 2;
-        case 0x40:
-            bit(0, BC.high_8);
-            return 2;
-        case 0x41:
-            bit(0, BC.low_8);
-            return 2;
-        case 0x42:
-            bit(0, DE.high_8);
-            return 2;
-        case 0x43:
-            bit(0, DE.low_8);
-            return 2;
-        case 0x44:
-            bit(0, HL.high_8);
-            return 2;
-        case 0x45:
-            bit(0, HL.low_8);
-            return 2;
-        case 0x46:
-            bit(0, memory->read(HL.all_16));
-            return 3;
-        case 0x47:
-            bit(0, A);
-            return 2;
-        case 0x48:
-            bit(1, BC.high_8);
-            return 2;
-        case 0x49:
-            bit(1, BC.low_8);
-            return 2;
-        case 0x4A:
-            bit(1, DE.high_8);
-            return 2;
-        case 0x4B:
-            bit(1, DE.low_8);
-            return 2;
-        case 0x4C:
-            bit(1, HL.high_8);
-            return 2;
-        case 0x4D:
-            bit(1, HL.low_8);
-            return 2;
-        case 0x4E:
-            bit(1, memory->read(HL.all_16));
-            return 3;
-        case 0x4F:
-            bit(1, A);
-            return 2;
-        case 0x50:
-            bit(2, BC.high_8);
-            return 2;
-        case 0x51:
-            bit(2, BC.low_8);
-            return 2;
-        case 0x52:
-            bit(2, DE.high_8);
-            return 2;
-        case 0x53:
-            bit(2, DE.low_8);
-            return 2;
-        case 0x54:
-            bit(2, HL.high_8);
-            return 2;
-        case 0x55:
-            bit(2, HL.low_8);
-            return 2;
-        case 0x56:
-            bit(2, memory->read(HL.all_16));
-            return 3;
-        case 0x57:
-            bit(2, A);
-            return 2;
-        case 0x58:
-            bit(3, BC.high_8);
-            return 2;
-        case 0x59:
-            bit(3, BC.low_8);
-            return 2;
-        case 0x5A:
-            bit(3, DE.high_8);
-            return 2;
-        case 0x5B:
-            bit(3, DE.low_8);
-            return 2;
-        case 0x5C:
-            bit(3, HL.high_8);
-            return 2;
-        case 0x5D:
-            bit(3, HL.low_8);
-            return 2;
-        case 0x5E:
-            bit(3, memory->read(HL.all_16));
-            return 3;
-        case 0x5F:
-            bit(3, A);
-            return 2;
-        case 0x60:
-            bit(4, BC.high_8);
-            return 2;
-        case 0x61:
-            bit(4, BC.low_8);
-            return 2;
-        case 0x62:
-            bit(4, DE.high_8);
-            return 2;
-        case 0x63:
-            bit(4, DE.low_8);
-            return 2;
-        case 0x64:
-            bit(4, HL.high_8);
-            return 2;
-        case 0x65:
-            bit(4, HL.low_8);
-            return 2;
-        case 0x66:
-            bit(4, memory->read(HL.all_16));
-            return 3;
-        case 0x67:
-            bit(4, A);
-            return 2;
-        case 0x68:
-            bit(5, BC.high_8);
-            return 2;
-        case 0x69:
-            bit(5, BC.low_8);
-            return 2;
-        case 0x6A:
-            bit(5, DE.high_8);
-            return 2;
-        case 0x6B:
-            bit(5, DE.low_8);
-            return 2;
-        case 0x6C:
-            bit(5, HL.high_8);
-            return 2;
-        case 0x6D:
-            bit(5, HL.low_8);
-            return 2;
-        case 0x6E:
-            bit(5, memory->read(HL.all_16));
-            return 3;
-        case 0x6F:
-            bit(5, A);
-            return 2;
-        case 0x70:
-            bit(6, BC.high_8);
-            return 2;
-        case 0x71:
-            bit(6, BC.low_8);
-            return 2;
-        case 0x72:
-            bit(6, DE.high_8);
-            return 2;
-        case 0x73:
-            bit(6, DE.low_8);
-            return 2;
-        case 0x74:
-            bit(6, HL.high_8);
-            return 2;
-        case 0x75:
-            bit(6, HL.low_8);
-            return 2;
-        case 0x76:
-            bit(6, memory->read(HL.all_16));
-            return 3;
-        case 0x77:
-            bit(6, A);
-            return 2;
-        case 0x78:
-            bit(7, BC.high_8);
-            return 2;
-        case 0x79:
-            bit(7, BC.low_8);
-            return 2;
-        case 0x7A:
-            bit(7, DE.high_8);
-            return 2;
-        case 0x7B:
-            bit(7, DE.low_8);
-            return 2;
-        case 0x7C:
-            bit(7, HL.high_8);
-            return 2;
-        case 0x7D:
-            bit(7, HL.low_8);
-            return 2;
-        case 0x7E:
-            bit(7, memory->read(HL.all_16));
-            return 3;
-        case 0x7F:
-            bit(7, A);
-            return 2;
+template<std::size_t... opcodes>
+constexpr std::array<CPU::Instruction, 256> CPU::makeInstructionTable(std::index_sequence<opcodes...>) {
+    return {{&CPU::instruction<opcodes>...}};
+}
 
-        case 0x80:
-            res(0, BC.high_8);
-            return 2;
-        case 0x81:
-            res(0, BC.low_8);
-            return 2;
-        case 0x82:
-            res(0, DE.high_8);
-            return 2;
-        case 0x83:
-            res(0, DE.low_8);
-            return 2;
-        case 0x84:
-            res(0, HL.high_8);
-            return 2;
-        case 0x85:
-            res(0, HL.low_8);
-            return 2;
-        case 0x86:
-            tmpVal = memory->read(HL.all_16);
-            res(0, tmpVal);
-            storeAddr(HL.all_16, tmpVal);
-            return 4;
-        case 0x87:
-            res(0, A);
-            return 2;
-        case 0x88:
-            res(1, BC.high_8);
-            return 2;
-        case 0x89:
-            res(1, BC.low_8);
-            return 2;
-        case 0x8A:
-            res(1, DE.high_8);
-            return 2;
-        case 0x8B:
-            res(1, DE.low_8);
-            return 2;
-        case 0x8C:
-            res(1, HL.high_8);
-            return 2;
-        case 0x8D:
-            res(1, HL.low_8);
-            return 2;
-        case 0x8E:
-            tmpVal = memory->read(HL.all_16);
-            res(1, tmpVal);
-            storeAddr(HL.all_16, tmpVal);
-            return 4;
-        case 0x8F:
-            res(1, A);
-            return 2;
-        case 0x90:
-            res(2, BC.high_8);
-            return 2;
-        case 0x91:
-            res(2, BC.low_8);
-            return 2;
-        case 0x92:
-            res(2, DE.high_8);
-            return 2;
-        case 0x93:
-            res(2, DE.low_8);
-            return 2;
-        case 0x94:
-            res(2, HL.high_8);
-            return 2;
-        case 0x95:
-            res(2, HL.low_8);
-            return 2;
-        case 0x96:
-            tmpVal = memory->read(HL.all_16);
-            res(2, tmpVal);
-            storeAddr(HL.all_16, tmpVal);
-            return 4;
-        case 0x97:
-            res(2, A);
-            return 2;
-        case 0x98:
-            res(3, BC.high_8);
-            return 2;
-        case 0x99:
-            res(3, BC.low_8);
-            return 2;
-        case 0x9A:
-            res(3, DE.high_8);
-            return 2;
-        case 0x9B:
-            res(3, DE.low_8);
-            return 2;
-        case 0x9C:
-            res(3, HL.high_8);
-            return 2;
-        case 0x9D:
-            res(3, HL.low_8);
-            return 2;
-        case 0x9E:
-            tmpVal = memory->read(HL.all_16);
-            res(3, tmpVal);
-            storeAddr(HL.all_16, tmpVal);
-            return 4;
-        case 0x9F:
-            res(3, A);
-            return 2;
-        case 0xA0:
-            res(4, BC.high_8);
-            return 2;
-        case 0xA1:
-            res(4, BC.low_8);
-            return 2;
-        case 0xA2:
-            res(4, DE.high_8);
-            return 2;
-        case 0xA3:
-            res(4, DE.low_8);
-            return 2;
-        case 0xA4:
-            res(4, HL.high_8);
-            return 2;
-        case 0xA5:
-            res(4, HL.low_8);
-            return 2;
-        case 0xA6:
-            tmpVal = memory->read(HL.all_16);
-            res(4, tmpVal);
-            storeAddr(HL.all_16, tmpVal);
-            return 4;
-        case 0xA7:
-            res(4, A);
-            return 2;
-        case 0xA8:
-            res(5, BC.high_8);
-            return 2;
-        case 0xA9:
-            res(5, BC.low_8);
-            return 2;
-        case 0xAA:
-            res(5, DE.high_8);
-            return 2;
-        case 0xAB:
-            res(5, DE.low_8);
-            return 2;
-        case 0xAC:
-            res(5, HL.high_8);
-            return 2;
-        case 0xAD:
-            res(5, HL.low_8);
-            return 2;
-        case 0xAE:
-            tmpVal = memory->read(HL.all_16);
-            res(5, tmpVal);
-            storeAddr(HL.all_16, tmpVal);
-            return 4;
-        case 0xAF:
-            res(5, A);
-            return 2;
-        case 0xB0:
-            res(6, BC.high_8);
-            return 2;
-        case 0xB1:
-            res(6, BC.low_8);
-            return 2;
-        case 0xB2:
-            res(6, DE.high_8);
-            return 2;
-        case 0xB3:
-            res(6, DE.low_8);
-            return 2;
-        case 0xB4:
-            res(6, HL.high_8);
-            return 2;
-        case 0xB5:
-            res(6, HL.low_8);
-            return 2;
-        case 0xB6:
-            tmpVal = memory->read(HL.all_16);
-            res(6, tmpVal);
-            storeAddr(HL.all_16, tmpVal);
-            return 4;
-        case 0xB7:
-            res(6, A);
-            return 2;
-        case 0xB8:
-            res(7, BC.high_8);
-            return 2;
-        case 0xB9:
-            res(7, BC.low_8);
-            return 2;
-        case 0xBA:
-            res(7, DE.high_8);
-            return 2;
-        case 0xBB:
-            res(7, DE.low_8);
-            return 2;
-        case 0xBC:
-            res(7, HL.high_8);
-            return 2;
-        case 0xBD:
-            res(7, HL.low_8);
-            return 2;
-        case 0xBE:
-            tmpVal = memory->read(HL.all_16);
-            res(7, tmpVal);
-            storeAddr(HL.all_16, tmpVal);
-            return 4;
-        case 0xBF:
-            res(7, A);
-            return 2;
-        case 0xC0:
-            set(0, BC.high_8);
-            return 2;
-        case 0xC1:
-            set(0, BC.low_8);
-            return 2;
-        case 0xC2:
-            set(0, DE.high_8);
-            return 2;
-        case 0xC3:
-            set(0, DE.low_8);
-            return 2;
-        case 0xC4:
-            set(0, HL.high_8);
-            return 2;
-        case 0xC5:
-            set(0, HL.low_8);
-            return 2;
-        case 0xC6:
-            tmpVal = memory->read(HL.all_16);
-            set(0, tmpVal);
-            storeAddr(HL.all_16, tmpVal);
-            return 4;
-        case 0xC7:
-            set(0, A);
-            return 2;
-        case 0xC8:
-            set(1, BC.high_8);
-            return 2;
-        case 0xC9:
-            set(1, BC.low_8);
-            return 2;
-        case 0xCA:
-            set(1, DE.high_8);
-            return 2;
-        case 0xCB:
-            set(1, DE.low_8);
-            return 2;
-        case 0xCC:
-            set(1, HL.high_8);
-            return 2;
-        case 0xCD:
-            set(1, HL.low_8);
-            return 2;
-        case 0xCE:
-            tmpVal = memory->read(HL.all_16);
-            set(1, tmpVal);
-            storeAddr(HL.all_16, tmpVal);
-            return 4;
-        case 0xCF:
-            set(1, A);
-            return 2;
-        case 0xD0:
-            set(2, BC.high_8);
-            return 2;
-        case 0xD1:
-            set(2, BC.low_8);
-            return 2;
-        case 0xD2:
-            set(2, DE.high_8);
-            return 2;
-        case 0xD3:
-            set(2, DE.low_8);
-            return 2;
-        case 0xD4:
-            set(2, HL.high_8);
-            return 2;
-        case 0xD5:
-            set(2, HL.low_8);
-            return 2;
-        case 0xD6:
-            tmpVal = memory->read(HL.all_16);
-            set(2, tmpVal);
-            storeAddr(HL.all_16, tmpVal);
-            return 4;
-        case 0xD7:
-            set(2, A);
-            return 2;
-        case 0xD8:
-            set(3, BC.high_8);
-            return 2;
-        case 0xD9:
-            set(3, BC.low_8);
-            return 2;
-        case 0xDA:
-            set(3, DE.high_8);
-            return 2;
-        case 0xDB:
-            set(3, DE.low_8);
-            return 2;
-        case 0xDC:
-            set(3, HL.high_8);
-            return 2;
-        case 0xDD:
-            set(3, HL.low_8);
-            return 2;
-        case 0xDE:
-            tmpVal = memory->read(HL.all_16);
-            set(3, tmpVal);
-            storeAddr(HL.all_16, tmpVal);
-            return 4;
-        case 0xDF:
-            set(3, A);
-            return 2;
-        case 0xE0:
-            set(4, BC.high_8);
-            return 2;
-        case 0xE1:
-            set(4, BC.low_8);
-            return 2;
-        case 0xE2:
-            set(4, DE.high_8);
-            return 2;
-        case 0xE3:
-            set(4, DE.low_8);
-            return 2;
-        case 0xE4:
-            set(4, HL.high_8);
-            return 2;
-        case 0xE5:
-            set(4, HL.low_8);
-            return 2;
-        case 0xE6:
-            tmpVal = memory->read(HL.all_16);
-            set(4, tmpVal);
-            storeAddr(HL.all_16, tmpVal);
-            return 4;
-        case 0xE7:
-            set(4, A);
-            return 2;
-        case 0xE8:
-            set(5, BC.high_8);
-            return 2;
-        case 0xE9:
-            set(5, BC.low_8);
-            return 2;
-        case 0xEA:
-            set(5, DE.high_8);
-            return 2;
-        case 0xEB:
-            set(5, DE.low_8);
-            return 2;
-        case 0xEC:
-            set(5, HL.high_8);
-            return 2;
-        case 0xED:
-            set(5, HL.low_8);
-            return 2;
-        case 0xEE:
-            tmpVal = memory->read(HL.all_16);
-            set(5, tmpVal);
-            storeAddr(HL.all_16, tmpVal);
-            return 4;
-        case 0xEF:
-            set(5, A);
-            return 2;
-        case 0xF0:
-            set(6, BC.high_8);
-            return 2;
-        case 0xF1:
-            set(6, BC.low_8);
-            return 2;
-        case 0xF2:
-            set(6, DE.high_8);
-            return 2;
-        case 0xF3:
-            set(6, DE.low_8);
-            return 2;
-        case 0xF4:
-            set(6, HL.high_8);
-            return 2;
-        case 0xF5:
-            set(6, HL.low_8);
-            return 2;
-        case 0xF6:
-            tmpVal = memory->read(HL.all_16);
-            set(6, tmpVal);
-            storeAddr(HL.all_16, tmpVal);
-            return 4;
-        case 0xF7:
-            set(6, A);
-            return 2;
-        case 0xF8:
-            set(7, BC.high_8);
-            return 2;
-        case 0xF9:
-            set(7, BC.low_8);
-            return 2;
-        case 0xFA:
-            set(7, DE.high_8);
-            return 2;
-        case 0xFB:
-            set(7, DE.low_8);
-            return 2;
-        case 0xFC:
-            set(7, HL.high_8);
-            return 2;
-        case 0xFD:
-            set(7, HL.low_8);
-            return 2;
-        case 0xFE:
-            tmpVal = memory->read(HL.all_16);
-            set(7, tmpVal);
-            storeAddr(HL.all_16, tmpVal);
-            return 4;
-        case 0xFF:
-            set(7, A);
-            return 2;
+template<std::size_t... opcodes>
+constexpr std::array<CPU::Instruction, 256> CPU::makeCBInstructionTable(std::index_sequence<opcodes...>) {
+    return {{&CPU::cbInstruction<opcodes>...}};
+}
 
-    }
-    return 0;
+const std::array<CPU::Instruction, 256> CPU::instructionTable =
+        CPU::makeInstructionTable(std::make_index_sequence<256>{});
+const std::array<CPU::Instruction, 256> CPU::cbInstructionTable =
+        CPU::makeCBInstructionTable(std::make_index_sequence<256>{});
+
+int CPU::executeInstruction() {
+    return (this->*instructionTable[readAndIncPc()])();
+}
+
+int CPU::CBOps() {
+    return (this->*cbInstructionTable[readAndIncPc()])();
 }
 
 bool CPU::isInterrupted() {
-    uint8_t flags = memory->read(INTERRUPT_FLAG);
-    uint8_t mask = memory->read(INTERRUPT_ENABLE);
     if (IME || halt) {
+        uint8_t flags = memory->read(INTERRUPT_FLAG);
+        uint8_t mask = memory->read(INTERRUPT_ENABLE);
         return flags & mask;
     }
 
-
     return false;
 }
 
@@ -3,7 +3,10 @@
 #include "RegisterPair.h"
 #include "../MMU/MMU.h"
 #include "Flags.h"
+#include "../SaveState.h"
 #include <memory> //ptr
+#include <array> //array
+#include <utility> //index_sequence
 #define FRIEND_TEST(test_case_name, test_name)\
 friend class test_case_name##_##test_name##_Test
 /**
@@ -18,9 +21,11 @@ public:
     void reset();
     /**
      * Fetches, decodes and executes the instruction at location PC, also checks interrupts and halt.
+     * @param haltCycles amount of machine cycles to idle if halted. Must not pass the next point in time
+     * an interrupt can be requested, as a halted CPU only wakes up from interrupts.
      * @returns amount of machine cycles operation takes.
      */
-    int update();
+    int update(int haltCycles = 1);
     /**
      * Sets PC to 0x0100, where the boot ROM ends.
      * */
@@ -38,6 +43,38 @@ public:
      * Resets the state of the CPU from being in STOP-mode.
      * */
     void returnFromStop();
+    /**
+     * Enables or disables detection of idle loops. An idle loop is a short loop that only polls registers
+     * which do not change until the next event, such as LY, STAT, IF and the timer registers.
+     * */
+    void setIdleLoopDetection(bool enabled);
+    /**
+     * Returns the machine cycles of one iteration if the last instruction completed an iteration of an idle loop
+     * that left the CPU in the same state as the iteration before. Until a polled register changes, every further
+     * iteration will do the same, so they can be skipped by passing the time without executing them.
+     * Returns 0 otherwise.
+     * */
+    int getIdleLoopCycles() {
+        int cycles = idleLoopCycles;
+        idleLoopCycles = 0;
+        return cycles;
+    }
+    /**
+     * Returns whether the idle loop returned by getIdleLoopCycles polls any of the timer registers,
+     * which change without an event being scheduled.
+     * */
+    bool idleLoopReadsTimer() const;
+    /**
+     * Write the state of the CPU to a save state.
+     * @param writer save state to write to
+     */
+    void saveState(StateWriter& writer) const;
+
+    /**
+     * Restore the state of the CPU from a save state.
+     * @param reader save state to read from
+     */
+    void loadState(StateReader& reader);
 
 private:
     //Registers
@@ -61,6 +98,34 @@ private:
     bool stop{false};
     bool halt{false};
 
+    //Idle loop detection
+    const static uint16_t IDLE_LOOP_MAX_LENGTH = 16;
+    struct IdleLoop {
+        bool armed;
+        bool readsTimer;
+        // Target and address of the backward jump
+        uint16_t start;
+        uint16_t jump;
+        // Cycles since the previous iteration
+        int cycles;
+        // AF, BC, DE, HL at the previous iteration
+        std::array<uint16_t, 4> registers;
+
+        // The result of the latest analysis, reused while the code of the loop is unchanged
+        bool analyzed;
+        bool idle;
+        // The kinds of register HL and 0xff00 + C pointed to, the analysis depends on them
+        uint8_t pointerKinds;
+        // Host memory of the code analyzed, nullptr if the page table does not map it, and a copy of it unless
+        // it is ROM
+        const uint8_t* code;
+        bool codeInRom;
+        std::array<uint8_t, IDLE_LOOP_MAX_LENGTH + 2> codeBytes;
+    };
+    bool idleLoopDetection{false};
+    IdleLoop idleLoop{};
+    int idleLoopCycles{};
+
 
     //Update related functions
     /**
@@ -68,6 +133,100 @@ private:
     * @returns amount of machine cycles operation takes.
      */
     int executeInstruction();
+    /**
+    * Executes an instruction while detecting idle loops, keeping track of the cycles of the current iteration.
+    * @returns amount of machine cycles operation takes.
+     */
+    int executeInstructionDetectingIdleLoop();
+
+    //Idle loop detection
+    /**
+     * Called after a jump has been taken. Arms the idle loop detection when jumping backwards to the start
+     * of a loop that only polls registers, and reports an idle loop when an iteration ends in the same state.
+     * @param jumpAddress address of the jump instruction.
+     * */
+    void detectIdleLoop(uint16_t jumpAddress);
+    /**
+     * Returns whether the latest analysis holds for the loop, without decoding it again. It does if the loop is
+     * the same, its code is mapped to the same memory and unchanged, and the pointers it may read through point
+     * to the same kinds of registers as when it was analyzed.
+     * */
+    bool isIdleLoopAnalyzed(uint16_t start, uint16_t jumpAddress) const;
+    /**
+     * Returns the host memory of the code from start up to the operand of the jump, or nullptr if it is not
+     * mapped to one block of memory. Such code is read through the MMU instead.
+     * */
+    const uint8_t* idleLoopCode(uint16_t start, uint16_t jumpAddress) const;
+    /**
+     * Decodes the instructions from start up to the jump, and checks that they neither write to memory nor read
+     * from anything other than registers that only change at events.
+     * @return true if the loop is an idle loop.
+     * */
+    bool analyzeIdleLoop(uint16_t start, uint16_t jumpAddress);
+    /**
+     * @return true if addr is a register that only changes at events, sets readsTimer for the timer registers.
+     * */
+    bool isPolledRegister(uint16_t addr);
+    /**
+     * @return one bit each for HL and 0xff00 + C pointing to a polled register, and to a timer register.
+     * */
+    uint8_t idleLoopPointerKinds() const;
+    std::array<uint16_t, 4> idleLoopRegisters() const;
+
+    //Instruction dispatch
+    using Instruction = int (CPU::*)();
+    /**
+     * Handlers indexed by opcode, generated at compile time from instruction<opcode>().
+     * */
+    static const std::array<Instruction, 256> instructionTable;
+    /**
+     * Handlers indexed by the opcode following the 0xCB prefix, generated from cbInstruction<opcode>().
+     * */
+    static const std::array<Instruction, 256> cbInstructionTable;
+    template<std::size_t... opcodes>
+    static constexpr std::array<Instruction, 256> makeInstructionTable(std::index_sequence<opcodes...>);
+    template<std::size_t... opcodes>
+    static constexpr std::array<Instruction, 256> makeCBInstructionTable(std::index_sequence<opcodes...>);
+    /**
+     * Executes a single opcode, with all operands decoded from the opcode bits at compile time.
+     * @returns amount of machine cycles operation takes.
+     * */
+    template<uint8_t opcode>
+    int instruction();
+    /**
+     * Executes a single 0xCB prefixed opcode.
+     * @returns amount of machine cycles operation takes.
+     * */
+    template<uint8_t opcode>
+    int cbInstruction();
+    /**
+     * Rotation/shift (operation 0), RES (operation 2) or SET (operation 3) on reg.
+     * For rotations and shifts bitNr selects the operation: RLC, RRC, RL, RR, SLA, SRA, SWAP, SRL.
+     * */
+    template<uint8_t operation, uint8_t bitNr>
+    void cbOperation(uint8_t &reg);
+    /**
+     * Executes ADD, ADC, SUB, SBC, AND, XOR, OR or CP with register A depending on operation (0 to 7).
+     * */
+    template<uint8_t operation>
+    void aluA(uint8_t value);
+    /**
+    * The 8-bit register encoded by index in an opcode: B, C, D, E, H, L, (HL), A.
+    * Index 6 is not a register, use readOperand8 for operands that may be (HL).
+    */
+    template<uint8_t index>
+    uint8_t& register8();
+    /**
+    * Reads the 8-bit operand encoded by index, where index 6 reads from the address in HL.
+    */
+    template<uint8_t index>
+    uint8_t readOperand8();
+    /**
+    * The register pair encoded by index in an opcode: BC, DE, HL, SP.
+    */
+    template<uint8_t index>
+    RegisterPair& register16();
+
     bool isInterrupted();
     /**
      * Handles interrupts by saving relevant data such as SP and PC, then
@@ -337,6 +496,7 @@ private:
     FRIEND_TEST(CPU, Execute_LD_SP_D16_Instruction);
     FRIEND_TEST(CPU, FUNDAMENTAL_FUNCTIONS);
     FRIEND_TEST(CPU, sixteen_bit_ops);
+    FRIEND_TEST(CPU, idle_loop_detection_in_hram);
     FRIEND_TEST(PPU, Print_test_rom);
     FRIEND_TEST(PPU, g_tile_rom);
 };
@@ -10,6 +10,10 @@
 #define MAX_WINDOW_SIZE_MULTIPLIER 7
 #define MIN_EMULATION_SPEED_FLOAT 0.25f
 #define MAX_EMULATION_SPEED_FLOAT 16.f
+#define DEFAULT_REWIND_BUFFER_SIZE 8
+#define MAX_REWIND_BUFFER_SIZE 1024
+#define DEFAULT_REWIND_KEYFRAME_INTERVAL 60
+#define MAX_RUN_AHEAD_FRAMES 4
 #define PALETTE_AMOUNT 23
 #define KEY_INDEX_JOYPAD_START 0
 #define KEY_INDEX_SPECIAL_START 8
@@ -19,3 +23,6 @@
 #define TIMER_IF_BIT        (1 << 2)
 #define SERIAL_IF_BIT       (1 << 3)
 #define CONTROLLER_IF_BIT   (1 << 4)
+
+// Returned by devices that have no upcoming event to be scheduled
+#define NO_SCHEDULED_EVENT 0xffffffff
@@ -0,0 +1,27 @@
+#include "FrameInput.h"
+
+FrameInput::FrameInput() = default;
+
+void FrameInput::press(uint8_t key) {
+    uint8_t bit = 1 << key;
+    held |= bit;
+    pressed |= bit;
+    deferredReleases &= ~bit;
+}
+
+void FrameInput::release(uint8_t key) {
+    uint8_t bit = 1 << key;
+    if (pressed & bit) {
+        deferredReleases |= bit;
+    } else {
+        held &= ~bit;
+    }
+}
+
+uint8_t FrameInput::nextFrame() {
+    uint8_t keys = held;
+    held &= ~deferredReleases;
+    pressed = 0;
+    deferredReleases = 0;
+    return keys;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * This class turns key presses and releases into the keys held down during every frame, as passed to
+ * GameBoy::setJoypadState and recorded in an input movie. A key pressed during a frame is held down for at least
+ * that frame, releasing it in the same frame is deferred to the next one, so that a quick tap is not lost.
+ */
+class FrameInput {
+public:
+    FrameInput();
+
+    /**
+     * Presses a key, held down from the next frame on.
+     * @param key number of the key, JOYPAD_RIGHT to JOYPAD_START.
+     */
+    void press(uint8_t key);
+
+    /**
+     * Releases a key, from the next frame on if it was pressed since the last call to nextFrame.
+     * @param key number of the key, JOYPAD_RIGHT to JOYPAD_START.
+     */
+    void release(uint8_t key);
+
+    /**
+     * Returns the keys held down during the next frame, and applies the releases deferred until after it.
+     * @return one bit per key, as passed to GameBoy::setJoypadState.
+     */
+    uint8_t nextFrame();
+
+private:
+    uint8_t held{0};
+    // Keys pressed since the last frame, and those of them released again
+    uint8_t pressed{0};
+    uint8_t deferredReleases{0};
+};
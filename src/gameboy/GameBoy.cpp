@@ -1,6 +1,7 @@
 #include "GameBoy.h"
 #include "APU/APU.h"
 
+#include <algorithm> // min
 #include <iostream>
 
 GameBoy::GameBoy() {
@@ -14,34 +15,76 @@ GameBoy::GameBoy() {
     ppu = std::make_shared<PPU>(mmu);
     apu = std::make_shared<APU>();
     mmu->linkDevices(ppu, apu, joypad, timer, cartridge);
+    scheduler = std::make_shared<Scheduler>(ppu, apu, timer);
+    mmu->linkScheduler(scheduler);
     on = false;
+    idleLoopSkipping = false;
+    idleLoopSkippedCycles = 0;
 }
-void GameBoy::step(IVolumeController *vc) {
+
+GameBoy::~GameBoy() {
+    // The devices and the MMU reference each other
+    mmu->unlinkDevices();
+}
+
+void GameBoy::step(IAudioOutput *audioOutput) {
     if (!on) {
         return;
     }
-    if (cpu->getStop()) {
-        if ( ~mmu->read(JOYPAD) & 0x0f) {
-            cpu->returnFromStop();
+    scheduler->setAudioOutput(audioOutput);
+
+    // Run the CPU until it reaches an event, when the other units have been updated
+    bool eventReached = false;
+    while (!eventReached) {
+        if (cpu->getStop()) {
+            if ( ~mmu->read(JOYPAD) & 0x0f) {
+                cpu->returnFromStop();
+            }
+        }
+        // A halted CPU skips ahead to the next event, as only events request interrupts
+        eventReached = scheduler->advance(cpu->update(scheduler->cyclesUntilNextEvent()));
+
+        if (idleLoopSkipping) {
+            int iterationCycles = cpu->getIdleLoopCycles();
+            if (iterationCycles && !eventReached) {
+                eventReached = skipIdleLoop(iterationCycles);
+            }
         }
     }
+}
 
+bool GameBoy::skipIdleLoop(int iterationCycles) {
+    // The polled registers do not change until the next event, except for the timer registers
+    uint32_t cyclesUntilChange = scheduler->cyclesUntilNextEvent();
+    if (cpu->idleLoopReadsTimer()) {
+        scheduler->synchronize();
+        cyclesUntilChange = std::min(cyclesUntilChange, timer->cyclesUntilRegisterChange());
+    }
 
-    int cycles = cpu->update();
-    ppu->update(cycles);
-    apu->update(cycles, vc);
-    timer->update(cycles);
-    cartridge->update(cycles);
+    // Only whole iterations can be skipped
+    uint32_t skippedCycles = cyclesUntilChange - cyclesUntilChange % iterationCycles;
+    if (skippedCycles == 0) {
+        return false;
+    }
+    idleLoopSkippedCycles += skippedCycles;
+    return scheduler->advance(skippedCycles);
 }
 
 std::unique_ptr<uint8_t[]> GameBoy::getScreenTexture() {
-    auto ppuFrameBuffer = ppu->getFrameBuffer();
-    auto texture = std::make_unique<uint8_t[]>(ppuFrameBuffer->size());
+    auto texture = std::make_unique<uint8_t[]>(LCD_WIDTH * LCD_HEIGHT);
+    getScreenTexture(texture.get());
+    return texture;
+}
+
+const uint8_t* GameBoy::getFrameBuffer() const {
+    return ppu->getFrameBuffer()->data();
+}
 
+void GameBoy::getScreenTexture(uint8_t *texture) const {
+    auto ppuFrameBuffer = ppu->getFrameBuffer();
     for (int i = 0; i < ppuFrameBuffer->size(); i++) {
         texture[i] = 0xFF - (ppuFrameBuffer->at(i) * 0x55);
     }
-    return texture;
 }
 
 void GameBoy::joypadInput(uint8_t key, uint8_t action) {
@@ -58,21 +101,33 @@ void GameBoy::joypadInput(uint8_t key, uint8_t action) {
     }
 }
 
-void GameBoy::loadRom(std::string bootFilepath, std::string romFilepath) {
+uint8_t GameBoy::getJoypadState() const {
+    return joypad->getPressed();
+}
+
+void GameBoy::setJoypadState(uint8_t keys) {
+    joypad->setPressed(keys);
+}
+
+void GameBoy::loadRom(std::string bootFilepath, std::string romFilepath, bool loadSaveFile) {
     cpu->reset();
     ppu->reset();
     apu->reset();
     mmu->reset();
     timer->reset();
     joypad->reset();
+    scheduler->reset();
+    idleLoopSkippedCycles = 0;
     if (!mmu->loadBootRom(bootFilepath)) {
         cpu->skipBootRom();
     }
-    on = cartridge->loadRom(romFilepath, true);
+    on = cartridge->loadRom(romFilepath, loadSaveFile);
+    mmu->updatePageTable();
 }
 
 void GameBoy::loadGameRom(std::string filepath) {
     cartridge->loadRom(filepath);
+    mmu->updatePageTable();
 }
 
 void GameBoy::loadBootRom(std::string filepath) {
@@ -95,22 +150,116 @@ bool GameBoy::isOn() const {
     return on;
 }
 
+bool GameBoy::isBooting() const {
+    return on && mmu->isBooting();
+}
+
 bool GameBoy::save() {
-    // Save RAM to separate file
+    // Save RAM to separate file, with the RTC up to date
+    cartridge->setCycles(scheduler->getCycles());
     if (!cartridge->saveRam()) {
         return false;
     }
     return true;
 }
 
-uint8_t GameBoy::isReadyToPlaySound() {
-    return apu->isReadyToPlaySound();
+void GameBoy::setIdleLoopSkipping(bool enabled) {
+    idleLoopSkipping = enabled;
+    cpu->setIdleLoopDetection(enabled);
+}
+
+void GameBoy::setRenderSkipping(bool enabled) {
+    ppu->setRenderSkipping(enabled);
+}
+
+uint64_t GameBoy::getIdleLoopSkippedCycles() const {
+    return idleLoopSkippedCycles;
+}
+
+uint64_t GameBoy::getCycles() const {
+    return scheduler->getCycles();
 }
 
-void GameBoy::confirmPlay() {
-    apu->confirmPlay();
+const uint8_t* GameBoy::getWorkRam() const {
+    return mmu->getWram();
 }
 
-APUState *GameBoy::getAPUState() {
-    return apu->getAPUState();
+const std::string& GameBoy::getSerialOutput() const {
+    return mmu->getSerialOutput();
+}
+
+void GameBoy::truncateSerialOutput(size_t length) {
+    mmu->truncateSerialOutput(length);
+}
+
+uint64_t GameBoy::getRomHash() const {
+    return on ? cartridge->getRomHash() : 0;
+}
+
+size_t GameBoy::saveStateSize() const {
+    StateWriter writer(nullptr, 0);
+    writeState(writer);
+    return writer.getSize();
+}
+
+size_t GameBoy::saveState(uint8_t *buffer, size_t size) {
+    if (!on) {
+        return 0;
+    }
+    // Bring every unit up to date with the CPU so that no cycles are pending
+    scheduler->synchronize();
+
+    StateWriter writer(buffer, size);
+    writeState(writer);
+    if (writer.isOverflowed()) {
+        std::cerr << "Buffer of " << size << " bytes is too small for save state" << std::endl;
+        return 0;
+    }
+    return writer.getSize();
+}
+
+bool GameBoy::loadState(const uint8_t *buffer, size_t size) {
+    if (!on) {
+        return false;
+    }
+    StateReader reader(buffer, size);
+    auto magic = reader.read<uint32_t>();
+    auto version = reader.read<uint32_t>();
+    if (magic != SAVE_STATE_MAGIC || version != SAVE_STATE_VERSION) {
+        std::cerr << "Save state is invalid or from another version" << std::endl;
+        return false;
+    }
+    // The size only depends on the game, which rejects truncated save states
+    if (size != saveStateSize()) {
+        std::cerr << "Save state has wrong size" << std::endl;
+        return false;
+    }
+    if (!cartridge->loadState(reader)) {
+        return false;
+    }
+
+    cpu->loadState(reader);
+    mmu->loadState(reader);
+    ppu->loadState(reader);
+    apu->loadState(reader);
+    timer->loadState(reader);
+    joypad->loadState(reader);
+
+    mmu->updatePageTable();
+    scheduler->reset();
+    scheduler->reschedule();
+    return true;
+}
+
+void GameBoy::writeState(StateWriter &writer) const {
+    writer.write<uint32_t>(SAVE_STATE_MAGIC);
+    writer.write<uint32_t>(SAVE_STATE_VERSION);
+
+    cartridge->saveState(writer);
+    cpu->saveState(writer);
+    mmu->saveState(writer);
+    ppu->saveState(writer);
+    apu->saveState(writer);
+    timer->saveState(writer);
+    joypad->saveState(writer);
 }
\ No newline at end of file
@@ -8,8 +8,8 @@
 #include "Joypad.h"
 #include "MMU/Timer.h"
 #include "MMU/Cartridge.h"
-#include "APU/IVolumeController.h"
-#include "APU/APUState.h"
+#include "Scheduler.h"
+#include "APU/IAudioOutput.h"
 
 
 #define FRIEND_TEST(test_case_name, test_name)\
@@ -25,29 +25,51 @@ friend class test_case_name##_##test_name##_Test
 class GameBoy {
 public:
     GameBoy();
+    ~GameBoy();
     /**
-     * Steps the emulation the equivalent machine cycles of one CPU-instruction.
-     * All other units are synchronized to the execution of the CPU-instructions.
-     * @param vc is used to alter volume.
+     * Steps the emulation by executing CPU-instructions until the next scheduled event of another unit.
+     * All other units are synchronized to the execution of the CPU-instructions through the scheduler.
+     * @param audioOutput receives the samples synthesized by the APU, or nullptr if no sound is needed.
      * */
-    void step(IVolumeController* vc);
+    void step(IAudioOutput* audioOutput);
     /**
      * @return the screen buffer to be drawn next frame from the PPU.
      */
     std::unique_ptr<uint8_t[]> getScreenTexture();
+    /**
+     * Writes the screen buffer to be drawn next frame from the PPU, without allocating memory.
+     * @param texture memory of LCD_WIDTH * LCD_HEIGHT bytes to write to.
+     */
+    void getScreenTexture(uint8_t* texture) const;
+    /**
+     * Returns the frame buffer of the PPU, one color number (0-3) per pixel where 0 is the lightest.
+     * Unlike getScreenTexture no conversion or copy is made, the frame buffer changes as the emulation is stepped.
+     */
+    const uint8_t* getFrameBuffer() const;
     /**
      * Handles the joypad input and redirects it to the Joypad to handle.
      * @param key which key has changed.
      * @param action if the action was press or release.
      * */
     void joypadInput(uint8_t key, uint8_t action);
+    /**
+     * Returns the joypad keys held down, bit n is set if key n (JOYPAD_RIGHT to JOYPAD_START) is pressed.
+     * */
+    uint8_t getJoypadState() const;
+    /**
+     * Presses and releases joypad keys so that exactly the given keys are held down.
+     * @param keys one bit per key, as returned by getJoypadState.
+     * */
+    void setJoypadState(uint8_t keys);
     /**
      * Resets the emulation and loads new boot and game ROMs.
      * If no or an invalid boot ROM is provided, the boot phase is skipped.
      * @param bootFilepath path to boot ROM.
      * @param romFilepath path to game ROM.
+     * @param loadSaveFile whether to load the xRAM and RTC saved next to the game ROM. Without it, the emulation
+     * does not depend on anything but the ROMs and the input, which makes runs reproducible.
      * */
-    void loadRom(std::string bootFilepath, std::string romFilepath);
+    void loadRom(std::string bootFilepath, std::string romFilepath, bool loadSaveFile = true);
     /**
      * Loads game ROM.
      * @param path to game ROM.
@@ -74,6 +96,10 @@ public:
      * Returns a bool depending on if the emulator is turned on or off.
      * */
     bool isOn() const;
+    /**
+     * Returns whether the boot ROM is still running, which is not part of a save state.
+     * */
+    bool isBooting() const;
     /**
      * Saves RAM-data to a file, this used in games which have XRAM which is battery powered, and hence supplies
      *  an option for the player to save game progress.
@@ -81,26 +107,96 @@ public:
     * */
     bool save();
 
-  /**
-   * Indicates if the state of the APU has changed, meaning the audio output should change
-   * @return bit x == 1 -> source x has changed and the output should change
-   */
-    uint8_t isReadyToPlaySound();
+    /**
+     * Enables or disables skipping of idle loops, short loops where the CPU polls LY, STAT, IF or the timer
+     * registers waiting for them to change. The skipped iterations take the same amount of emulated time as
+     * executing them would, so the result of the emulation does not change. Disabled by default.
+     * @param enabled whether idle loops should be skipped.
+     */
+    void setIdleLoopSkipping(bool enabled);
+
+    /**
+     * Enables or disables skipping of drawing frames, for frames that will not be displayed.
+     * The emulation continues as usual, including timing and interrupts of the PPU, but the frame buffer
+     * keeps the last frame that was drawn. Disabled by default.
+     * @param enabled whether frames should be skipped.
+     */
+    void setRenderSkipping(bool enabled);
+
+    /**
+     * Returns the number of machine cycles that have passed in skipped idle loops since the ROM was loaded.
+     * Useful for profiling.
+     */
+    uint64_t getIdleLoopSkippedCycles() const;
+
+    /**
+     * Returns the number of machine cycles emulated since the ROM, or the latest save state, was loaded.
+     */
+    uint64_t getCycles() const;
+
+    /**
+     * Returns the work RAM, WRAM_END - WRAM_START + 1 bytes, as it is at the moment.
+     */
+    const uint8_t* getWorkRam() const;
+
+    /**
+     * Returns every byte sent over the serial port since the ROM was loaded.
+     * Test ROMs, such as the ones by Blargg, print their results this way.
+     */
+    const std::string& getSerialOutput() const;
 
     /**
-     * Resets the value returned from isReadyToPlaySound
+     * Removes the bytes sent over the serial port after the first ones. Save states do not include the serial
+     * output, so this undoes it when the emulation is restored to an earlier state.
+     * @param length number of bytes to keep.
      */
-    void confirmPlay();
+    void truncateSerialOutput(size_t length);
 
     /**
-     * Returns the relevant information audio all audio channels
-     * Make sure to delete the state afterwards in order to prevent memory leaks
-     * @return the state of the APU
+     * Returns the hash of the loaded game ROM, which identifies the game, or 0 if no game is loaded.
      */
-    APUState* getAPUState();
+    uint64_t getRomHash() const;
+
+    /**
+     * Returns the number of bytes needed to hold a save state of the loaded game.
+     * The size only changes when another game is loaded.
+     */
+    size_t saveStateSize() const;
+
+    /**
+     * Saves the complete state of the emulation into a buffer, without allocating any memory.
+     * @param buffer memory to write the save state to.
+     * @param size size of buffer in bytes, should be at least saveStateSize().
+     * @return the number of bytes written, or 0 if no game is loaded or the buffer is too small.
+     */
+    size_t saveState(uint8_t* buffer, size_t size);
+
+    /**
+     * Restores the emulation to a state saved by saveState. Save states are only valid for the game,
+     * and the version of the emulator, they were saved with.
+     * @param buffer memory to read the save state from.
+     * @param size size of the save state in bytes.
+     * @return true if the state was restored, false if it was rejected, in which case nothing is changed.
+     */
+    bool loadState(const uint8_t* buffer, size_t size);
 
 private:
     bool on;
+    bool idleLoopSkipping;
+    uint64_t idleLoopSkippedCycles;
+
+    /**
+     * Passes the iterations of an idle loop that will behave the same as the one just completed.
+     * @param iterationCycles machine cycles of one iteration.
+     * @return true if an event was reached.
+     */
+    bool skipIdleLoop(int iterationCycles);
+
+    /**
+     * Writes the header and the state of every unit. Also used to count the size of a save state.
+     * @param writer save state to write to.
+     */
+    void writeState(StateWriter& writer) const;
 
     std::shared_ptr<MMU> mmu;
     std::unique_ptr<CPU> cpu;
@@ -110,6 +206,7 @@ private:
     std::shared_ptr<Joypad> joypad;
     std::shared_ptr<Timer> timer;
     std::shared_ptr<Cartridge> cartridge;
+    std::shared_ptr<Scheduler> scheduler;
 
     FRIEND_TEST(PPU, g_tile_rom);
 };
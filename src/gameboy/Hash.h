@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef> // size_t
+#include <cstdint>
+#include <cstring> // memcpy
+
+#define HASH_OFFSET_BASIS   0xcbf29ce484222325
+#define HASH_PRIME          0x100000001b3
+
+/**
+ * A fast 64 bit hash, used to identify ROMs and to compare frames and memory between runs.
+ * It is FNV-1a, but taken a 64 bit word at a time rather than a byte at a time, so megabytes are hashed in
+ * milliseconds. Not suitable where collisions are made on purpose.
+ */
+class Hash {
+public:
+    /**
+     * Computes the hash of memory.
+     * @param data memory to hash
+     * @param size size in bytes
+     * @param seed hash of the memory before, to hash memory in parts
+     */
+    static uint64_t compute(const uint8_t* data, size_t size, uint64_t seed = HASH_OFFSET_BASIS) {
+        uint64_t result = seed;
+        size_t i = 0;
+        for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+            uint64_t word;
+            std::memcpy(&word, data + i, sizeof(word));
+            result = (result ^ word) * HASH_PRIME;
+        }
+        for (; i < size; i++) {
+            result = (result ^ data[i]) * HASH_PRIME;
+        }
+        return result;
+    }
+};
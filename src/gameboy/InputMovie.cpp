@@ -0,0 +1,143 @@
+#include "InputMovie.h"
+
+#include <algorithm> // upper_bound
+#include <fstream>
+#include <iostream>
+
+InputMovie::InputMovie() : romHash{0} {}
+
+bool InputMovie::startRecording(GameBoy &gameBoy) {
+    if (gameBoy.isBooting()) {
+        std::cerr << "Movie can not be recorded while booting" << std::endl;
+        return false;
+    }
+    std::vector<uint8_t> state(gameBoy.saveStateSize());
+    if (gameBoy.saveState(state.data(), state.size()) == 0 || !gameBoy.loadState(state.data(), state.size())) {
+        return false;
+    }
+    romHash = gameBoy.getRomHash();
+    startState = std::move(state);
+    runs.clear();
+    return true;
+}
+
+void InputMovie::recordFrame(uint8_t keys) {
+    if (!runs.empty() && runs.back().keys == keys) {
+        runs.back().end++;
+    } else {
+        runs.push_back({static_cast<uint32_t>(getFrameCount() + 1), keys});
+    }
+}
+
+bool InputMovie::startReplay(GameBoy &gameBoy) const {
+    if (gameBoy.getRomHash() != romHash) {
+        std::cerr << "Movie was recorded with another game" << std::endl;
+        return false;
+    }
+    return gameBoy.loadState(startState.data(), startState.size());
+}
+
+uint8_t InputMovie::getKeys(size_t frame) const {
+    // The first run ending after the frame
+    auto run = std::upper_bound(runs.begin(), runs.end(), frame, [](size_t frame, const Run& run) {
+        return frame < run.end;
+    });
+    return run != runs.end() ? run->keys : 0;
+}
+
+size_t InputMovie::getFrameCount() const {
+    return runs.empty() ? 0 : runs.back().end;
+}
+
+uint64_t InputMovie::getRomHash() const {
+    return romHash;
+}
+
+bool InputMovie::save(const std::string &path) const {
+    auto write = [this](StateWriter& writer) {
+        writer.write<uint32_t>(INPUT_MOVIE_MAGIC);
+        writer.write<uint32_t>(INPUT_MOVIE_VERSION);
+        writer.write(romHash);
+        writer.write(static_cast<uint32_t>(startState.size()));
+        writer.writeBytes(startState.data(), startState.size());
+        writer.write(static_cast<uint32_t>(runs.size()));
+        uint32_t start = 0;
+        for (const Run& run : runs) {
+            writer.write(run.end - start);
+            writer.write(run.keys);
+            start = run.end;
+        }
+    };
+    StateWriter counter(nullptr, 0);
+    write(counter);
+    std::vector<uint8_t> contents(counter.getSize());
+    StateWriter writer(contents.data(), contents.size());
+    write(writer);
+
+    std::ofstream file(path, std::ios::out | std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Unable to open file: " << path << std::endl;
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(contents.data()), contents.size());
+    return static_cast<bool>(file);
+}
+
+bool InputMovie::load(const std::string &path) {
+    std::ifstream file(path, std::ios::in | std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        std::cerr << "Unable to open file: " << path << std::endl;
+        return false;
+    }
+    std::vector<uint8_t> contents(static_cast<size_t>(file.tellg()));
+    file.seekg(0, std::ios::beg);
+    file.read(reinterpret_cast<char*>(contents.data()), contents.size());
+    if (!file) {
+        std::cerr << "Unable to read file: " << path << std::endl;
+        return false;
+    }
+
+    StateReader reader(contents.data(), contents.size());
+    auto magic = reader.read<uint32_t>();
+    auto version = reader.read<uint32_t>();
+    if (magic != INPUT_MOVIE_MAGIC || version != INPUT_MOVIE_VERSION) {
+        std::cerr << "Movie is invalid or from another version: " << path << std::endl;
+        return false;
+    }
+    auto hash = reader.read<uint64_t>();
+    // Sizes are checked against the file before anything is allocated
+    auto stateSize = reader.read<uint32_t>();
+    if (stateSize > contents.size()) {
+        std::cerr << "Movie is truncated: " << path << std::endl;
+        return false;
+    }
+    std::vector<uint8_t> state(stateSize);
+    reader.readBytes(state.data(), state.size());
+    auto runCount = reader.read<uint32_t>();
+    if (runCount > contents.size()) {
+        std::cerr << "Movie is truncated: " << path << std::endl;
+        return false;
+    }
+    std::vector<Run> frames;
+    frames.reserve(runCount);
+    uint32_t end = 0;
+    for (uint32_t i = 0; i < runCount; i++) {
+        auto length = reader.read<uint32_t>();
+        auto keys = reader.read<uint8_t>();
+        if (length == 0 || end + length < end) {
+            std::cerr << "Movie has invalid frames: " << path << std::endl;
+            return false;
+        }
+        end += length;
+        frames.push_back({end, keys});
+    }
+    if (reader.isUnderflowed()) {
+        std::cerr << "Movie is truncated: " << path << std::endl;
+        return false;
+    }
+
+    romHash = hash;
+    startState = std::move(state);
+    runs = std::move(frames);
+    return true;
+}
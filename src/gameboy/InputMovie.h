@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef> // size_t
+#include <string>
+#include <vector>
+
+#include "GameBoy.h"
+
+// Increase whenever the layout of a movie file changes, old movies are then rejected
+#define INPUT_MOVIE_VERSION 1
+#define INPUT_MOVIE_MAGIC   0x564d424c // "LBMV"
+
+/**
+ * This class holds a recording of the joypad input to a game, the keys held down during every frame, from a save
+ * state the recording starts at. The frames are run-length encoded, as the keys held down rarely change from one
+ * frame to the next. As the emulation only depends on the game, the start state and the input, replaying a movie
+ * gives exactly the same frames as the recording, also on another machine.
+ */
+class InputMovie {
+public:
+    InputMovie();
+
+    /**
+     * Starts a new recording from the current state of the GameBoy, removing all frames.
+     * The state is saved and loaded back, so the recording continues from exactly the state a replay starts from.
+     * A recording can not start while the boot ROM runs, as the boot ROM is not saved with the state.
+     * @param gameBoy the emulator to record, with a game loaded.
+     * @return false if the state could not be saved or the GameBoy is booting.
+     */
+    bool startRecording(GameBoy& gameBoy);
+
+    /**
+     * Appends a frame to the recording. Should be called before the frame is emulated.
+     * @param keys the keys held down during the frame, as returned by GameBoy::getJoypadState.
+     */
+    void recordFrame(uint8_t keys);
+
+    /**
+     * Restores the GameBoy to the state the movie starts at.
+     * @param gameBoy the emulator to replay on, with the game of the movie loaded.
+     * @return false if another game is loaded or the start state is rejected.
+     */
+    bool startReplay(GameBoy& gameBoy) const;
+
+    /**
+     * Returns the keys held down during a frame, as passed to GameBoy::setJoypadState.
+     * @param frame number of the frame, counted from the start state.
+     */
+    uint8_t getKeys(size_t frame) const;
+
+    /**
+     * Returns the number of frames recorded.
+     */
+    size_t getFrameCount() const;
+
+    /**
+     * Returns the hash of the game ROM the movie was recorded with.
+     */
+    uint64_t getRomHash() const;
+
+    /**
+     * Writes the movie to a file.
+     * @param path path of the file.
+     * @return false if the file could not be written.
+     */
+    bool save(const std::string& path) const;
+
+    /**
+     * Reads a movie written by save, replacing the frames and the start state.
+     * @param path path of the file.
+     * @return false if the file could not be read or is invalid, in which case nothing is changed.
+     */
+    bool load(const std::string& path);
+
+private:
+    struct Run {
+        // Number of frames up to and including the run
+        uint32_t end;
+        uint8_t keys;
+    };
+
+    uint64_t romHash;
+    std::vector<uint8_t> startState;
+    std::vector<Run> runs;
+};
@@ -49,3 +49,25 @@ void Joypad::press(uint8_t button) {
     mmu->raiseInterruptFlag(CONTROLLER_IF_BIT);
 }
 
+uint8_t Joypad::getPressed() const {
+    return ~joypad;
+}
+
+void Joypad::setPressed(uint8_t buttons) {
+    uint8_t pressed = buttons & joypad;
+    joypad = ~buttons;
+    if (pressed) {
+        // Raise interrupt flag
+        mmu->raiseInterruptFlag(CONTROLLER_IF_BIT);
+    }
+}
+
+void Joypad::saveState(StateWriter &writer) const {
+    writer.write(joypadSelect);
+    writer.write(joypad);
+}
+
+void Joypad::loadState(StateReader &reader) {
+    reader.read(joypadSelect);
+    reader.read(joypad);
+}
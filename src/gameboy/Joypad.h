@@ -3,6 +3,7 @@
 
 #include <cstdint>
 #include <memory> //ptr
+#include "SaveState.h"
 
 #define JOYPAD                  0xff00
 #define JOYPAD_SEL_BUTTONS      0x10
@@ -57,6 +58,27 @@ public:
      * @param button to set.
      * */
     void press(uint8_t button);
+    /**
+     * Returns the buttons held down, one bit per button where bit n is set if button n is pressed.
+     * */
+    uint8_t getPressed() const;
+    /**
+     * Presses and releases buttons so that exactly the given buttons are held down. Only buttons that were
+     * not already held down are pressed, and raise the interrupt.
+     * @param buttons one bit per button, as returned by getPressed.
+     * */
+    void setPressed(uint8_t buttons);
+    /**
+     * Write the state of the Joypad to a save state.
+     * @param writer save state to write to
+     */
+    void saveState(StateWriter& writer) const;
+
+    /**
+     * Restore the state of the Joypad from a save state.
+     * @param reader save state to read from
+     */
+    void loadState(StateReader& reader);
 
 private:
     // MMU used to set interrupt flags
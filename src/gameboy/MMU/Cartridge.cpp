@@ -1,7 +1,7 @@
 
 #include "Cartridge.h"
 #include <iostream>
-#include <cstring> // memcpy
+#include <cstring> // memcmp
 #include <string>
 
 
@@ -13,9 +13,12 @@ void Cartridge::reset() {
     cartridgeType = 0;
     romSize = 0;
     ramSize = 0;
+    cycles = 0;
 
-    rom = std::vector<uint8_t>(0x8000);
-    mbc = std::make_unique<ROM_Only_MBC>(&rom);
+    // Not shared, so that tests can write to it
+    testRom = std::make_shared<RomImage>(0x8000);
+    rom = testRom;
+    mbc = std::make_unique<ROM_Only_MBC>(rom->data());
 }
 
 uint8_t Cartridge::read(uint16_t addr) const {
@@ -27,52 +30,60 @@ void Cartridge::write(uint16_t addr, uint8_t data) {
 }
 
 void Cartridge::writeTest(uint16_t addr, uint8_t data) {
-    rom.at(addr) = data;
+    uint8_t* memory = testRom ? testRom->writableData() : nullptr;
+    if (memory && addr < testRom->size()) {
+        memory[addr] = data;
+    } else {
+        std::cout << "Tried to write to a game ROM loaded from file. addr: " << (int)addr << std::endl;
+    }
 }
 
 bool Cartridge::loadRom(const std::string& filepath, bool load_ram_from_file) {
     this->filepath = filepath;
-    std::streampos size;
-
-    std::ifstream file (filepath, std::ios::in|std::ios::binary|std::ios::ate);
-    if (file.is_open())
-    {
-        // Get file size
-        size = file.tellg();
-        std::unique_ptr<char[]> memblock(new char[size]);
-
-        // Move seeker to beginning of file
-        file.seekg (0, std::ios::beg);
-        // Read file to buffer
-        file.read (memblock.get(), size);
-        // Close file
-        file.close();
+    // The scheduler restarts counting cycles when a game is loaded
+    cycles = 0;
 
-        // Set ROM/RAM size
-        romSize = memblock[0x148];
-        if (!initRom()) return false;
+    // The file is mapped into memory rather than copied where possible, and shared if it is already loaded
+    std::unique_ptr<RomImage> image = std::make_unique<RomImage>(0);
+    if (!image->loadFile(filepath)) {
+        std::cout << "Unable to open game ROM: " << filepath << std::endl;
+        return false;
+    }
+    if (image->size() < CARTRIDGE_HEADER_END) {
+        std::cout << "Game ROM is too small to have a header: " << filepath << std::endl;
+        return false;
+    }
 
-        ramSize = memblock[0x149];
-        if (!initRam(load_ram_from_file)) return false;
+    // Set ROM/RAM size
+    romSize = image->data()[0x148];
+    if (!initRom(*image)) return false;
+    // Cartridges running the same game share its rom
+    rom = RomImage::share(std::move(image));
+    testRom.reset();
+    // The previous mbc mapped the previous rom, replace it in case the type is not supported
+    mbc = std::make_unique<ROM_Only_MBC>(rom->data());
 
-        // Check cartridge type
-        cartridgeType = memblock[0x147];
-        if (!initMbc()) return false;
+    ramSize = rom->data()[0x149];
+    if (!initRam()) return false;
 
-        // Copy data
-        std::memcpy(&rom.at(rom.size() - size), &memblock[0], size);
+    // Check cartridge type once the rom and ram are allocated, as the mbc maps them
+    cartridgeType = rom->data()[0x147];
+    if (!initMbc()) return false;
 
-        return true;
-    }
-    else {
-        std::cout << "Unable to open game ROM: " << filepath << std::endl;
-        return false;
+    // Load the ram after the mbc is created, as the mbc restores the rtc saved with it
+    if (load_ram_from_file) {
+        if (!loadRam()) {
+            std::cout << "Could not load extended RAM from file!" << std::endl;
+        } else {
+            std::cout << "Extended RAM loaded from file!" << std::endl;
+        }
     }
+    return true;
 }
 
 bool Cartridge::saveRam() {
     // Return if Cartridge have no RAM
-    if (ramSize == Cartridge::RAM_NO_RAM) {
+    if (ramSize == Cartridge::RAM_NO_RAM && !hasRtc()) {
         return true;
     }
     // Create file
@@ -82,7 +93,10 @@ bool Cartridge::saveRam() {
         return false;
     }
     // Write to file
-    wfile.write(reinterpret_cast<const char *>(ram.data()), ram.size());
+    if (ramSize != Cartridge::RAM_NO_RAM) {
+        wfile.write(reinterpret_cast<const char *>(ram.data()), ram.size());
+    }
+    mbc->saveRtc(wfile);
     wfile.close();
 
     if(!wfile.good()) {
@@ -94,7 +108,7 @@ bool Cartridge::saveRam() {
 
 bool Cartridge::loadRam() {
     // Return if Cartridge should not have RAM
-    if (ramSize == Cartridge::RAM_NO_RAM) {
+    if (ramSize == Cartridge::RAM_NO_RAM && !hasRtc()) {
         return true;
     }
 
@@ -105,7 +119,12 @@ bool Cartridge::loadRam() {
         // Get file size
         size = rfile.tellg();
 
-        if (size != ram.size()) {
+        // The rtc is optional, files saved before it was supported only hold the ram
+        auto fileBytes = static_cast<size_t>(size);
+        size_t ramBytes = ramSize == Cartridge::RAM_NO_RAM ? 0 : ram.size();
+        size_t rtcBytes = fileBytes > ramBytes ? fileBytes - ramBytes : 0;
+        bool validRtc = rtcBytes == 0 || (hasRtc() && (rtcBytes == RTC_SAVE_SIZE || rtcBytes == RTC_SAVE_SIZE_32));
+        if (fileBytes < ramBytes || !validRtc) {
             std::cout << "Savefile: " << filepath + ".sav" << " has wrong file size" << std::endl;
             return false;
         }
@@ -113,7 +132,10 @@ bool Cartridge::loadRam() {
         // Move seeker to beginning of file
         rfile.seekg (0, std::ios::beg);
         // Read file to ram
-        rfile.read (reinterpret_cast<char *>(ram.data()), size);
+        rfile.read (reinterpret_cast<char *>(ram.data()), ramBytes);
+        if (rtcBytes != 0) {
+            mbc->loadRtc(rfile, rtcBytes);
+        }
         // Close file
         rfile.close();
 
@@ -125,46 +147,52 @@ bool Cartridge::loadRam() {
     }
 }
 
-bool Cartridge::initRom() {
+bool Cartridge::initRom(RomImage& image) {
+    size_t size;
     switch (romSize)
     {
         case ROM_32KB:
-            rom = std::vector<uint8_t>(0x8000);
+            size = 0x8000;
             break;
         case ROM_64KB:
-            rom = std::vector<uint8_t>(0x10000);
+            size = 0x10000;
             break;
         case ROM_128KB:
-            rom = std::vector<uint8_t>(0x20000);
+            size = 0x20000;
             break;
         case ROM_256KB:
-            rom = std::vector<uint8_t>(0x40000);
+            size = 0x40000;
             break;
         case ROM_512KB:
-            rom = std::vector<uint8_t>(0x80000);
+            size = 0x80000;
             break;
         case ROM_1MB:
-            rom = std::vector<uint8_t>(0x100000);
+            size = 0x100000;
             break;
         case ROM_2MB:
-            rom = std::vector<uint8_t>(0x200000);
+            size = 0x200000;
             break;
         case ROM_4MB:
-            rom = std::vector<uint8_t>(0x400000);
+            size = 0x400000;
             break;
         case ROM_8MB:
-            rom = std::vector<uint8_t>(0x800000);
+            size = 0x800000;
             break;
 
         default:
             std::cout << "Invalid or unsupported ROM size: " << (int)romSize << std::endl;
             return false;
     }
+    // A file smaller than its ROM size is placed at the end of the ROM
+    if (!image.resize(size)) {
+        std::cout << "Game ROM is larger than its ROM size: " << (int)romSize << std::endl;
+        return false;
+    }
     std::cout << "ROM size: " << (int)romSize << std::endl;
     return true;
 }
 
-bool Cartridge::initRam(bool loadFromRam) {
+bool Cartridge::initRam() {
     switch (ramSize)
     {
         case RAM_NO_RAM:
@@ -186,13 +214,6 @@ bool Cartridge::initRam(bool loadFromRam) {
             std::cout << "Invalid or unsupported RAM size: "<< (int)ramSize << std::endl;
             return false;
     }
-    if (loadFromRam) {
-        if (!loadRam()) {
-            std::cout << "Could not load extended RAM from file!" << std::endl;
-        } else {
-            std::cout << "Extended RAM loaded from file!" << std::endl;
-        }
-    }
     std::cout << "RAM size: "<< (int)ramSize << std::endl;
     return true;
 }
@@ -200,19 +221,19 @@ bool Cartridge::initRam(bool loadFromRam) {
 bool Cartridge::initMbc() {
     switch (cartridgeType) {
         case ROM_ONLY:
-            mbc = std::make_unique<ROM_Only_MBC>(&rom);
+            mbc = std::make_unique<ROM_Only_MBC>(rom->data());
             break;
         case MBC1:
         case MBC1_R:
         case MBC1_R_B:
-            mbc = std::make_unique<MBC1_MBC>(&rom, &ram);
+            mbc = std::make_unique<MBC1_MBC>(rom->data(), rom->size(), &ram);
             break;
         case MBC3_T_B:
         case MBC3_T_R_B:
         case MBC3:
         case MBC_R:
         case MBC_R_B:
-            mbc = std::make_unique<MBC3_MBC>(&rom, &ram);
+            mbc = std::make_unique<MBC3_MBC>(rom->data(), rom->size(), &ram, &cycles, hasRtc());
             break;
 
         default:
@@ -223,6 +244,58 @@ bool Cartridge::initMbc() {
     return true;
 }
 
-void Cartridge::update(uint8_t cycles) {
-    mbc->update(cycles);
+bool Cartridge::hasRtc() const {
+    return cartridgeType == MBC3_T_B || cartridgeType == MBC3_T_R_B;
+}
+
+void Cartridge::setCycles(uint64_t cycles) {
+    this->cycles = cycles;
+}
+
+const uint8_t* Cartridge::romBank0() const {
+    return mbc->romBank0();
+}
+
+const uint8_t* Cartridge::romBankN() const {
+    return mbc->romBankN();
+}
+
+uint8_t* Cartridge::ramBank() const {
+    return mbc->ramBank();
+}
+
+uint64_t Cartridge::getRomHash() const {
+    return rom->getHash();
+}
+
+void Cartridge::saveState(StateWriter &writer) const {
+    saveIdentity(writer);
+    writer.writeBytes(ram.data(), ram.size());
+    mbc->saveState(writer);
+}
+
+bool Cartridge::loadState(StateReader &reader) {
+    uint8_t savedIdentity[CARTRIDGE_IDENTITY_SIZE];
+    uint8_t identity[CARTRIDGE_IDENTITY_SIZE];
+    StateWriter identityWriter(identity, sizeof(identity));
+    saveIdentity(identityWriter);
+    reader.readBytes(savedIdentity, sizeof(savedIdentity));
+    if (reader.isUnderflowed() || std::memcmp(savedIdentity, identity, sizeof(identity)) != 0) {
+        std::cout << "Save state does not belong to the loaded game" << std::endl;
+        return false;
+    }
+
+    reader.readBytes(ram.data(), ram.size());
+    // The scheduler restarts counting cycles after a save state is loaded
+    cycles = 0;
+    mbc->loadState(reader);
+    return true;
+}
+
+void Cartridge::saveIdentity(StateWriter &writer) const {
+    writer.write(cartridgeType);
+    writer.write(romSize);
+    writer.write(ramSize);
+    // Header checksum and global checksum
+    writer.writeBytes(rom->data() + 0x14d, 3);
 }
@@ -1,14 +1,22 @@
 #pragma once
 
 #include "MBC.h"
+#include "RomImage.h"
+#include "../SaveState.h"
 #include <cstdint>
 #include <vector> //vector
 #include <memory> // ptr
 #include <fstream>
 
+// Bytes written by Cartridge::saveIdentity
+#define CARTRIDGE_IDENTITY_SIZE 6
+// End of the cartridge header, the smallest valid game ROM
+#define CARTRIDGE_HEADER_END    0x150
+
 /**
  * This class emulates a Game Boy cartridge. A ROM-file can be loaded with associated XRAM-file.
- * The XRAM is saved back to file when the application is closed.
+ * The ROM is shared with the other cartridges in the process running the same game, while the XRAM and MBC are not.
+ * The XRAM, and the RTC if the cartridge has one, is saved back to file when the application is closed.
  * The cartridge is initialized to use the MBC specified in the ROM-file.
  */
 class Cartridge {
@@ -35,14 +43,15 @@ public:
 
     /**
      * Write directly to the rom at the specified address.
-     * To be used only in testing.
+     * To be used only in testing, before a rom file is loaded.
      * @param addr address to write to
      * @param data data to write
      */
     void writeTest(uint16_t addr, uint8_t data);
 
     /**
-     * Load a rom file into memory.
+     * Load a rom file into memory. The file is mapped into memory where possible, so it is not copied,
+     * and if another cartridge already runs the same game, its rom is used instead.
      * @param filepath filepath to load rom-file from
      * @param load_ram_from_file whether to load corresponding ram file or not
      * @return false, if unable to open file, or if romSize, ramSize or cartridgeType is unsupported
@@ -51,24 +60,60 @@ public:
     bool loadRom(const std::string& filepath, bool load_ram_from_file=false);
 
     /**
-     * Save the contents of the ram, if any, to a file.
+     * Save the contents of the ram, and the rtc, if any, to a file.
      * @return false, if unable to open file or unable to write to file
      * @return true, write to file successful
      */
     bool saveRam();
 
     /**
-     * Load a ram file to memory.
+     * Load a ram file to memory, and the rtc saved with it, if any.
      * @returns false, if unable to open file, or if file size does not match ramSize
      * @returns true, if load successful
      */
     bool loadRam();
 
     /**
-     * Update the mbc, which in turn updates rtc (real time clock), if any.
-     * @param cycles the amount of cycles to update
+     * Set the emulated time, which the rtc (real time clock), if any, is computed from when it is accessed.
+     * Needs to be called before the mbc is read or written, and before the ram is saved.
+     * @param cycles the number of CPU cycles since the scheduler was reset
+     */
+    void setCycles(uint64_t cycles);
+
+    /**
+     * Returns the ROM currently mapped to 0x0000-0x3fff.
+     */
+    const uint8_t* romBank0() const;
+
+    /**
+     * Returns the ROM currently mapped to 0x4000-0x7fff.
+     */
+    const uint8_t* romBankN() const;
+
+    /**
+     * Returns the RAM currently mapped to 0xa000-0xbfff, or nullptr if it can not be accessed as plain memory.
+     */
+    uint8_t* ramBank() const;
+
+    /**
+     * Returns the hash of the loaded game ROM, which identifies the game, or 0 if no ROM file is loaded.
      */
-    void update(uint8_t cycles);
+    uint64_t getRomHash() const;
+
+    /**
+     * Write the xRAM and the state of the mbc to a save state.
+     * The cartridge header is written first, so that the state can not be loaded into another game.
+     * @param writer save state to write to
+     */
+    void saveState(StateWriter& writer) const;
+
+    /**
+     * Restore the xRAM and the state of the mbc from a save state.
+     * @param reader save state to read from
+     * @return false, if the save state belongs to another game, in which case nothing is changed
+     * @return true, if the state was loaded
+     */
+    bool loadState(StateReader& reader);
 
 private:
     enum CartridgeType {
@@ -107,31 +152,45 @@ private:
     uint8_t cartridgeType;
     uint8_t romSize;
     uint8_t ramSize;
-    std::vector<uint8_t> rom;
+    std::shared_ptr<const RomImage> rom;
+    // The rom after a reset, set as long as it is used
+    std::shared_ptr<RomImage> testRom;
     std::vector<uint8_t> ram;
     std::unique_ptr<MBC> mbc;
     std::string filepath;
+    uint64_t cycles;
 
     /**
-     * Initiate rom to the size according to romSize.
-     * @return false, if unsupported romSize.
+     * Resize a rom image to the size according to romSize.
+     * @param image the rom loaded from file
+     * @return false, if unsupported romSize, or if the image is larger.
      * @return true, if size successfully initiated
      */
-    bool initRom();
+    bool initRom(RomImage& image);
 
     /**
      * Initiate ram to the size according to ramSize.
-     * If loadFromRam is true, load ram from file.
-     * @param loadFromRam whether to load the ram from a file
      * @return false, if unsupported romSize.
      * @return true, if size successfully initiated
      */
-    bool initRam(bool loadFromRam=false);
+    bool initRam();
 
     /**
      * Initiates mbc with an mbc instance according to cartridgeType.
+     * The mbc maps the rom and ram, so they must not be reallocated afterwards.
      * @return false, if unsupported cartridgeType
      * @return true, if successful initiation
      */
     bool initMbc();
+
+    /**
+     * @return true, if the cartridge type has an rtc, which is saved with the ram
+     */
+    bool hasRtc() const;
+
+    /**
+     * Write the values identifying the loaded game: cartridge type, sizes and the header and global checksums.
+     * @param writer save state to write to
+     */
+    void saveIdentity(StateWriter& writer) const;
 };
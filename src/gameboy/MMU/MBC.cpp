@@ -1,5 +1,6 @@
 #include "MBC.h"
 #include <iostream> //cout
+#include <ctime> // time
 
 // MBC
 uint16_t MBC::romBankMask(uint32_t size) {
@@ -10,14 +11,29 @@ uint16_t MBC::ramBankMask(uint32_t size) {
     return (size >> 13) - 1;
 }
 
+void MBC::writeLittleEndian(std::ostream& file, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        file.put(static_cast<char>((value >> (8 * i)) & 0xff));
+    }
+}
+
+uint64_t MBC::readLittleEndian(std::istream& file, int bytes) {
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; i++) {
+        value |= static_cast<uint64_t>(static_cast<uint8_t>(file.get())) << (8 * i);
+    }
+    return value;
+}
+
 // ROM_Only_MBC
-ROM_Only_MBC::ROM_Only_MBC(std::vector<uint8_t> *rom)
-    : rom{rom} {
+ROM_Only_MBC::ROM_Only_MBC(const uint8_t *rom) {
+    mappedRomBank0 = rom;
+    mappedRomBankN = rom + 0x4000;
 }
 
 uint8_t ROM_Only_MBC::read(uint16_t addr) {
     if (0x0000 <= addr && addr <= 0x7fff) {
-        return rom->at(addr);
+        return mappedRomBank0[addr];
     } else if (0xa000 <= addr && addr <= 0xbfff) {
         return 0xff;
     } else {
@@ -30,47 +46,29 @@ void ROM_Only_MBC::write(uint16_t addr, uint8_t data) {
 }
 
 // MBC1
-MBC1_MBC::MBC1_MBC(std::vector<uint8_t> *rom, std::vector<uint8_t> *ram)
+MBC1_MBC::MBC1_MBC(const uint8_t *rom, size_t romSize, std::vector<uint8_t> *ram)
     : rom{rom}
-    , ram{ram} {
+    , ram{ram}
+    , romMask{MBC::romBankMask(static_cast<uint32_t>(romSize))}
+    , ramMask{MBC::ramBankMask(static_cast<uint32_t>(ram->size()))} {
     ramEnable = 0;
     romBankNumber = 1;
     ramBankNumber = 0;
     bankingMode = 0;
+    updateBanks();
 }
 
 uint8_t MBC1_MBC::read(uint16_t addr) {
     if (0x0000 <= addr && addr <= 0x3fff) {
-        // Simple ROM Banking Mode
-        if ((bankingMode & (1 << 0)) == 0) {
-            return rom->at(addr);
-        }
-        // RAM Banking Mode / Advanced ROM Banking Mode
-        else if ((bankingMode & (1 << 0)) == 1) {
-            uint16_t targetBank = (ramBankNumber << 5);
-            targetBank &= MBC::romBankMask(static_cast<uint32_t>(rom->size()));
-            return rom->at((addr) + (0x4000 * targetBank));
-        }
+        return mappedRomBank0[addr];
     } else if (0x4000 <= addr && addr <= 0x7fff) {
-        // Set target bank to 1 if it is 0
-        uint16_t targetBank = romBankNumber == 0 ? 1 : (romBankNumber & 0x1f);
-        targetBank |= (ramBankNumber << 5);
-        targetBank &= MBC::romBankMask(static_cast<uint32_t>(rom->size()));
-        return rom->at((addr - 0x4000) + (0x4000 * targetBank));
-
+        return mappedRomBankN[addr - 0x4000];
     } else if (0xa000 <= addr && addr <= 0xbfff) {
-        if (ramEnable != 0xa) {
+        if (!mappedRamBank) {
             std::cout << "Tried to access disabled xRAM. addr: " << (int)addr << std::endl;
             return 0xff;
-        } else {
-            uint8_t targetBank = 0;
-            uint16_t target = addr - 0xa000;
-            if (bankingMode == 1) {
-                targetBank = ramBankNumber;
-            }
-            targetBank &= MBC::ramBankMask(static_cast<uint32_t>(ram->size()));
-            return ram->at(target + static_cast<uint16_t>(targetBank * 0x2000));
         }
+        return mappedRamBank[addr - 0xa000];
     }
     return 0;
 }
@@ -78,33 +76,69 @@ uint8_t MBC1_MBC::read(uint16_t addr) {
 void MBC1_MBC::write(uint16_t addr, uint8_t data) {
     if (0x0000 <= addr && addr <= 0x1fff) {
         ramEnable = data & 0b1111;
+        updateBanks();
     } else if (0x2000 <= addr && addr <= 0x3fff) {
         romBankNumber = data & 0b11111;
+        updateBanks();
     } else if (0x4000 <= addr && addr <= 0x5fff) {
         ramBankNumber = data & 0b11;
+        updateBanks();
     } else if (0x6000 <= addr && addr <= 0x7fff) {
         bankingMode = data & 0b1;
+        updateBanks();
     } else if (0xa000 <= addr && addr <= 0xbfff) {
-        if (ramEnable != 0xa) {
+        if (!mappedRamBank) {
             std::cout << "Tried to write to disabled xRAM. addr: " << (int)addr << std::endl;
         } else {
-            uint8_t targetBank = 0;
-            uint16_t target = addr - 0xa000;
-            if (bankingMode == 1) {
-                targetBank = ramBankNumber;
-            }
-            targetBank &= MBC::ramBankMask(static_cast<uint32_t>(ram->size()));
-            ram->at(target + static_cast<uint16_t>(targetBank * 0x2000)) = data;
+            mappedRamBank[addr - 0xa000] = data;
         }
     } else {
         std::cout << "Tried to write data: " << (int)data << " to addr: " << (int)addr << std::endl;
     }
 }
 
+void MBC1_MBC::updateBanks() {
+    // Simple ROM Banking Mode maps bank 0, RAM Banking Mode / Advanced ROM Banking Mode also the upper bits
+    uint16_t targetBank = bankingMode == 0 ? 0 : (ramBankNumber << 5);
+    mappedRomBank0 = rom + 0x4000 * (targetBank & romMask);
+
+    // Set target bank to 1 if it is 0
+    targetBank = romBankNumber == 0 ? 1 : (romBankNumber & 0x1f);
+    targetBank |= (ramBankNumber << 5);
+    mappedRomBankN = rom + 0x4000 * (targetBank & romMask);
+
+    // Disabled xRAM reads 0xff and is reported to the console, which is left to read and write
+    if (ramEnable != 0xa) {
+        mappedRamBank = nullptr;
+    } else {
+        targetBank = bankingMode == 1 ? ramBankNumber : 0;
+        mappedRamBank = ram->data() + 0x2000 * (targetBank & ramMask);
+    }
+}
+
+void MBC1_MBC::saveState(StateWriter &writer) const {
+    writer.write(ramEnable);
+    writer.write(romBankNumber);
+    writer.write(ramBankNumber);
+    writer.write(bankingMode);
+}
+
+void MBC1_MBC::loadState(StateReader &reader) {
+    reader.read(ramEnable);
+    reader.read(romBankNumber);
+    reader.read(ramBankNumber);
+    reader.read(bankingMode);
+    updateBanks();
+}
+
 // MBC3
-MBC3_MBC::MBC3_MBC(std::vector<uint8_t> *rom, std::vector<uint8_t> *ram)
+MBC3_MBC::MBC3_MBC(const uint8_t *rom, size_t romSize, std::vector<uint8_t> *ram, const uint64_t *cycles, bool hasRtc)
     : rom{rom}
-    , ram{ram} {
+    , ram{ram}
+    , romMask{MBC::romBankMask(static_cast<uint32_t>(romSize))}
+    , ramMask{MBC::ramBankMask(static_cast<uint32_t>(ram->size()))}
+    , cycles{cycles}
+    , hasRtc{hasRtc} {
     rtcRegister = 0;
     ramTimerEnable = 0;
     romBankNumber = 1;
@@ -113,6 +147,7 @@ MBC3_MBC::MBC3_MBC(std::vector<uint8_t> *rom, std::vector<uint8_t> *ram)
 
     rtcHalt = 0;
     rtcSubseconds = 0;
+    rtcLastCycle = *cycles;
     rtcSeconds = 0;
     rtcMinutes = 0;
     rtcHours = 0;
@@ -125,18 +160,18 @@ MBC3_MBC::MBC3_MBC(std::vector<uint8_t> *rom, std::vector<uint8_t> *ram)
     rtcHoursLatched = 0;
     rtcDaysLatched = 0;
     rtcDaysOverflowLatched = 0;
+    updateBanks();
 }
 
 uint8_t MBC3_MBC::read(uint16_t addr) {
     if (0x0000 <= addr && addr <= 0x3fff) {
-        return rom->at(addr);
+        return mappedRomBank0[addr];
     } else if (0x4000 <= addr && addr <= 0x7fff) {
-        // Set target bank to 1 if it is 0
-        uint16_t targetBank = romBankNumber == 0 ? 1 : (romBankNumber & 0x7f);
-
-        targetBank &= MBC::romBankMask(static_cast<uint32_t>(rom->size()));
-        return rom->at((addr - 0x4000) + (0x4000 * targetBank));
+        return mappedRomBankN[addr - 0x4000];
     } else if (0xa000 <= addr && addr <= 0xbfff) {
+        if (mappedRamBank) {
+            return mappedRamBank[addr - 0xa000];
+        }
         if (ramTimerEnable != 0xa) {
             return 0xff;
         }
@@ -153,7 +188,7 @@ uint8_t MBC3_MBC::read(uint16_t addr) {
             case 0x2:
             case 0x3:
                 targetBank = ramBankNumberRtcRegisterSelect;
-                targetBank &= MBC::ramBankMask(static_cast<uint32_t>(ram->size()));
+                targetBank &= ramMask;
                 target = (addr - 0xa000) + (0x2000 * targetBank);
                 return ram->at(target);
 
@@ -189,16 +224,23 @@ uint8_t MBC3_MBC::read(uint16_t addr) {
 void MBC3_MBC::write(uint16_t addr, uint8_t data) {
     if (0x0000 <= addr && addr <= 0x1fff) {
         ramTimerEnable = data & 0b1111;
+        updateBanks();
     } else if (0x2000 <= addr && addr <= 0x3fff) {
         romBankNumber = data & 0b1111111;
+        updateBanks();
     } else if (0x4000 <= addr && addr <= 0x5fff) {
         ramBankNumberRtcRegisterSelect = data;
+        updateBanks();
     } else if (0x6000 <= addr && addr <= 0x7fff) {
         if (data == 1 && latchClockData == 0) {
             rtcLatch();
         }
         latchClockData = data;
     } else if (0xa000 <= addr && addr <= 0xbfff) {
+        if (mappedRamBank) {
+            mappedRamBank[addr - 0xa000] = data;
+            return;
+        }
         if (ramTimerEnable != 0xa) {
             return;
         }
@@ -216,20 +258,25 @@ void MBC3_MBC::write(uint16_t addr, uint8_t data) {
 
             // RTC Registers
             case 0x8:
+                rtcUpdate();
                 rtcSeconds = data & 0b111111;
                 rtcSubseconds = 0;
                 break;
             case 0x9:
+                rtcUpdate();
                 rtcMinutes = data & 0b111111;
                 break;
             case 0xa:
+                rtcUpdate();
                 rtcHours = data & 0b11111;
                 break;
             case 0xb:
+                rtcUpdate();
                 rtcDays &= ~(0x00ff);
                 rtcDays |= data & 0xff;
                 break;
             case 0xc:
+                rtcUpdate();
                 rtcDays &= 0xff;
                 rtcDays |= (static_cast<uint16_t>(data & 1)) << 8;
 
@@ -245,7 +292,25 @@ void MBC3_MBC::write(uint16_t addr, uint8_t data) {
     }
 }
 
+void MBC3_MBC::updateBanks() {
+    mappedRomBank0 = rom;
+
+    // Set target bank to 1 if it is 0
+    uint16_t targetBank = romBankNumber == 0 ? 1 : (romBankNumber & 0x7f);
+    mappedRomBankN = rom + 0x4000 * (targetBank & romMask);
+
+    // Reads truncate the bank number but writes do not, only map banks where both agree.
+    // The others, and the RTC registers, are left to read and write
+    targetBank = ramBankNumberRtcRegisterSelect;
+    if (ramTimerEnable != 0xa || targetBank > 0x3 || (targetBank & ramMask) != targetBank) {
+        mappedRamBank = nullptr;
+    } else {
+        mappedRamBank = ram->data() + 0x2000 * targetBank;
+    }
+}
+
 void MBC3_MBC::rtcLatch() {
+    rtcUpdate();
     rtcHaltLatched = rtcHalt;
     rtcSecondsLatched = rtcSeconds;
     rtcMinutesLatched = rtcMinutes;
@@ -254,22 +319,43 @@ void MBC3_MBC::rtcLatch() {
     rtcDaysOverflowLatched = rtcDaysOverflow;
 }
 
-// Update the timer with cycles @ 1,048,576Hz
-void MBC3_MBC::update(uint8_t cycles) {
-    if (rtcHalt) {
-        return;
+// Catch up with cycles @ 1,048,576Hz
+void MBC3_MBC::rtcUpdate() {
+    if (!rtcHalt) {
+        rtcSubseconds += *cycles - rtcLastCycle;
     }
+    rtcLastCycle = *cycles;
 
-    rtcSubseconds += cycles;
+    if (rtcSubseconds >= RTC_CYCLES_PER_SECOND) {
+        rtcAddSeconds(rtcSubseconds / RTC_CYCLES_PER_SECOND);
+        rtcSubseconds %= RTC_CYCLES_PER_SECOND;
+    }
+}
 
-    if (rtcSubseconds >= 1048576) {
-        rtcSubseconds -= 1048576;
-        rtcSeconds += 1;
-        rtcSeconds &= 0b111111;
-    } else {
-        return;
+void MBC3_MBC::rtcAddSeconds(uint64_t seconds) {
+    // Registers set out of range count up to where they wrap around without carrying, one second at a time
+    while (seconds > 0 && (rtcSeconds >= 60 || rtcMinutes >= 60 || rtcHours >= 24)) {
+        rtcTick();
+        seconds--;
     }
 
+    uint64_t carry = rtcSeconds + seconds;
+    rtcSeconds = carry % 60;
+    carry = rtcMinutes + carry / 60;
+    rtcMinutes = carry % 60;
+    carry = rtcHours + carry / 60;
+    rtcHours = carry % 24;
+    carry = rtcDays + carry / 24;
+    if (carry >= 512) {
+        rtcDaysOverflow = 1;
+    }
+    rtcDays = carry % 512;
+}
+
+void MBC3_MBC::rtcTick() {
+    rtcSeconds += 1;
+    rtcSeconds &= 0b111111;
+
     if (rtcSeconds == 60) {
         rtcSeconds -= 60;
         rtcMinutes += 1;
@@ -298,3 +384,98 @@ void MBC3_MBC::update(uint8_t cycles) {
         rtcDaysOverflow = 1;
     }
 }
+
+void MBC3_MBC::saveState(StateWriter &writer) const {
+    writer.write(rtcRegister);
+    writer.write(ramTimerEnable);
+    writer.write(romBankNumber);
+    writer.write(ramBankNumberRtcRegisterSelect);
+    writer.write(latchClockData);
+    // The cycles not yet added to the RTC are saved with it
+    writer.write<uint64_t>(rtcHalt ? rtcSubseconds : rtcSubseconds + *cycles - rtcLastCycle);
+    writer.write(rtcHalt);
+    writer.write(rtcSeconds);
+    writer.write(rtcMinutes);
+    writer.write(rtcHours);
+    writer.write(rtcDays);
+    writer.write(rtcDaysOverflow);
+    writer.write(rtcHaltLatched);
+    writer.write(rtcSecondsLatched);
+    writer.write(rtcMinutesLatched);
+    writer.write(rtcHoursLatched);
+    writer.write(rtcDaysLatched);
+    writer.write(rtcDaysOverflowLatched);
+}
+
+void MBC3_MBC::loadState(StateReader &reader) {
+    reader.read(rtcRegister);
+    reader.read(ramTimerEnable);
+    reader.read(romBankNumber);
+    reader.read(ramBankNumberRtcRegisterSelect);
+    reader.read(latchClockData);
+    reader.read(rtcSubseconds);
+    reader.read(rtcHalt);
+    reader.read(rtcSeconds);
+    reader.read(rtcMinutes);
+    reader.read(rtcHours);
+    reader.read(rtcDays);
+    reader.read(rtcDaysOverflow);
+    reader.read(rtcHaltLatched);
+    reader.read(rtcSecondsLatched);
+    reader.read(rtcMinutesLatched);
+    reader.read(rtcHoursLatched);
+    reader.read(rtcDaysLatched);
+    reader.read(rtcDaysOverflowLatched);
+    rtcLastCycle = *cycles;
+    updateBanks();
+}
+
+void MBC3_MBC::saveRtc(std::ostream &file) {
+    if (!hasRtc) {
+        return;
+    }
+    rtcUpdate();
+    // The format used by other emulators, every register as 4 bytes, the latched registers, then a timestamp
+    writeLittleEndian(file, rtcSeconds, 4);
+    writeLittleEndian(file, rtcMinutes, 4);
+    writeLittleEndian(file, rtcHours, 4);
+    writeLittleEndian(file, rtcDays & 0xff, 4);
+    writeLittleEndian(file, (rtcDaysOverflow << 7) | (rtcHalt << 6) | (rtcDays >> 8), 4);
+    writeLittleEndian(file, rtcSecondsLatched, 4);
+    writeLittleEndian(file, rtcMinutesLatched, 4);
+    writeLittleEndian(file, rtcHoursLatched, 4);
+    writeLittleEndian(file, rtcDaysLatched & 0xff, 4);
+    writeLittleEndian(file, (rtcDaysOverflowLatched << 7) | (rtcHaltLatched << 6) | (rtcDaysLatched >> 8), 4);
+    writeLittleEndian(file, static_cast<uint64_t>(std::time(nullptr)), 8);
+}
+
+void MBC3_MBC::loadRtc(std::istream &file, size_t size) {
+    if (!hasRtc) {
+        return;
+    }
+    rtcSeconds = readLittleEndian(file, 4) & 0b111111;
+    rtcMinutes = readLittleEndian(file, 4) & 0b111111;
+    rtcHours = readLittleEndian(file, 4) & 0b11111;
+    rtcDays = readLittleEndian(file, 4) & 0xff;
+    uint8_t daysHigh = readLittleEndian(file, 4);
+    rtcDays |= (daysHigh & 1) << 8;
+    rtcHalt = (daysHigh >> 6) & 1;
+    rtcDaysOverflow = (daysHigh >> 7) & 1;
+    rtcSecondsLatched = readLittleEndian(file, 4) & 0b111111;
+    rtcMinutesLatched = readLittleEndian(file, 4) & 0b111111;
+    rtcHoursLatched = readLittleEndian(file, 4) & 0b11111;
+    rtcDaysLatched = readLittleEndian(file, 4) & 0xff;
+    daysHigh = readLittleEndian(file, 4);
+    rtcDaysLatched |= (daysHigh & 1) << 8;
+    rtcHaltLatched = (daysHigh >> 6) & 1;
+    rtcDaysOverflowLatched = (daysHigh >> 7) & 1;
+    auto savedTime = static_cast<int64_t>(readLittleEndian(file, size == RTC_SAVE_SIZE_32 ? 4 : 8));
+
+    rtcSubseconds = 0;
+    rtcLastCycle = *cycles;
+    // Catch up on the time the emulator was closed
+    auto now = static_cast<int64_t>(std::time(nullptr));
+    if (!rtcHalt && now > savedTime) {
+        rtcAddSeconds(now - savedTime);
+    }
+}
@@ -2,11 +2,20 @@
 
 #include <vector>
 #include <cstdint>
+#include <iostream> // stream
+#include "../Definitions.h"
+#include "../SaveState.h"
+
+#define RTC_CYCLES_PER_SECOND   1048576
+#define RTC_SAVE_SIZE           48      //Bytes added to the .sav file, with a 64 bit timestamp
+#define RTC_SAVE_SIZE_32        44      //Bytes added to the .sav file by emulators using a 32 bit timestamp
 
 /**
  * The MBC class is an interface to be used when implementing different MBCs.
- * All MBCs have common needs for a read and write function but also an update
- * function that can be used to update devices on the MBC.
+ * All MBCs have common needs for a read and write function. Devices on the MBC, such as the RTC,
+ * are brought up to date when they are accessed rather than updated along with the CPU.
+ * The memory of the banks currently mapped is recomputed by the subclasses when the banking registers are written,
+ * so that it can be read without going through read.
  */
 class MBC {
 public:
@@ -28,11 +37,46 @@ public:
     virtual void write(uint16_t addr, uint8_t data) = 0;
 
     /**
-     * Update the MBC to be synced with the system.
-     * For example used to update RTC, which exist with some MBCs.
-     * @param cycles the amount of cycles to proceed.
+     * Returns the ROM currently mapped to 0x0000-0x3fff.
+     */
+    const uint8_t* romBank0() const { return mappedRomBank0; }
+
+    /**
+     * Returns the ROM currently mapped to 0x4000-0x7fff.
+     */
+    const uint8_t* romBankN() const { return mappedRomBankN; }
+
+    /**
+     * Returns the RAM currently mapped to 0xa000-0xbfff, or nullptr if xRAM is disabled or
+     * mapped to something other than plain memory. In that case read and write must be used.
+     */
+    uint8_t* ramBank() const { return mappedRamBank; }
+
+    /**
+     * Write the banking registers, and RTC if any, to a save state.
+     * @param writer save state to write to
      */
-    virtual void update(uint8_t cycles) = 0;
+    virtual void saveState(StateWriter& writer) const = 0;
+
+    /**
+     * Restore the banking registers, and RTC if any, from a save state.
+     * @param reader save state to read from
+     */
+    virtual void loadState(StateReader& reader) = 0;
+
+    /**
+     * Write the RTC, if any, to the end of a .sav file. The time of the host is included,
+     * so that the RTC can catch up on the time the emulator was closed when the file is loaded.
+     * @param file file to write to
+     */
+    virtual void saveRtc(std::ostream& file) = 0;
+
+    /**
+     * Restore the RTC, if any, from the end of a .sav file and add the time that has passed since it was saved.
+     * @param file file to read from
+     * @param size RTC_SAVE_SIZE or RTC_SAVE_SIZE_32 bytes
+     */
+    virtual void loadRtc(std::istream& file, size_t size) = 0;
 
     /**
      * Returns a bitmask that, when applied, truncate a memory bank number
@@ -47,55 +91,125 @@ public:
      * @param size RAM size
      */
     static uint16_t ramBankMask(uint32_t size);
+
+    /**
+     * Write a value in little endian byte order, as used by .sav files.
+     * @param file file to write to
+     * @param value value to write
+     * @param bytes number of bytes to write
+     */
+    static void writeLittleEndian(std::ostream& file, uint64_t value, int bytes);
+
+    /**
+     * Read a value in little endian byte order, as used by .sav files.
+     * @param file file to read from
+     * @param bytes number of bytes to read
+     */
+    static uint64_t readLittleEndian(std::istream& file, int bytes);
+
+protected:
+    // Kept up to date by the subclasses whenever the banking registers change
+    const uint8_t* mappedRomBank0 = nullptr;
+    const uint8_t* mappedRomBankN = nullptr;
+    uint8_t* mappedRamBank = nullptr;
 };
 
 class ROM_Only_MBC : public MBC {
 public:
-    explicit ROM_Only_MBC(std::vector<uint8_t> *rom);
+    /**
+     * @param rom the ROM of the cartridge, at least 0x8000 bytes
+     */
+    explicit ROM_Only_MBC(const uint8_t *rom);
 
     uint8_t read(uint16_t addr) override;
     void write(uint16_t addr, uint8_t data) override;
-    void update(uint8_t cycles) override {}
+    void saveState(StateWriter& writer) const override {}
+    void loadState(StateReader& reader) override {}
+    void saveRtc(std::ostream& file) override {}
+    void loadRtc(std::istream& file, size_t size) override {}
 
-private:
-    std::vector<uint8_t> *rom;
 };
 
 class MBC1_MBC : public MBC {
 public:
-    MBC1_MBC(std::vector<uint8_t> *rom, std::vector<uint8_t> *ram);
+    /**
+     * @param rom the ROM of the cartridge
+     * @param romSize the size of the ROM in bytes, a power of two
+     * @param ram the xRAM of the cartridge
+     */
+    MBC1_MBC(const uint8_t *rom, size_t romSize, std::vector<uint8_t> *ram);
 
     uint8_t read(uint16_t addr) override;
     void write(uint16_t addr, uint8_t data) override;
-
-    void update(uint8_t cycles) override {}
+    void saveState(StateWriter& writer) const override;
+    void loadState(StateReader& reader) override;
+    void saveRtc(std::ostream& file) override {}
+    void loadRtc(std::istream& file, size_t size) override {}
 
 private:
+    /**
+     * Recomputes the memory mapped to each area from the banking registers.
+     */
+    void updateBanks();
     uint8_t ramEnable;
     uint8_t romBankNumber;
     uint8_t ramBankNumber;
     uint8_t bankingMode;
 
-    std::vector<uint8_t> *rom;
+    const uint8_t *rom;
     std::vector<uint8_t> *ram;
+    uint16_t romMask;
+    uint16_t ramMask;
 };
 
+/**
+ * MBC3, optionally with an RTC. The RTC counts emulated time and is only brought up to date when
+ * it is accessed, from the number of cycles that have passed since it was last.
+ */
 class MBC3_MBC : public MBC {
 public:
-    MBC3_MBC(std::vector<uint8_t> *rom, std::vector<uint8_t> *ram);
+    /**
+     * @param rom the ROM of the cartridge
+     * @param romSize the size of the ROM in bytes, a power of two
+     * @param ram the xRAM of the cartridge
+     * @param cycles the emulated time in CPU cycles, kept up to date by the cartridge before any access
+     * @param hasRtc whether the RTC is saved to the .sav file
+     */
+    MBC3_MBC(const uint8_t *rom, size_t romSize, std::vector<uint8_t> *ram, const uint64_t *cycles, bool hasRtc);
     uint8_t read(uint16_t addr) override;
     void write(uint16_t addr, uint8_t data) override;
-    void update(uint8_t cycles) override;
+    void saveState(StateWriter& writer) const override;
+    void loadState(StateReader& reader) override;
+    void saveRtc(std::ostream& file) override;
+    void loadRtc(std::istream& file, size_t size) override;
 
 private:
+    /**
+     * Recomputes the memory mapped to each area from the banking registers.
+     */
+    void updateBanks();
     void rtcLatch();
+    /**
+     * Adds the cycles that have passed since the RTC was last brought up to date.
+     */
+    void rtcUpdate();
+    /**
+     * Advances the RTC a number of whole seconds.
+     */
+    void rtcAddSeconds(uint64_t seconds);
+    /**
+     * Advances the RTC one second, also when registers have been set out of range.
+     */
+    void rtcTick();
     uint8_t rtcRegister;
     uint8_t ramTimerEnable;
     uint8_t romBankNumber;
     uint8_t ramBankNumberRtcRegisterSelect;
     uint8_t latchClockData;
 
-    uint32_t rtcSubseconds;
+    // Cycles counted towards the next second, as of rtcLastCycle
+    uint64_t rtcSubseconds;
+    uint64_t rtcLastCycle;
     uint8_t rtcHalt;
     uint8_t rtcSeconds;
     uint8_t rtcMinutes;
@@ -110,6 +224,10 @@ private:
     uint16_t rtcDaysLatched;
     uint8_t rtcDaysOverflowLatched;
 
-    std::vector<uint8_t> *rom;
+    const uint8_t *rom;
     std::vector<uint8_t> *ram;
+    uint16_t romMask;
+    uint16_t ramMask;
+    const uint64_t *cycles;
+    bool hasRtc;
 };
@@ -3,6 +3,7 @@
 #include "../PPU/PPU.h"
 #include "Timer.h"
 #include "../APU/APU.h"
+#include "../Scheduler.h"
 #include <cstring> // memcpy
 #include <iostream> // cout
 #include <memory>   // smart pointers
@@ -26,14 +27,31 @@ void MMU::linkDevices(std::shared_ptr<PPU> ppu, std::shared_ptr<APU> apu, std::s
     if (cartridge) {
         this->cartridge = cartridge;
     }
+    updatePageTable();
+}
+
+void MMU::linkScheduler(std::shared_ptr<Scheduler> scheduler) {
+    this->scheduler = std::move(scheduler);
+}
+
+void MMU::unlinkDevices() {
+    ppu.reset();
+    apu.reset();
+    joypad.reset();
+    timer.reset();
+    cartridge.reset();
+    scheduler.reset();
+    updatePageTable();
 }
 
 void MMU::reset() {
     // Reset arrays to 0
     bootRom.fill(0x00);
     vram.fill(0x00);
+    tileCache.invalidateAll();
     ram.fill(0x00);
     oam.fill(0x00);
+    spriteTable.reload(oam.data());
     hram.fill(0x00);
 
     booting = true;
@@ -42,9 +60,69 @@ void MMU::reset() {
     interruptEnable = 0b11111;
     // No interrupt requests by default
     interruptFlag = 0;
+
+    serialData = 0;
+    serialOutput.clear();
+
+    updatePageTable();
+}
+
+void MMU::updatePageTable() {
+    readPages.fill(nullptr);
+    writePages.fill(nullptr);
+
+    mapCartridge();
+
+    // Writes to tile data go through writeSlow, which keeps the tile cache up to date
+    mapPages(VRAM_START, TILE_DATA_END, vram.data(), nullptr);
+    uint8_t* tileMaps = vram.data() + (TILE_DATA_END + 1 - VRAM_START);
+    mapPages(TILE_DATA_END + 1, VRAM_END, tileMaps, tileMaps);
+    mapPages(WRAM_START, WRAM_END, ram.data(), ram.data());
+}
+
+void MMU::mapCartridge() {
+    if (cartridge) {
+        mapPages(GAME_ROM_START, 0x3fff, cartridge->romBank0(), nullptr);
+        mapPages(0x4000, GAME_ROM_END, cartridge->romBankN(), nullptr);
+        mapPages(xRAM_START, xRAM_END, cartridge->ramBank(), cartridge->ramBank());
+    }
+    if (booting) {
+        // The boot ROM covers exactly the first page
+        mapPages(BOOT_ROM_START, BOOT_ROM_END, bootRom.data(), nullptr);
+    }
+}
+
+void MMU::mapPages(uint16_t start, uint16_t end, const uint8_t* readMemory, uint8_t* writeMemory) {
+    for (int page = start >> 8; page <= (end >> 8); page++) {
+        int offset = (page << 8) - start;
+        readPages[page] = readMemory ? readMemory + offset : nullptr;
+        writePages[page] = writeMemory ? writeMemory + offset : nullptr;
+    }
 }
 
 uint8_t MMU::read(uint16_t addr) {
+    const uint8_t* page = readPages[addr >> 8];
+    if (page) {
+        return page[addr & 0xff];
+    }
+    return readSlow(addr);
+}
+
+void MMU::write(uint16_t addr, uint8_t data) {
+    uint8_t* page = writePages[addr >> 8];
+    if (page) {
+        page[addr & 0xff] = data;
+        return;
+    }
+    writeSlow(addr, data);
+}
+
+uint8_t MMU::readSlow(uint16_t addr) {
+    // HRAM
+    if (HRAM_START <= addr && addr <= HRAM_END) {
+        return hram[addr - HRAM_START];
+    }
+
     // Boot ROM / Cartridge
     if (GAME_ROM_START <= addr && addr <= GAME_ROM_END) {
         if (BOOT_ROM_START <= addr && addr <= BOOT_ROM_END && booting) {
@@ -61,6 +139,7 @@ uint8_t MMU::read(uint16_t addr) {
 
     // xRAM
     if (xRAM_START <= addr && addr <= xRAM_END) {
+        updateCartridgeClock();
         return cartridge->read(addr);
     }
 
@@ -103,6 +182,7 @@ uint8_t MMU::read(uint16_t addr) {
 
         // Timer
         if (IO_TIMER_START <= addr && addr <= IO_TIMER_END) {
+            synchronizeDevices();
             return timer->read(addr);
         }
 
@@ -113,6 +193,7 @@ uint8_t MMU::read(uint16_t addr) {
 
         // Sound
         if (IO_SOUND_START <= addr && addr <= IO_SOUND_END) {
+            synchronizeDevices();
             return apu->read(addr);
         }
 
@@ -120,15 +201,11 @@ uint8_t MMU::read(uint16_t addr) {
 
         // LCD
         if (IO_LCD_START <= addr && addr <= IO_LCD_END) {
+            synchronizeDevices();
             return ppu->read(addr);
         }
     }
 
-    // HRAM
-    if (HRAM_START <= addr && addr <= HRAM_END) {
-        return hram[addr - HRAM_START];
-    }
-
     // Interrupt Enable
     if (addr == INTERRUPT_ENABLE) {
         return interruptEnable;
@@ -139,21 +216,35 @@ uint8_t MMU::read(uint16_t addr) {
     return 0;
 }
 
-void MMU::write(uint16_t addr, uint8_t data) {
+void MMU::writeSlow(uint16_t addr, uint8_t data) {
+    // HRAM
+    if (HRAM_START <= addr && addr <= HRAM_END) {
+        hram[addr - HRAM_START] = data;
+        return;
+    }
+
     // Memory Bank Controller
     if (GAME_ROM_START <= addr && addr <= GAME_ROM_END) {
+        updateCartridgeClock();
         cartridge->write(addr, data);
+        // Bank switching or enabling xRAM changes what is mapped, nothing else needs to be remapped
+        mapCartridge();
         return;
     }
 
     // VRAM
     if (VRAM_START <= addr && addr <= VRAM_END) {
-        vram[addr - VRAM_START] = data;
+        uint16_t offset = addr - VRAM_START;
+        if (addr <= TILE_DATA_END && vram[offset] != data) {
+            tileCache.invalidate(offset);
+        }
+        vram[offset] = data;
         return;
     }
 
     // xRAM
     if (xRAM_START <= addr && addr <= xRAM_END) {
+        updateCartridgeClock();
         cartridge->write(addr, data);
         return;
     }
@@ -174,6 +265,7 @@ void MMU::write(uint16_t addr, uint8_t data) {
     // OAM
     if (OAM_START <= addr && addr <= OAM_END) {
         oam[addr - OAM_START] = data;
+        spriteTable.write(addr - OAM_START, data);
         return;
     }
 
@@ -195,12 +287,20 @@ void MMU::write(uint16_t addr, uint8_t data) {
         if (IO_SERIAL_DATA_START <= addr && addr <= IO_SERIAL_DATA_END) {
             // Supress to prevent console spam
             // std::cout << "Tried to write to Serial Data Transfer device. addr: " << (int)addr << " data: " << (int)data << std::endl;
+            if (addr == IO_SERIAL_DATA_START) {
+                serialData = data;
+            } else if (data & (1 << 7)) {
+                // Transfer started, only the sent byte is recorded
+                serialOutput.push_back(static_cast<char>(serialData));
+            }
             return;
         }
 
         // Timer
         if (IO_TIMER_START <= addr && addr <= IO_TIMER_END) {
+            synchronizeDevices();
             timer->write(addr, data);
+            rescheduleDevices();
             return;
         }
 
@@ -212,7 +312,9 @@ void MMU::write(uint16_t addr, uint8_t data) {
 
         // Sound
         if (IO_SOUND_START <= addr && addr <= IO_SOUND_END) {
+            synchronizeDevices();
             apu->write(addr, data);
+            rescheduleDevices();
             return;
         }
 
@@ -220,7 +322,9 @@ void MMU::write(uint16_t addr, uint8_t data) {
 
         // LCD
         if (IO_LCD_START <= addr && addr <= IO_LCD_END) {
+            synchronizeDevices();
             ppu->write(addr, data);
+            rescheduleDevices();
             return;
         }
 
@@ -233,12 +337,6 @@ void MMU::write(uint16_t addr, uint8_t data) {
         //std::cout << "Tried to write to unmapped memory address: " << (int)addr << " data: " << (int)data << std::endl;
     }
 
-    // HRAM
-    if (HRAM_START <= addr && addr <= HRAM_END) {
-        hram[addr - HRAM_START] = data;
-        return;
-    }
-
     // Interrupt Enable
     if (addr == INTERRUPT_ENABLE) {
         interruptEnable = data;
@@ -252,6 +350,88 @@ void MMU::write(uint16_t addr, uint8_t data) {
 void MMU::disableBootRom(uint8_t data) {
     if (data != 0) {
         booting = false;
+        updatePageTable();
+    }
+}
+
+void MMU::saveState(StateWriter &writer) const {
+    writer.writeBytes(vram.data(), vram.size());
+    writer.writeBytes(ram.data(), ram.size());
+    writer.writeBytes(oam.data(), oam.size());
+    writer.writeBytes(hram.data(), hram.size());
+    writer.write(booting);
+    writer.write(interruptEnable);
+    writer.write(interruptFlag);
+    writer.write(serialData);
+}
+
+void MMU::loadState(StateReader &reader) {
+    // Run-ahead and rewind load states every frame, mostly with the same tiles, only the others are decoded again
+    decltype(vram) loadedVram = vram;
+    reader.readBytes(loadedVram.data(), loadedVram.size());
+    tileCache.invalidateChanged(loadedVram.data());
+    vram = loadedVram;
+    reader.readBytes(ram.data(), ram.size());
+    reader.readBytes(oam.data(), oam.size());
+    spriteTable.reload(oam.data());
+    reader.readBytes(hram.data(), hram.size());
+    reader.read(booting);
+    reader.read(interruptEnable);
+    reader.read(interruptFlag);
+    reader.read(serialData);
+    updatePageTable();
+}
+
+const std::string& MMU::getSerialOutput() const {
+    return serialOutput;
+}
+
+void MMU::truncateSerialOutput(size_t length) {
+    if (length < serialOutput.size()) {
+        serialOutput.resize(length);
+    }
+}
+
+const uint8_t* MMU::getVram() const {
+    return vram.data();
+}
+
+const uint8_t* MMU::getWram() const {
+    return ram.data();
+}
+
+bool MMU::isBooting() const {
+    return booting;
+}
+
+const uint8_t* MMU::readPointer(uint16_t addr) const {
+    const uint8_t* page = readPages[addr >> 8];
+    return page ? page + (addr & 0xff) : nullptr;
+}
+
+TileCache& MMU::getTileCache() {
+    return tileCache;
+}
+
+const SpriteTable& MMU::getSpriteTable() const {
+    return spriteTable;
+}
+
+void MMU::synchronizeDevices() {
+    if (scheduler) {
+        scheduler->synchronize();
+    }
+}
+
+void MMU::updateCartridgeClock() {
+    if (scheduler) {
+        cartridge->setCycles(scheduler->getCycles());
+    }
+}
+
+void MMU::rescheduleDevices() {
+    if (scheduler) {
+        scheduler->reschedule();
     }
 }
 
@@ -1,6 +1,9 @@
 #pragma once
 
 #include "Cartridge.h"
+#include "../SaveState.h"
+#include "../PPU/TileCache.h"
+#include "../PPU/SpriteTable.h"
 #include <cstdint>
 #include <array> // array
 #include <string> // string
@@ -10,6 +13,7 @@ class PPU;
 class APU;
 class Timer;
 class Joypad;
+class Scheduler;
 
 #define FRIEND_TEST(test_case_name, test_name)\
 friend class test_case_name##_##test_name##_Test
@@ -98,6 +102,19 @@ public:
      */
     void linkDevices(std::shared_ptr<PPU> ppu, std::shared_ptr<APU> apu, std::shared_ptr<Joypad> joypad, std::shared_ptr<Timer> timer, std::shared_ptr<Cartridge> cartridge);
 
+    /**
+     * Add reference to the scheduler that keeps the devices in step with the CPU.
+     * Devices are synchronized through it before their registers are accessed.
+     * @param scheduler reference to scheduler instance
+     */
+    void linkScheduler(std::shared_ptr<Scheduler> scheduler);
+
+    /**
+     * Remove the references to the devices and the scheduler. The devices hold references to the MMU in turn,
+     * so neither would ever be destroyed otherwise.
+     */
+    void unlinkDevices();
+
     /**
      * Load boot rom from file specified by filepath.
      * Disable boot rom if load is not successful.
@@ -107,7 +124,95 @@ public:
      */
     bool loadBootRom(const std::string& filepath);
 
+    /**
+     * Rebuild the page table used by read and write.
+     * Needs to be called when the memory mapped to an address changes outside of MMU::write,
+     * for example after a new game ROM has been loaded into the cartridge.
+     */
+    void updatePageTable();
+
+    /**
+     * Return every byte that has been sent over the serial port since reset.
+     * No link cable is emulated, but test ROMs print their results this way.
+     */
+    const std::string& getSerialOutput() const;
+
+    /**
+     * Remove the bytes sent over the serial port after the first ones, when the emulation that sent them is undone.
+     * @param length number of bytes to keep.
+     */
+    void truncateSerialOutput(size_t length);
+
+    /**
+     * Return VRAM, for the PPU to read tile maps without going through read.
+     */
+    const uint8_t* getVram() const;
+
+    /**
+     * Return WRAM, for inspecting the memory of a game without going through read.
+     */
+    const uint8_t* getWram() const;
+
+    /**
+     * Return whether the boot ROM is mapped, until it is disabled by writing to BOOT_ROM_DISABLE.
+     */
+    bool isBooting() const;
+
+    /**
+     * Return the host memory read at addr, or nullptr if addr is handled by readSlow. The pointer changes when
+     * other memory, such as another ROM bank or the boot ROM, is mapped to addr.
+     * @param addr memory address
+     */
+    const uint8_t* readPointer(uint16_t addr) const;
+
+    /**
+     * Return the decoded tiles of VRAM, which are kept up to date by write.
+     */
+    TileCache& getTileCache();
+
+    /**
+     * Return the decoded sprites of OAM, which are kept up to date by write.
+     */
+    const SpriteTable& getSpriteTable() const;
+
+    /**
+     * Write the state of memory and interrupt registers to a save state.
+     * @param writer save state to write to
+     */
+    void saveState(StateWriter& writer) const;
+
+    /**
+     * Restore the state of memory and interrupt registers from a save state.
+     * @param reader save state to read from
+     */
+    void loadState(StateReader& reader);
+
 private:
+    /**
+     * Read from devices and memory that are not mapped in the page table.
+     * @param addr memory address
+     */
+    uint8_t readSlow(uint16_t addr);
+
+    /**
+     * Write to devices and memory that are not mapped in the page table.
+     * @param addr memory address
+     * @param data value to be stored on memory address
+     */
+    void writeSlow(uint16_t addr, uint8_t data);
+
+    /**
+     * Map the ROM and xRAM banks currently selected by the cartridge, and the boot ROM over them while booting.
+     */
+    void mapCartridge();
+
+    /**
+     * Map the pages from start to end (inclusive) to consecutive pages of memory.
+     * @param readMemory host memory to read, nullptr if reads need to go through readSlow
+     * @param writeMemory host memory to write, nullptr if writes need to go through writeSlow
+     */
+    void mapPages(uint16_t start, uint16_t end, const uint8_t* readMemory, uint8_t* writeMemory);
+
     /**
      * Write to game rom located on cartridge.
      * Is only to be used in test.
@@ -131,28 +236,57 @@ private:
      */
     void disableBootRom(uint8_t data);
 
+    /**
+     * Update the devices with the cycles that have passed since they were last updated, if a scheduler is linked.
+     */
+    void synchronizeDevices();
+
+    /**
+     * Let the scheduler know that a device register has been written, if a scheduler is linked.
+     */
+    void rescheduleDevices();
+
+    /**
+     * Pass the time of the scheduler to the cartridge before it is accessed, if a scheduler is linked.
+     */
+    void updateCartridgeClock();
+
     // Devices
     std::shared_ptr<Cartridge> cartridge;
     std::shared_ptr<Joypad> joypad;
     std::shared_ptr<Timer> timer;
     std::shared_ptr<PPU> ppu;
     std::shared_ptr<APU> apu;
+    std::shared_ptr<Scheduler> scheduler;
 
     // Using array for memory with fixed size.
     std::array<uint8_t, 256> bootRom{};
     std::array<uint8_t, 8192> vram{};
+    TileCache tileCache{vram.data()};
     std::array<uint8_t, 8192> ram{};
     std::array<uint8_t, 160> oam{};
+    SpriteTable spriteTable;
     std::array<uint8_t, 128> hram{};
 
+    // Host memory backing each 256 byte page of the address space, indexed by the high byte of the address.
+    // Pages set to nullptr contain registers or are shared between devices and are handled by readSlow and writeSlow.
+    std::array<const uint8_t*, 256> readPages{};
+    std::array<uint8_t*, 256> writePages{};
+
     bool booting{};
     uint8_t interruptEnable{};
     uint8_t interruptFlag{};
 
+    // Serial port
+    uint8_t serialData{};
+    std::string serialOutput;
+
     // Tests using private stuff
     FRIEND_TEST(MMU, read_write);
     FRIEND_TEST(MMU, disable_boot_rom);
     FRIEND_TEST(CPU, Execute_NOP_Instruction);
     FRIEND_TEST(CPU, Execute_LD_SP_D16_Instruction);
     FRIEND_TEST(CPU, FUNDAMENTAL_FUNCTIONS);
+    FRIEND_TEST(CPU, idle_loop_detection);
+    FRIEND_TEST(CPU, idle_loop_detection_in_hram);
 };
@@ -0,0 +1,149 @@
+#include "RomImage.h"
+#include "../Hash.h"
+#include <cstring> // memcpy
+#include <fstream>
+#include <iterator> // next
+
+#ifndef _WIN32
+#include <fcntl.h> // open
+#include <sys/mman.h> // mmap
+#include <sys/stat.h> // fstat
+#include <unistd.h> // close
+#endif
+
+std::mutex RomImage::registryMutex;
+std::unordered_multimap<uint64_t, std::weak_ptr<const RomImage>> RomImage::registry;
+
+RomImage::RomImage(size_t size)
+    : buffer(size)
+    , mapping{nullptr}
+    , mappingSize{0}
+    , hash{0} {
+}
+
+RomImage::~RomImage() {
+    unmapFile();
+}
+
+bool RomImage::loadFile(const std::string& filepath) {
+    if (mapFile(filepath)) {
+        return true;
+    }
+
+    std::ifstream file(filepath, std::ios::in | std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        return false;
+    }
+    std::vector<uint8_t> contents(static_cast<size_t>(file.tellg()));
+    file.seekg(0, std::ios::beg);
+    file.read(reinterpret_cast<char *>(contents.data()), contents.size());
+    if (!file) {
+        return false;
+    }
+    unmapFile();
+    buffer = std::move(contents);
+    return true;
+}
+
+bool RomImage::resize(size_t size) {
+    size_t currentSize = this->size();
+    if (currentSize == size) {
+        return true;
+    }
+    if (currentSize > size) {
+        return false;
+    }
+    std::vector<uint8_t> padded(size);
+    std::memcpy(padded.data() + (size - currentSize), data(), currentSize);
+    unmapFile();
+    buffer = std::move(padded);
+    return true;
+}
+
+const uint8_t* RomImage::data() const {
+    return mapping ? static_cast<const uint8_t*>(mapping) : buffer.data();
+}
+
+size_t RomImage::size() const {
+    return mapping ? mappingSize : buffer.size();
+}
+
+uint8_t* RomImage::writableData() {
+    return mapping ? nullptr : buffer.data();
+}
+
+bool RomImage::isMapped() const {
+    return mapping != nullptr;
+}
+
+uint64_t RomImage::getHash() const {
+    return hash;
+}
+
+std::shared_ptr<const RomImage> RomImage::share(std::unique_ptr<RomImage> image) {
+    image->hash = Hash::compute(image->data(), image->size());
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (auto it = registry.begin(); it != registry.end();) {
+        it = it->second.expired() ? registry.erase(it) : std::next(it);
+    }
+    auto matches = registry.equal_range(image->hash);
+    for (auto it = matches.first; it != matches.second; it++) {
+        std::shared_ptr<const RomImage> shared = it->second.lock();
+        if (shared && shared->size() == image->size() &&
+            std::memcmp(shared->data(), image->data(), image->size()) == 0) {
+            return shared;
+        }
+    }
+    std::shared_ptr<const RomImage> shared(std::move(image));
+    registry.emplace(shared->hash, shared);
+    return shared;
+}
+
+size_t RomImage::sharedCount() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    size_t count = 0;
+    for (const auto& entry : registry) {
+        count += entry.second.expired() ? 0 : 1;
+    }
+    return count;
+}
+
+bool RomImage::mapFile(const std::string& filepath) {
+#ifdef _WIN32
+    return false;
+#else
+    int fd = open(filepath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat status{};
+    if (fstat(fd, &status) != 0 || status.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+    auto size = static_cast<size_t>(status.st_size);
+    void* memory = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps the file open
+    close(fd);
+    if (memory == MAP_FAILED) {
+        return false;
+    }
+
+    unmapFile();
+    buffer = std::vector<uint8_t>();
+    mapping = memory;
+    mappingSize = size;
+    return true;
+#endif
+}
+
+void RomImage::unmapFile() {
+#ifndef _WIN32
+    if (mapping) {
+        munmap(mapping, mappingSize);
+    }
+#endif
+    mapping = nullptr;
+    mappingSize = 0;
+}
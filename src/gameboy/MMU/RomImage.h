@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstddef> // size_t
+#include <cstdint>
+#include <memory> // ptr
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * This class holds the contents of a game ROM.
+ * A ROM file is mapped into memory where the platform supports it, so nothing is copied when it is loaded and
+ * every instance running the same file reads the same pages of the page cache. Otherwise, or when the file does
+ * not have the size declared in its header, the ROM is read into a buffer instead.
+ * The ROM can not be written, except when it is held in a buffer, which tests use to write programs to it.
+ * Once loaded, an image can be shared between every cartridge in the process running the same game, so that
+ * many instances only hold one copy. Each cartridge keeps its own RAM and MBC state.
+ */
+class RomImage {
+public:
+    /**
+     * Creates a ROM of the given size, filled with zeros.
+     * @param size size in bytes
+     */
+    explicit RomImage(size_t size);
+    ~RomImage();
+
+    RomImage(const RomImage&) = delete;
+    RomImage& operator=(const RomImage&) = delete;
+
+    /**
+     * Replace the contents with a ROM file, mapping it into memory if possible.
+     * @param filepath filepath to load rom-file from
+     * @return false, if unable to open or read the file, in which case the contents are unchanged
+     * @return true, if the file is loaded
+     */
+    bool loadFile(const std::string& filepath);
+
+    /**
+     * Change the size, keeping the contents at the end of the ROM, the way a smaller file would be placed on a
+     * cartridge of the declared size. The ROM is copied into a buffer if it is not already of that size.
+     * @param size size in bytes
+     * @return false, if the contents are larger than size, in which case nothing is changed
+     * @return true, if the ROM has the given size
+     */
+    bool resize(size_t size);
+
+    /**
+     * Returns the contents of the ROM.
+     */
+    const uint8_t* data() const;
+
+    /**
+     * Returns the size of the ROM in bytes.
+     */
+    size_t size() const;
+
+    /**
+     * Returns the contents of the ROM if it is held in a buffer and can be written, otherwise nullptr.
+     * To be used only in testing.
+     */
+    uint8_t* writableData();
+
+    /**
+     * Returns whether the ROM is mapped from its file, rather than copied into a buffer.
+     */
+    bool isMapped() const;
+
+    /**
+     * Returns the hash of the contents, computed when the image was shared.
+     */
+    uint64_t getHash() const;
+
+    /**
+     * Returns an image with the same contents that can be shared. If an image with the same contents is still in
+     * use in this process, that image is returned and the given one is released. Otherwise the given image is
+     * registered, until the last user releases it.
+     * Can be called from any thread.
+     * @param image the loaded ROM, which is not changed anymore
+     */
+    static std::shared_ptr<const RomImage> share(std::unique_ptr<RomImage> image);
+
+    /**
+     * Returns the number of shared images still in use.
+     */
+    static size_t sharedCount();
+
+private:
+    std::vector<uint8_t> buffer;
+    // Set when the file is mapped into memory
+    void* mapping;
+    size_t mappingSize;
+    uint64_t hash;
+
+    // Shared images by hash, released images are removed when the next one is shared
+    static std::mutex registryMutex;
+    static std::unordered_multimap<uint64_t, std::weak_ptr<const RomImage>> registry;
+
+    /**
+     * Map a file into memory, read-only and private to this process.
+     * @return false, if mapping is not supported or failed
+     */
+    bool mapFile(const std::string& filepath);
+
+    /**
+     * Release the mapping of the file, if any.
+     */
+    void unmapFile();
+};
@@ -26,11 +26,9 @@ void Timer::update(uint16_t cycles) {
     if (control & (1 << 0)) {
         // Timer speed
         uint8_t speed = control & 0b11;
-        const uint16_t speedMask[] = {0xfc00, 0xfff0, 0xffc0, 0xff00};
-        const uint8_t speedOffs[] = {10, 4, 6, 8};
 
-        uint16_t mask = speedMask[speed];
-        uint8_t offs = speedOffs[speed];
+        uint16_t mask = SPEED_MASK[speed];
+        uint8_t offs = SPEED_OFFS[speed];
 
         // Check for counter overflow
         // Increase counter
@@ -46,6 +44,51 @@ void Timer::update(uint16_t cycles) {
     }
 }
 
+uint32_t Timer::cyclesUntilNextEvent() const {
+    // Timer not activated
+    if (!(control & (1 << 0))) {
+        return NO_SCHEDULED_EVENT;
+    }
+    // Divider increase between two counter increases
+    uint32_t period = 1 << SPEED_OFFS[control & 0b11];
+    uint32_t untilIncrease = period - (divider & (period - 1));
+    uint32_t untilOverflow = untilIncrease + (0xff - counter) * period;
+
+    // Divider increases by 4 each cycle
+    return untilOverflow / 4;
+}
+
+uint32_t Timer::cyclesUntilRegisterChange() const {
+    // The divider register is the upper byte of divider
+    uint32_t untilChange = 0x100 - (divider & 0xff);
+
+    // Timer activated
+    if (control & (1 << 0)) {
+        uint32_t period = 1 << SPEED_OFFS[control & 0b11];
+        uint32_t untilIncrease = period - (divider & (period - 1));
+        if (untilIncrease < untilChange) {
+            untilChange = untilIncrease;
+        }
+    }
+
+    // Divider increases by 4 each cycle
+    return untilChange / 4;
+}
+
+void Timer::saveState(StateWriter &writer) const {
+    writer.write(divider);
+    writer.write(counter);
+    writer.write(modulo);
+    writer.write(control);
+}
+
+void Timer::loadState(StateReader &reader) {
+    reader.read(divider);
+    reader.read(counter);
+    reader.read(modulo);
+    reader.read(control);
+}
+
 uint8_t Timer::read(uint16_t addr) const {
     switch (addr) {
         case TIMER_DIVIDER:
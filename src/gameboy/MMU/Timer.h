@@ -2,6 +2,8 @@
 
 #include <cstdint>
 #include <memory> //ptr
+#include "../Definitions.h"
+#include "../SaveState.h"
 #define TIMER_DIVIDER       0xff04
 #define TIMER_COUNTER       0xff05
 #define TIMER_MODULO        0xff06
@@ -45,7 +47,35 @@ public:
      */
     void update(uint16_t cycles);
 
+    /**
+     * Return the number of cycles until the counter overflows and the timer interrupt is requested.
+     * Returns NO_SCHEDULED_EVENT if the timer is not activated.
+     */
+    uint32_t cyclesUntilNextEvent() const;
+
+    /**
+     * Return the number of cycles until the value of the divider register or, if activated,
+     * the counter register changes.
+     */
+    uint32_t cyclesUntilRegisterChange() const;
+
+    /**
+     * Write the state of the timer to a save state.
+     * @param writer save state to write to
+     */
+    void saveState(StateWriter& writer) const;
+
+    /**
+     * Restore the state of the timer from a save state.
+     * @param reader save state to read from
+     */
+    void loadState(StateReader& reader);
+
 private:
+    // Divider bits that increase the counter, and their offset, for each timer speed
+    static constexpr uint16_t SPEED_MASK[] = {0xfc00, 0xfff0, 0xffc0, 0xff00};
+    static constexpr uint8_t SPEED_OFFS[] = {10, 4, 6, 8};
+
     // MMU used to set interrupt flags
     std::shared_ptr<MMU> mmu;
 
@@ -1,8 +1,15 @@
 
 #include "PPU.h"
 #include <iostream> //cout
-
-PPU::PPU(std::shared_ptr<MMU> memory):memory(std::move(memory)){reset();}
+#include <algorithm> //min
+
+PPU::PPU(std::shared_ptr<MMU> memory)
+    : memory(std::move(memory))
+    , vram(this->memory->getVram())
+    , tileCache(this->memory->getTileCache())
+    , spriteTable(this->memory->getSpriteTable()) {
+    reset();
+}
 
 
 uint8_t PPU::read(uint16_t address) const {
@@ -44,6 +51,8 @@ void PPU::write(uint16_t address, uint8_t data) {
         case STAT_ADDRESS:
             statInterrupt(); //Hardware bug, interrupt should be thrown every time STAT is written
             STAT = data;
+            // The PPU is not updated after every instruction, so the new conditions are checked right away
+            updateStatConditions();
             break;
         case SCY_ADDRESS:
             SCY = data;
@@ -142,7 +151,9 @@ void PPU::update(uint16_t cpuCycles) {
             if (accumulatedCycles >= OAM_SEARCH_THRESHOLD) {
                 accumulatedCycles -= OAM_SEARCH_THRESHOLD;
                 coincidenceFlag = (LYC == LY); // Set coincidence flag before drawing the scanline.
-                loadSpritesNextScanLine();
+                if (!renderSkipping) {
+                    loadSpritesNextScanLine();
+                }
                 modeFlag = SCANLINE_DRAW;
             }
             break;
@@ -151,12 +162,18 @@ void PPU::update(uint16_t cpuCycles) {
             //When the draw phase ends, the current line is processed and the ppu goes into the h-blank phase.
             if (accumulatedCycles >= SCANLINE_DRAW_THRESHOLD) {
                 accumulatedCycles -= SCANLINE_DRAW_THRESHOLD;
-                processNextLine();
+                if (!renderSkipping) {
+                    processNextLine();
+                }
                 modeFlag = HBLANK;
             }
             break;
     }
 
+    updateStatConditions();
+}
+
+void PPU::updateStatConditions() {
     //A STAT-interrupt should be thrown when going from no conditions met to any conditions met.
     bool meetsStatConditionsCurrent = meetsStatConditions();
     if (!anyStatConditionLastUpdate) {
@@ -167,6 +184,29 @@ void PPU::update(uint16_t cpuCycles) {
     anyStatConditionLastUpdate = meetsStatConditionsCurrent;
 }
 
+uint32_t PPU::cyclesUntilNextEvent() const {
+    uint16_t threshold = 0;
+    switch (modeFlag) {
+        case HBLANK:
+            threshold = HBLANK_THRESHOLD;
+            break;
+        case VBLANK:
+            threshold = VBLANK_LINE_THRESHOLD;
+            break;
+        case OAM_SEARCH:
+            threshold = OAM_SEARCH_THRESHOLD;
+            break;
+        case SCANLINE_DRAW:
+            threshold = SCANLINE_DRAW_THRESHOLD;
+            break;
+    }
+    // Writing STAT can change mode, leaving the new mode already overdue
+    if (accumulatedCycles >= threshold) {
+        return 0;
+    }
+    return threshold - accumulatedCycles;
+}
+
 bool PPU::isReadyToDraw() const {
     return readyToDraw;
 }
@@ -175,10 +215,62 @@ void PPU::confirmDraw() {
     readyToDraw = false;
 }
 
+void PPU::setRenderSkipping(bool enabled) {
+    //The sprites of a line being drawn were not selected while skipping
+    if (renderSkipping && !enabled && modeFlag == SCANLINE_DRAW) {
+        loadSpritesNextScanLine();
+    }
+    renderSkipping = enabled;
+}
+
 const std::array<uint8_t, LCD_WIDTH * LCD_HEIGHT>* PPU::getFrameBuffer() const {
     return &frameBuffer;
 }
 
+void PPU::saveState(StateWriter &writer) const {
+    writer.write(LCDC);
+    writer.write(STAT);
+    writer.write(SCY);
+    writer.write(SCX);
+    writer.write(LY);
+    writer.write(LYC);
+    writer.write(DMA);
+    writer.write(WY);
+    writer.write(WX);
+    writer.write(BGP);
+    writer.write(OBP0);
+    writer.write(OBP1);
+    writer.write(accumulatedCycles);
+    writer.write(readyToDraw);
+    writer.write(anyStatConditionLastUpdate);
+    writer.writeBytes(frameBuffer.data(), frameBuffer.size());
+}
+
+void PPU::loadState(StateReader &reader) {
+    reader.read(LCDC);
+    reader.read(STAT);
+    reader.read(SCY);
+    reader.read(SCX);
+    reader.read(LY);
+    reader.read(LYC);
+    reader.read(DMA);
+    reader.read(WY);
+    reader.read(WX);
+    reader.read(BGP);
+    reader.read(OBP0);
+    reader.read(OBP1);
+    reader.read(accumulatedCycles);
+    reader.read(readyToDraw);
+    reader.read(anyStatConditionLastUpdate);
+    reader.readBytes(frameBuffer.data(), frameBuffer.size());
+
+    //The sprites of the line being drawn are found again from OAM, which cannot be written while drawing
+    spriteCountNextScanLine = 0;
+    if (modeFlag == SCANLINE_DRAW) {
+        loadSpritesNextScanLine();
+    }
+}
+
 void PPU::processNextLine() {
     if (lcdDisplayEnable) {
         if (bgWindowDisplayEnable) {
@@ -201,15 +293,8 @@ void PPU::drawBackgroundScanLine() {
         bgMapStartAddress = BG_WINDOW_MAP0;
     }
 
-    for (uint8_t x = 0; x < LCD_WIDTH; ++x) {
-        uint8_t absolutePixelX = (SCX + x) % BACKGROUND_WIDTH;
-        uint8_t absolutePixelY = (SCY + LY) % BACKGROUND_HEIGHT;
-        uint8_t tileID = getTileID(bgMapStartAddress, absolutePixelX, absolutePixelY);
-        uint8_t colorIndex = getTilePixelColorIndex(bgWindowTileSetSelect, tileID, absolutePixelX % 8, absolutePixelY % 8);
-        bgWindowColorIndexesThisLine[x] = colorIndex;
-        uint8_t pixel = getColor(BGP, colorIndex);
-        frameBuffer[LY * LCD_WIDTH + x] = pixel;
-    }
+    uint8_t absolutePixelY = (SCY + LY) % BACKGROUND_HEIGHT;
+    drawTileRows(bgMapStartAddress, absolutePixelY, SCX, 0);
 }
 
 void PPU::drawWindowScanLine() {
@@ -224,107 +309,103 @@ void PPU::drawWindowScanLine() {
     }
     int startX = WX - 7; //WX = windows start position + 7
     if (startX < 0) {
-        startX = 0;
+        startX = 0; //TODO check hardware bug when 0 < WX <= 6 and WX = 166 What is the intended behaviour?
+    }
+    uint8_t absolutePixelY = LY - WY;
+    drawTileRows(windowMapStartAddress, absolutePixelY, 0, startX);
+}
+
+void PPU::drawTileRows(uint16_t mapStartAddress, uint8_t absolutePixelY, uint8_t absolutePixelX, int startX) {
+    //The row of the tile map and the row within its tiles are the same for the whole scanline
+    const uint8_t* mapRow = vram + (mapStartAddress - VRAM_START) + (absolutePixelY / 8) * 32;
+    uint8_t tileY = absolutePixelY % 8;
+    uint8_t mapX = absolutePixelX / 8;
+    uint8_t tileX = absolutePixelX % 8;
+
+    //Background palette as a lookup table from color index to color
+    std::array<uint8_t, 4> colors{};
+    for (uint8_t colorIndex = 0; colorIndex < 4; colorIndex++) {
+        colors[colorIndex] = getColor(BGP, colorIndex);
     }
-    for (int x = startX; x < LCD_WIDTH; ++x) {
-        uint8_t absolutePixelX = x - startX; //TODO check hardware bug when 0 < WX <= 6 and WX = 166 What is the intended behaviour?
-        uint8_t absolutePixelY = LY - WY;
-        uint8_t tileID = getTileID(windowMapStartAddress, absolutePixelX, absolutePixelY);
-        uint8_t colorIndex = getTilePixelColorIndex(bgWindowTileSetSelect, tileID, absolutePixelX % 8, absolutePixelY % 8);
-        bgWindowColorIndexesThisLine[x] = colorIndex;
-        uint8_t pixel = getColor(BGP, colorIndex);
-        frameBuffer[LY * LCD_WIDTH + x] = pixel;
+
+    uint8_t* colorIndexes = bgWindowColorIndexesThisLine.data();
+    uint8_t* line = &frameBuffer[LY * LCD_WIDTH];
+    int x = startX;
+    while (x < LCD_WIDTH) {
+        //Only the first and the last tile can be partly outside of the screen, due to fine scrolling
+        const uint8_t* row = tileCache.getRow(getTileIndex(bgWindowTileSetSelect, mapRow[mapX % 32]), tileY);
+        int count = std::min(8 - tileX, LCD_WIDTH - x);
+        for (int i = 0; i < count; i++) {
+            uint8_t colorIndex = row[tileX + i];
+            colorIndexes[x + i] = colorIndex;
+            line[x + i] = colors[colorIndex];
+        }
+        x += count;
+        tileX = 0;
+        mapX++;
     }
 }
 
 void PPU::drawObjectScanLine() {
-    while (!spritesNextScanLine.empty()) {
-        auto sprite = spritesNextScanLine.top();
-        spritesNextScanLine.pop();
-        for (int x = sprite.getX(); x < sprite.getX() + 8; ++x) {
-            if (x < 0 || x >= 160) {
+    int height = objectSize ? 16 : 8;
+    std::array<std::array<uint8_t, 4>, 2> colors{};
+    for (uint8_t colorIndex = 0; colorIndex < 4; colorIndex++) {
+        colors[0][colorIndex] = getColor(OBP0, colorIndex);
+        colors[1][colorIndex] = getColor(OBP1, colorIndex);
+    }
+
+    //Sprites are drawn from the highest priority, a pixel belongs to the first sprite that is not transparent there
+    std::array<bool, LCD_WIDTH> pixelTaken{};
+    uint8_t* line = &frameBuffer[LY * LCD_WIDTH];
+    for (uint8_t i = 0; i < spriteCountNextScanLine; i++) {
+        uint8_t sprite = spritesNextScanLine[i];
+        uint8_t flags = spriteTable.getFlags(sprite);
+        int spriteX = spriteTable.getX(sprite);
+
+        uint8_t tileY = LY - spriteTable.getY(sprite);
+        if (flags & SPRITE_Y_FLIP_BIT) {
+            tileY = height - 1 - tileY;
+        }
+        //Sprites of height 16 use the tile with an even ID for the top and the next one for the bottom
+        uint8_t tileID = spriteTable.getTileID(sprite);
+        if (objectSize) {
+            tileID = (tileID & 0xFE) + tileY / 8;
+        }
+        const uint8_t* row = tileCache.getRow(getTileIndex(1, tileID), tileY % 8); //Sprites always use tile set 1
+        const std::array<uint8_t, 4>& palette = colors[(flags & SPRITE_PALETTE_BIT) ? 1 : 0];
+
+        for (int tileX = 0; tileX < 8; tileX++) {
+            int x = spriteX + tileX;
+            if (x < 0 || x >= LCD_WIDTH || pixelTaken[x]) {
                 continue;
             }
-            //If the sprite should be behind the background and the background is not color 0, don't display the pixel
-            if ((sprite.isBackgroundOverSprite()) && (bgWindowColorIndexesThisLine[x] != 0)) { //TODO should this be color index 0 or color 0?
-                frameBuffer[LY * LCD_WIDTH + x] = getColor(BGP, bgWindowColorIndexesThisLine[x]);
-            } else {
-                uint8_t colorIndex = getSpritePixelColorIndex(sprite, x, LY);
-                if (colorIndex != 0) { //Color index 0 is transparent
-                    uint8_t pixel;
-                    if (sprite.getPaletteNumber()) {
-                        pixel = getColor(OBP1, colorIndex);
-                    } else {
-                        pixel = getColor(OBP0, colorIndex);
-                    }
-                    frameBuffer[LY * LCD_WIDTH + x] = pixel;
-                }
+            uint8_t colorIndex = row[(flags & SPRITE_X_FLIP_BIT) ? 7 - tileX : tileX];
+            if (colorIndex == 0) { //Color index 0 is transparent
+                continue;
             }
+            pixelTaken[x] = true;
+            //If the sprite should be behind the background and the background is not color 0, the background stays
+            if ((flags & SPRITE_BEHIND_BG_BIT) && bgWindowColorIndexesThisLine[x] != 0) { //TODO should this be color index 0 or color 0?
+                continue;
+            }
+            line[x] = palette[colorIndex];
         }
     }
 }
 
 void PPU::loadSpritesNextScanLine() {
-    //Loads the ten first sprites in OAM that appear on the current scanline.
+    //Finds the ten first sprites in OAM that appear on the current scanline.
     //There are a maximum of 40 sprites total and 10 sprites per scanline.
-    for (int i = 0; i < 40 && spritesNextScanLine.size() < 10; ++i) {
-        Sprite sprite = loadSprite(i);
-        if (sprite.coversLine(LY, objectSize)) {
-            spritesNextScanLine.push(sprite);
-        }
-    }
-}
-
-Sprite PPU::loadSprite(uint8_t index) {
-    uint16_t startAddress = OAM_START + index * 4; //Each sprite occupies four bytes
-    uint8_t yByte = memory->read(startAddress);
-    uint8_t xByte = memory->read(startAddress + 1);
-    uint8_t tileIndex = memory->read(startAddress + 2);
-    uint8_t flags = memory->read(startAddress + 3);
-    return {yByte, xByte, tileIndex, flags, index};
-}
-
-
-uint8_t PPU::getSpritePixelColorIndex(Sprite & sprite, uint8_t lcdX, uint8_t lcdY) {
-    uint8_t tileID = sprite.getTileID(lcdY, objectSize);
-    uint8_t tileX = sprite.getTileX(lcdX);
-    uint8_t tileY = sprite.getTileY(lcdY);
-    return getTilePixelColorIndex(1, tileID, tileX, tileY); //Sprites always use tile set 1
-}
-
-uint8_t PPU::getTileID(uint16_t mapStart, uint8_t pixelAbsoluteX, uint8_t pixelAbsoluteY) {
-    //Divide by x and y by 8, since the width and height of a tile is 8
-    uint16_t tileAbsoluteX = pixelAbsoluteX / 8;
-    uint16_t tileAbsoluteY = pixelAbsoluteY / 8;
-    uint16_t offset = tileAbsoluteY * 32 + tileAbsoluteX; //Convert from 2D matrix to array index
-    return memory->read(mapStart + offset);
+    spriteCountNextScanLine = spriteTable.selectLine(LY, objectSize ? 16 : 8, spritesNextScanLine);
 }
 
-uint8_t PPU::getTilePixelColorIndex(uint8_t tileSet, uint8_t tileId, uint8_t tileX, uint8_t tileY) {
-    uint16_t address;
-
-    //Find the address of the tile with id tileID, depending on addressing mode
+uint16_t PPU::getTileIndex(uint8_t tileSet, uint8_t tileId) {
+    //Find the index of the tile with id tileID in tile data, depending on addressing mode
     if (tileSet) {
-        address = tileId * 16 + BG_WINDOW_TILE_DATA1;
-    } else {
-        auto signedID = (int8_t)tileId;
-        address = signedID * 16 + BG_WINDOW_TILE_DATA0;
+        return (BG_WINDOW_TILE_DATA1 - TILE_DATA_START) / TILE_DATA_SIZE + tileId;
     }
-
-    //Pixels in a row are numbered 7 to 0
-    tileX = 7 - tileX;
-
-    //Read the two bytes associated with the correct row of the tile
-    uint8_t lowByte = memory->read(address + tileY * 2);
-    uint8_t highByte = memory->read(address + tileY * 2 + 1);
-
-    //Determine the two bits associated with the correct pixel in the row
-    uint8_t lowBit = (lowByte >> tileX) & 1;
-    uint8_t highBit = (highByte >> tileX) & 1;
-
-    //Combine the two bits to form the color index of the pixel
-    uint8_t pixelColor = (highBit << 1) | lowBit;
-    return pixelColor;
+    auto signedID = (int8_t)tileId;
+    return (BG_WINDOW_TILE_DATA0 - TILE_DATA_START) / TILE_DATA_SIZE + signedID;
 }
 
 uint8_t PPU::getColor(uint8_t palette, uint8_t colorIndex) {
@@ -4,10 +4,10 @@
 #include <memory> // smart pointers
 #include <cstdint> // uint8_t and uint16_t
 #include <array> // frame buffer
-#include <queue> //queue
 #include "../Definitions.h" // LCD_WIDTH and LCD_HEIGHT
 #include "../MMU/MMU.h"
-#include "Sprite.h"
+#include "SpriteTable.h"
+#include "../SaveState.h"
 
 // Register addresses
 #define LCDC_ADDRESS    0xFF40
@@ -67,6 +67,10 @@ public:
      * @param cpuCycles CPU cycles since last update.
      */
     void update(uint16_t cpuCycles);
+    /**
+     * @return cycles left until the PPU goes to its next mode.
+     */
+    uint32_t cyclesUntilNextEvent() const;
     /**
      * Shows whether the PPU is done rendering the next frame.
      * @return true if the PPU is done rendering the next frame.
@@ -80,8 +84,30 @@ public:
      * @return the current frame buffer.
      */
     const std::array<uint8_t, LCD_WIDTH * LCD_HEIGHT>* getFrameBuffer() const;
+    /**
+     * Enables or disables skipping of drawing scanlines. Timing, LY, STAT and interrupts are updated as usual,
+     * but the frame buffer keeps the last frame that was drawn.
+     * @param enabled whether scanlines should be skipped.
+     */
+    void setRenderSkipping(bool enabled);
+
+    //Save state methods
+    /**
+     * Write the state of the PPU, including the frame buffer to a save state.
+     * @param writer save state to write to
+     */
+    void saveState(StateWriter& writer) const;
+    /**
+     * Restore the state of the PPU, including the frame buffer from a save state.
+     * @param reader save state to read from
+     */
+    void loadState(StateReader& reader);
 private:
     std::shared_ptr<MMU> memory;
+    //VRAM and its decoded tiles are read directly, they are owned by the MMU
+    const uint8_t* vram;
+    TileCache& tileCache;
+    const SpriteTable& spriteTable;
 
     //The amount of cycles each mode should last
     const static uint16_t HBLANK_THRESHOLD = 51;
@@ -141,32 +167,41 @@ private:
 
     //The color indexes of the background and window this scanline. Used to determine priority of sprites
     std::array<uint8_t, LCD_WIDTH> bgWindowColorIndexesThisLine{};
-    std::priority_queue<Sprite> spritesNextScanLine;
+    //Indexes of the sprites on the scanline being drawn, the one with the highest priority first
+    std::array<uint8_t, SPRITES_PER_LINE> spritesNextScanLine{};
+    uint8_t spriteCountNextScanLine{};
     std::array<uint8_t, LCD_WIDTH * LCD_HEIGHT> frameBuffer{};
 
     bool readyToDraw{};
     bool anyStatConditionLastUpdate{};
+    bool renderSkipping{};
 
     //Scanline methods
     void processNextLine();
     void drawBackgroundScanLine();
     void drawWindowScanLine();
+    /**
+     * Draws background or window tiles from startX to the end of the scanline, one tile row at a time.
+     * @param mapStartAddress address of the tile map.
+     * @param absolutePixelY the row of the tile map, in pixels.
+     * @param absolutePixelX the column of the tile map drawn at startX, in pixels.
+     * @param startX the first pixel of the scanline to draw.
+     */
+    void drawTileRows(uint16_t mapStartAddress, uint8_t absolutePixelY, uint8_t absolutePixelX, int startX);
     void drawObjectScanLine();
 
     //Sprite methods
     void loadSpritesNextScanLine();
-    Sprite loadSprite(uint8_t index);
-    uint8_t getSpritePixelColorIndex(Sprite & sprite, uint8_t lcdX, uint8_t lcdY);
 
     // Parsing methods
-    uint8_t getTileID(uint16_t mapStart, uint8_t pixelAbsoluteX, uint8_t pixelAbsoluteY);
-    uint8_t getTilePixelColorIndex(uint8_t tileSet, uint8_t id, uint8_t tileX, uint8_t tileY);
+    static uint16_t getTileIndex(uint8_t tileSet, uint8_t id);
     static uint8_t getColor(uint8_t palette, uint8_t colorIndex);
 
     // Interrupt related methods
     void vBlankInterrupt();
     void statInterrupt();
     bool meetsStatConditions() const;
+    void updateStatConditions();
 
     //DMA transfer
     void dma_transfer(uint8_t startAddress);
@@ -0,0 +1,49 @@
+#include "SpriteTable.h"
+
+SpriteTable::SpriteTable() {
+    std::array<uint8_t, SPRITE_AMOUNT * 4> empty{};
+    reload(empty.data());
+}
+
+void SpriteTable::write(uint8_t offset, uint8_t data) {
+    //Each sprite occupies four bytes: y + 16, x + 8, tile ID and flags
+    uint8_t index = offset / 4;
+    switch (offset % 4) {
+        case 0:
+            y[index] = (int16_t)data - 16;
+            break;
+        case 1:
+            x[index] = (int16_t)data - 8;
+            break;
+        case 2:
+            tileID[index] = data;
+            break;
+        default:
+            flags[index] = data;
+            break;
+    }
+}
+
+void SpriteTable::reload(const uint8_t *oam) {
+    for (int offset = 0; offset < SPRITE_AMOUNT * 4; offset++) {
+        write(offset, oam[offset]);
+    }
+}
+
+uint8_t SpriteTable::selectLine(uint8_t lineY, int height, std::array<uint8_t, SPRITES_PER_LINE> &selected) const {
+    uint8_t count = 0;
+    for (uint8_t index = 0; index < SPRITE_AMOUNT && count < SPRITES_PER_LINE; index++) {
+        int distance = lineY - y[index];
+        if (distance < 0 || distance >= height) {
+            continue;
+        }
+        //Sprites are found in OAM order, so moving past only those with a greater x keeps equal x in OAM order
+        int position = count++;
+        while (position > 0 && x[selected[position - 1]] > x[index]) {
+            selected[position] = selected[position - 1];
+            position--;
+        }
+        selected[position] = index;
+    }
+    return count;
+}
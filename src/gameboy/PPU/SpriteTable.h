@@ -0,0 +1,77 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#define SPRITE_AMOUNT       40
+#define SPRITES_PER_LINE    10
+
+// Sprite attribute flags
+#define SPRITE_PALETTE_BIT      0x10
+#define SPRITE_X_FLIP_BIT       0x20
+#define SPRITE_Y_FLIP_BIT       0x40
+#define SPRITE_BEHIND_BG_BIT    0x80
+
+/**
+ * This class keeps the sprites in OAM decoded into screen coordinates, one array per attribute,
+ * so that the PPU can find the sprites of a scanline without reading OAM through the MMU.
+ * It is updated on every write to OAM, including DMA transfers.
+ */
+class SpriteTable {
+public:
+    SpriteTable();
+
+    /**
+     * Updates the sprite containing a byte of OAM.
+     * @param offset offset of the byte from OAM_START.
+     * @param data the new value of the byte.
+     */
+    void write(uint8_t offset, uint8_t data);
+
+    /**
+     * Decodes all sprites, for when OAM is replaced as a whole.
+     * @param oam SPRITE_AMOUNT * 4 bytes of OAM.
+     */
+    void reload(const uint8_t* oam);
+
+    /**
+     * Finds the first SPRITES_PER_LINE sprites in OAM that cover a scanline and orders them by drawing priority.
+     * The sprite with the lowest x-coordinate has priority, and if two are equal the one first in OAM.
+     * @param lineY the y-coordinate of the scanline.
+     * @param height the height of the sprites, 8 or 16.
+     * @param selected set to the indexes of the sprites, the one with the highest priority first.
+     * @return the number of sprites found.
+     */
+    uint8_t selectLine(uint8_t lineY, int height, std::array<uint8_t, SPRITES_PER_LINE>& selected) const;
+
+    /**
+     * @return the x-coordinate of the sprite's top left corner.
+     */
+    int getX(uint8_t index) const {
+        return x[index];
+    }
+    /**
+     * @return the y-coordinate of the sprite's top left corner.
+     */
+    int getY(uint8_t index) const {
+        return y[index];
+    }
+    /**
+     * @return the tile ID of the sprite. Sprites of height 16 use the pair of tiles starting at the even ID.
+     */
+    uint8_t getTileID(uint8_t index) const {
+        return tileID[index];
+    }
+    /**
+     * @return the attribute flags of the sprite, see the SPRITE_*_BIT masks.
+     */
+    uint8_t getFlags(uint8_t index) const {
+        return flags[index];
+    }
+
+private:
+    std::array<int16_t, SPRITE_AMOUNT> x{};
+    std::array<int16_t, SPRITE_AMOUNT> y{};
+    std::array<uint8_t, SPRITE_AMOUNT> tileID{};
+    std::array<uint8_t, SPRITE_AMOUNT> flags{};
+};
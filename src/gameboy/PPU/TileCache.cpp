@@ -0,0 +1,35 @@
+#include "TileCache.h"
+
+#include <cstring> // memcmp
+
+TileCache::TileCache(const uint8_t *tileData) : tileData{tileData} {
+    invalidateAll();
+}
+
+void TileCache::invalidateAll() {
+    dirty.fill(true);
+}
+
+void TileCache::invalidateChanged(const uint8_t *newTileData) {
+    for (uint16_t tileIndex = 0; tileIndex < TILE_AMOUNT; tileIndex++) {
+        size_t offset = tileIndex * TILE_DATA_SIZE;
+        if (std::memcmp(tileData + offset, newTileData + offset, TILE_DATA_SIZE) != 0) {
+            dirty[tileIndex] = true;
+        }
+    }
+}
+
+void TileCache::decode(uint16_t tileIndex) {
+    const uint8_t* tile = tileData + tileIndex * TILE_DATA_SIZE;
+    for (int row = 0; row < 8; row++) {
+        //Each row is two bytes, the low and the high bit of each pixel. Pixels in a row are numbered 7 to 0
+        uint8_t lowByte = tile[row * 2];
+        uint8_t highByte = tile[row * 2 + 1];
+        for (int x = 0; x < 8; x++) {
+            uint8_t lowBit = (lowByte >> (7 - x)) & 1;
+            uint8_t highBit = (highByte >> (7 - x)) & 1;
+            pixels[tileIndex][row][x] = (highBit << 1) | lowBit;
+        }
+    }
+    dirty[tileIndex] = false;
+}
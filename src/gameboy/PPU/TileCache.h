@@ -0,0 +1,66 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#define TILE_AMOUNT         384
+#define TILE_DATA_SIZE      16
+#define TILE_DATA_START     0x8000
+#define TILE_DATA_END       0x97ff
+
+/**
+ * This class keeps the tiles in VRAM decoded into one color number (0-3) per pixel, so that the PPU does not
+ * need to combine the two bitplanes of a tile row for every pixel it draws.
+ * A tile is decoded the first time it is used after any of its bytes have been written.
+ */
+class TileCache {
+public:
+    /**
+     * @param tileData the tile data in VRAM, TILE_AMOUNT * TILE_DATA_SIZE bytes starting at TILE_DATA_START.
+     */
+    explicit TileCache(const uint8_t* tileData);
+
+    /**
+     * Marks the tile containing a byte of tile data as changed.
+     * @param offset offset of the byte from TILE_DATA_START.
+     */
+    void invalidate(uint16_t offset) {
+        dirty[offset / TILE_DATA_SIZE] = true;
+    }
+
+    /**
+     * Marks every tile as changed, for when VRAM is replaced as a whole.
+     */
+    void invalidateAll();
+
+    /**
+     * Marks the tiles that differ from new tile data as changed, for when VRAM is about to be replaced as a whole
+     * with mostly the same tiles, such as when a save state is loaded.
+     * @param newTileData the tile data replacing the current one, TILE_AMOUNT * TILE_DATA_SIZE bytes.
+     */
+    void invalidateChanged(const uint8_t* newTileData);
+
+    /**
+     * Returns a row of a tile decoded into color numbers, the leftmost pixel first.
+     * @param tileIndex index of the tile counted from TILE_DATA_START, 0-383.
+     * @param row row of the tile, 0-7.
+     * @return eight color numbers.
+     */
+    const uint8_t* getRow(uint16_t tileIndex, uint8_t row) {
+        if (dirty[tileIndex]) {
+            decode(tileIndex);
+        }
+        return pixels[tileIndex][row].data();
+    }
+
+private:
+    const uint8_t* tileData;
+    std::array<std::array<std::array<uint8_t, 8>, 8>, TILE_AMOUNT> pixels{};
+    std::array<bool, TILE_AMOUNT> dirty{};
+
+    /**
+     * Decodes all rows of a tile from VRAM.
+     * @param tileIndex index of the tile counted from TILE_DATA_START.
+     */
+    void decode(uint16_t tileIndex);
+};
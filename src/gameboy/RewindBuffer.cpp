@@ -0,0 +1,228 @@
+#include "RewindBuffer.h"
+
+#include <algorithm> // copy, fill
+#include <cstring> // memcpy
+
+// Shorter runs of unchanged bytes are kept in the literal bytes, as a new run costs at least two bytes
+#define REWIND_MIN_ZERO_RUN 4
+
+RewindBuffer::RewindBuffer(size_t capacity, int keyframeInterval)
+    : capacity{capacity}
+    , keyframeInterval{keyframeInterval}
+    , stateSize{0} {}
+
+bool RewindBuffer::record(GameBoy &gameBoy) {
+    if (!gameBoy.isOn()) {
+        return false;
+    }
+    size_t size = gameBoy.saveStateSize();
+    if (size != stateSize) {
+        // Another game, the worst case of the encoding is a little larger than the state itself
+        stateSize = size;
+        snapshots.clear();
+        keyframe.assign(stateSize, 0);
+        state.assign(stateSize, 0);
+        encoded.assign(stateSize * 2 + 16, 0);
+    }
+    if (ring.size() != capacity) {
+        ring.assign(capacity, 0);
+    }
+    if (gameBoy.saveState(state.data(), state.size()) == 0) {
+        return false;
+    }
+
+    bool isKeyframe = snapshots.empty() || snapshots.back().keyframeDistance + 1 >= keyframeInterval;
+    size_t encodedSize = encode(state.data(), isKeyframe ? nullptr : keyframe.data());
+    size_t offset;
+    if (!allocate(encodedSize, !isKeyframe, offset)) {
+        if (isKeyframe) {
+            return false;
+        }
+        // The keyframe would have to be dropped, so start over with a new one
+        isKeyframe = true;
+        encodedSize = encode(state.data(), nullptr);
+        if (!allocate(encodedSize, false, offset)) {
+            return false;
+        }
+    }
+
+    std::memcpy(ring.data() + offset, encoded.data(), encodedSize);
+    int keyframeDistance = isKeyframe ? 0 : snapshots.back().keyframeDistance + 1;
+    snapshots.push_back({offset, encodedSize, keyframeDistance});
+    if (isKeyframe) {
+        std::copy(state.begin(), state.end(), keyframe.begin());
+    }
+    return true;
+}
+
+bool RewindBuffer::stepBack(GameBoy &gameBoy) {
+    if (snapshots.empty()) {
+        return false;
+    }
+    Snapshot snapshot = snapshots.back();
+    snapshots.pop_back();
+
+    if (snapshot.keyframeDistance == 0) {
+        std::fill(state.begin(), state.end(), 0);
+    } else {
+        std::copy(keyframe.begin(), keyframe.end(), state.begin());
+    }
+    decode(snapshot, state.data());
+
+    // The snapshots left depend on the previous keyframe
+    if (snapshot.keyframeDistance == 0 && !snapshots.empty()) {
+        restoreKeyframe();
+    }
+
+    if (!gameBoy.loadState(state.data(), state.size())) {
+        clear();
+        return false;
+    }
+    return true;
+}
+
+void RewindBuffer::clear() {
+    snapshots.clear();
+}
+
+void RewindBuffer::configure(size_t capacity, int keyframeInterval) {
+    this->capacity = capacity;
+    this->keyframeInterval = keyframeInterval;
+    snapshots.clear();
+    ring = std::vector<uint8_t>();
+}
+
+size_t RewindBuffer::getSnapshotCount() const {
+    return snapshots.size();
+}
+
+size_t RewindBuffer::getUsedBytes() const {
+    size_t used = 0;
+    for (const Snapshot& snapshot : snapshots) {
+        used += snapshot.size;
+    }
+    return used;
+}
+
+bool RewindBuffer::allocate(size_t size, bool keepKeyframe, size_t& offset) {
+    if (size > capacity) {
+        return false;
+    }
+    while (!snapshots.empty()) {
+        const Snapshot& oldest = snapshots.front();
+        const Snapshot& newest = snapshots.back();
+        size_t end = newest.offset + newest.size;
+        if (newest.offset >= oldest.offset) {
+            // Free space after the newest snapshot, or at the start of the ring
+            if (capacity - end >= size) {
+                offset = end;
+                return true;
+            }
+            if (oldest.offset >= size) {
+                offset = 0;
+                return true;
+            }
+        } else if (oldest.offset - end >= size) {
+            // Wrapped around, free space between the newest and the oldest snapshot
+            offset = end;
+            return true;
+        }
+
+        if (keepKeyframe && snapshots.size() - 1 - newest.keyframeDistance == 0) {
+            return false;
+        }
+        dropOldestKeyframe();
+    }
+    offset = 0;
+    return true;
+}
+
+void RewindBuffer::dropOldestKeyframe() {
+    snapshots.pop_front();
+    while (!snapshots.empty() && snapshots.front().keyframeDistance != 0) {
+        snapshots.pop_front();
+    }
+}
+
+size_t RewindBuffer::encode(const uint8_t *current, const uint8_t *reference) {
+    // Sequence of: number of unchanged bytes, number of changed bytes, the XOR of the changed bytes
+    auto diff = [current, reference](size_t i) -> uint8_t {
+        return reference ? current[i] ^ reference[i] : current[i];
+    };
+
+    size_t position = 0;
+    size_t written = 0;
+    while (position < stateSize) {
+        size_t zeroRunStart = position;
+        while (position < stateSize && diff(position) == 0) {
+            position++;
+        }
+        size_t literalStart = position;
+        while (position < stateSize) {
+            if (diff(position) == 0) {
+                size_t run = 0;
+                while (run < REWIND_MIN_ZERO_RUN && position + run < stateSize && diff(position + run) == 0) {
+                    run++;
+                }
+                if (run == REWIND_MIN_ZERO_RUN || position + run == stateSize) {
+                    break;
+                }
+                position += run;
+            } else {
+                position++;
+            }
+        }
+
+        written += writeVarint(&encoded[written], literalStart - zeroRunStart);
+        written += writeVarint(&encoded[written], position - literalStart);
+        for (size_t i = literalStart; i < position; i++) {
+            encoded[written++] = diff(i);
+        }
+    }
+    return written;
+}
+
+void RewindBuffer::decode(const Snapshot &snapshot, uint8_t *target) const {
+    const uint8_t* in = ring.data() + snapshot.offset;
+    const uint8_t* end = in + snapshot.size;
+    size_t position = 0;
+    while (in < end) {
+        size_t zeroRun;
+        size_t literalLength;
+        in += readVarint(in, zeroRun);
+        in += readVarint(in, literalLength);
+        position += zeroRun;
+        for (size_t i = 0; i < literalLength; i++) {
+            target[position++] ^= *in++;
+        }
+    }
+}
+
+void RewindBuffer::restoreKeyframe() {
+    const Snapshot& keyframeSnapshot = snapshots[snapshots.size() - 1 - snapshots.back().keyframeDistance];
+    std::fill(keyframe.begin(), keyframe.end(), 0);
+    decode(keyframeSnapshot, keyframe.data());
+}
+
+size_t RewindBuffer::writeVarint(uint8_t *out, size_t value) {
+    size_t written = 0;
+    while (value >= 0x80) {
+        out[written++] = (value & 0x7f) | 0x80;
+        value >>= 7;
+    }
+    out[written++] = value;
+    return written;
+}
+
+size_t RewindBuffer::readVarint(const uint8_t *in, size_t &value) {
+    size_t read = 0;
+    int shift = 0;
+    value = 0;
+    uint8_t byte;
+    do {
+        byte = in[read++];
+        value |= static_cast<size_t>(byte & 0x7f) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    return read;
+}
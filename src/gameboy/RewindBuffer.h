@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef> // size_t
+#include <deque>
+#include <vector>
+
+#include "GameBoy.h"
+
+/**
+ * This class records save states of a GameBoy into a ring buffer of fixed size, so that the emulation can be
+ * stepped backwards. Most snapshots are stored as the difference (XOR) to the latest keyframe, which is a complete
+ * snapshot, run-length encoded so that unchanged memory takes almost no space. When the buffer is full the oldest
+ * keyframe is dropped together with the snapshots depending on it.
+ */
+class RewindBuffer {
+public:
+    /**
+     * @param capacity size of the ring buffer in bytes, allocated when the first snapshot is recorded.
+     * @param keyframeInterval number of snapshots from one keyframe to the next.
+     */
+    RewindBuffer(size_t capacity, int keyframeInterval);
+
+    /**
+     * Records a snapshot of the GameBoy. Memory is only allocated for the first snapshot of a game.
+     * @param gameBoy the emulator to record.
+     * @return false if the snapshot could not be recorded.
+     */
+    bool record(GameBoy& gameBoy);
+
+    /**
+     * Restores the latest snapshot and removes it from the buffer.
+     * @param gameBoy the emulator to restore.
+     * @return false if there is no snapshot left.
+     */
+    bool stepBack(GameBoy& gameBoy);
+
+    /**
+     * Removes all snapshots, should be called when another game is loaded.
+     */
+    void clear();
+
+    /**
+     * Changes the size of the ring buffer and the keyframe interval. All snapshots are removed.
+     * @param capacity size of the ring buffer in bytes.
+     * @param keyframeInterval number of snapshots from one keyframe to the next.
+     */
+    void configure(size_t capacity, int keyframeInterval);
+
+    /**
+     * Returns the number of snapshots that can be stepped back to.
+     */
+    size_t getSnapshotCount() const;
+
+    /**
+     * Returns the number of bytes of the ring buffer used by snapshots.
+     */
+    size_t getUsedBytes() const;
+
+private:
+    struct Snapshot {
+        size_t offset;
+        size_t size;
+        // Number of snapshots since the keyframe, 0 for a keyframe
+        int keyframeDistance;
+    };
+
+    size_t capacity;
+    int keyframeInterval;
+    size_t stateSize;
+
+    std::vector<uint8_t> ring;
+    std::deque<Snapshot> snapshots;
+
+    // The keyframe the newest snapshot depends on, the state being recorded or restored and its encoding
+    std::vector<uint8_t> keyframe;
+    std::vector<uint8_t> state;
+    std::vector<uint8_t> encoded;
+
+    /**
+     * Finds space for a snapshot in the ring, dropping the oldest keyframes and their snapshots if needed.
+     * @param size size of the snapshot in bytes.
+     * @param keepKeyframe whether the keyframe of the newest snapshot must be kept.
+     * @param offset set to where the snapshot should be written.
+     * @return false if there is not enough space.
+     */
+    bool allocate(size_t size, bool keepKeyframe, size_t& offset);
+
+    /**
+     * Removes the oldest keyframe and every snapshot depending on it.
+     */
+    void dropOldestKeyframe();
+
+    /**
+     * Run-length encodes the XOR of two states of stateSize bytes into encoded.
+     * @param current the state to encode.
+     * @param reference the state it is compared to, or nullptr to encode the complete state.
+     * @return the number of encoded bytes.
+     */
+    size_t encode(const uint8_t* current, const uint8_t* reference);
+
+    /**
+     * Decodes a snapshot in the ring and applies it with XOR to a state of stateSize bytes.
+     * @param snapshot the snapshot to decode.
+     * @param target the reference state, which becomes the state of the snapshot.
+     */
+    void decode(const Snapshot& snapshot, uint8_t* target) const;
+
+    /**
+     * Decodes the keyframe of the newest snapshot into keyframe.
+     */
+    void restoreKeyframe();
+
+    /**
+     * Writes a number using 7 bits per byte, the highest bit tells if more bytes follow.
+     * @param out where to write.
+     * @param value number to write.
+     * @return the number of bytes written.
+     */
+    static size_t writeVarint(uint8_t* out, size_t value);
+
+    /**
+     * Reads a number written by writeVarint.
+     * @param in where to read.
+     * @param value set to the number read.
+     * @return the number of bytes read.
+     */
+    static size_t readVarint(const uint8_t* in, size_t& value);
+};
@@ -0,0 +1,31 @@
+#include "RunAhead.h"
+
+#include <algorithm> // copy
+
+RunAhead::RunAhead() = default;
+
+bool RunAhead::run(GameBoy &gameBoy, int frames, uint8_t *frame) {
+    state.resize(gameBoy.saveStateSize());
+    if (gameBoy.saveState(state.data(), state.size()) == 0) {
+        return false;
+    }
+    size_t serialLength = gameBoy.getSerialOutput().size();
+
+    for (int i = 0; i < frames; i++) {
+        // Only the last frame is displayed
+        gameBoy.setRenderSkipping(i + 1 < frames);
+        if (gameBoy.isReadyToDraw()) {
+            gameBoy.confirmDraw();
+        }
+        while (!gameBoy.isReadyToDraw()) {
+            gameBoy.step(nullptr);
+        }
+    }
+    gameBoy.setRenderSkipping(false);
+    const uint8_t* frameBuffer = gameBoy.getFrameBuffer();
+    std::copy(frameBuffer, frameBuffer + LCD_WIDTH * LCD_HEIGHT, frame);
+
+    gameBoy.loadState(state.data(), state.size());
+    gameBoy.truncateSerialOutput(serialLength);
+    return true;
+}
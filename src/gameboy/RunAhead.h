@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "GameBoy.h"
+
+/**
+ * This class hides the input latency of a game by displaying frames from the future. After a frame is emulated,
+ * the emulation runs a number of frames ahead with the same input held down, and is then restored to the state
+ * it was saved in. A game that reacts to input a frame after reading it is then displayed reacting at once.
+ * The frames run ahead produce no sound, and only the last of them is drawn.
+ */
+class RunAhead {
+public:
+    RunAhead();
+
+    /**
+     * Runs frames ahead of the GameBoy and restores it. Memory is only allocated for the first call with a game.
+     * Render skipping is disabled afterwards.
+     * @param gameBoy the emulator, between two frames.
+     * @param frames number of frames to run ahead, at least 1.
+     * @param frame memory of LCD_WIDTH * LCD_HEIGHT bytes, set to the frame buffer after the last frame run ahead.
+     * @return false if no game is loaded, in which case nothing is run and frame is not changed.
+     */
+    bool run(GameBoy& gameBoy, int frames, uint8_t* frame);
+
+private:
+    // The state the emulation is restored to
+    std::vector<uint8_t> state;
+};
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef> // size_t
+#include <cstring> // memcpy
+#include <type_traits> // is_trivially_copyable
+
+// Increase whenever the layout of a save state changes, old save states are then rejected
+#define SAVE_STATE_VERSION  3
+#define SAVE_STATE_MAGIC    0x5353424c // "LBSS"
+
+/**
+ * Writes the state of the emulator into a flat buffer provided by the caller, without allocating memory.
+ * Without a buffer nothing is written but the size is still counted, which is used to find out how large
+ * the buffer needs to be.
+ */
+class StateWriter {
+public:
+    /**
+     * @param buffer memory to write to, or nullptr to only count the size.
+     * @param capacity size of buffer in bytes.
+     */
+    StateWriter(uint8_t* buffer, size_t capacity)
+        : buffer{buffer}
+        , capacity{capacity}
+        , position{0}
+        , overflow{false} {}
+
+    /**
+     * Write the bytes of a value.
+     * @param value value to write, registers with bit fields should be written through the byte they share.
+     */
+    template<typename T>
+    void write(const T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be written to a save state");
+        writeBytes(&value, sizeof(T));
+    }
+
+    /**
+     * Write a block of memory.
+     * @param data memory to write.
+     * @param size number of bytes.
+     */
+    void writeBytes(const void* data, size_t size) {
+        if (buffer) {
+            if (overflow || size > capacity - position) {
+                overflow = true;
+                return;
+            }
+            std::memcpy(buffer + position, data, size);
+        }
+        position += size;
+    }
+
+    /**
+     * @return the number of bytes written, or counted if there is no buffer.
+     */
+    size_t getSize() const {
+        return position;
+    }
+
+    /**
+     * @return true if the buffer was too small to hold everything.
+     */
+    bool isOverflowed() const {
+        return overflow;
+    }
+
+private:
+    uint8_t* buffer;
+    size_t capacity;
+    size_t position;
+    bool overflow;
+};
+
+/**
+ * Reads the state of the emulator from a flat buffer written by StateWriter, in the same order as written.
+ */
+class StateReader {
+public:
+    /**
+     * @param buffer memory to read from.
+     * @param size size of buffer in bytes.
+     */
+    StateReader(const uint8_t* buffer, size_t size)
+        : buffer{buffer}
+        , size{size}
+        , position{0}
+        , underflow{false} {}
+
+    /**
+     * Read the bytes of a value. The value is left unchanged if the buffer has ended.
+     * @param value value to read into.
+     */
+    template<typename T>
+    void read(T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be read from a save state");
+        readBytes(&value, sizeof(T));
+    }
+
+    /**
+     * Read the bytes of a value and return it.
+     */
+    template<typename T>
+    T read() {
+        T value{};
+        read(value);
+        return value;
+    }
+
+    /**
+     * Read a block of memory. The memory is left unchanged if the buffer has ended.
+     * @param data memory to read into.
+     * @param count number of bytes.
+     */
+    void readBytes(void* data, size_t count) {
+        if (underflow || count > size - position) {
+            underflow = true;
+            return;
+        }
+        std::memcpy(data, buffer + position, count);
+        position += count;
+    }
+
+    /**
+     * @return true if there was not enough data for everything that was read.
+     */
+    bool isUnderflowed() const {
+        return underflow;
+    }
+
+private:
+    const uint8_t* buffer;
+    size_t size;
+    size_t position;
+    bool underflow;
+};
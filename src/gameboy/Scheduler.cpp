@@ -0,0 +1,79 @@
+#include "Scheduler.h"
+#include "PPU/PPU.h"
+#include "APU/APU.h"
+#include "MMU/Timer.h"
+
+#include <algorithm> // min_element
+#include <utility>
+
+Scheduler::Scheduler(std::shared_ptr<PPU> ppu, std::shared_ptr<APU> apu, std::shared_ptr<Timer> timer)
+    : ppu{std::move(ppu)}
+    , apu{std::move(apu)}
+    , timer{std::move(timer)}
+    , audioOutput{nullptr} {
+    reset();
+}
+
+void Scheduler::reset() {
+    cycles = 0;
+    lastSynchronized = 0;
+    eventCycles.fill(0);
+    // Update the devices after the first instruction, which also schedules their first events
+    nextEventCycle = 0;
+}
+
+bool Scheduler::advance(uint16_t cycles) {
+    this->cycles += cycles;
+    if (this->cycles < nextEventCycle) {
+        return false;
+    }
+    synchronize();
+    return true;
+}
+
+void Scheduler::synchronize() {
+    if (cycles == lastSynchronized) {
+        return;
+    }
+    // Never more than a scanline, as the PPU always has an event within one
+    auto pendingCycles = static_cast<uint16_t>(cycles - lastSynchronized);
+    lastSynchronized = cycles;
+
+    ppu->update(pendingCycles);
+    apu->update(pendingCycles, audioOutput);
+    timer->update(pendingCycles);
+
+    reschedule();
+}
+
+void Scheduler::reschedule() {
+    scheduleEvent(PPU_MODE_TRANSITION, ppu->cyclesUntilNextEvent());
+    scheduleEvent(TIMER_OVERFLOW, timer->cyclesUntilNextEvent());
+    scheduleEvent(APU_FRAME_SEQUENCER, apu->cyclesUntilNextEvent());
+
+    nextEventCycle = *std::min_element(eventCycles.begin(), eventCycles.end());
+}
+
+uint16_t Scheduler::cyclesUntilNextEvent() const {
+    if (nextEventCycle <= cycles) {
+        return 1;
+    }
+    // Never more than a scanline, as the PPU always has an event within one
+    return static_cast<uint16_t>(nextEventCycle - cycles);
+}
+
+uint64_t Scheduler::getCycles() const {
+    return cycles;
+}
+
+void Scheduler::setAudioOutput(IAudioOutput *output) {
+    audioOutput = output;
+}
+
+void Scheduler::scheduleEvent(Event event, uint32_t cyclesUntilEvent) {
+    if (cyclesUntilEvent == NO_SCHEDULED_EVENT) {
+        eventCycles[event] = UINT64_MAX;
+    } else {
+        eventCycles[event] = lastSynchronized + cyclesUntilEvent;
+    }
+}
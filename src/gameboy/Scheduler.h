@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <memory> // ptr
+#include <array> // array
+#include "APU/IAudioOutput.h"
+
+// Forward declaration
+class PPU;
+class APU;
+class Timer;
+
+/**
+ * This class keeps the devices driven by the system clock in step with the CPU.
+ * Instead of updating every device after each CPU-instruction, every device reports how many cycles are left
+ * until its next event (PPU mode transition, timer overflow or APU frame sequencer step).
+ * The devices are only updated when the earliest of these events is reached, or when the MMU is about to
+ * access one of their registers.
+ */
+class Scheduler {
+public:
+    Scheduler(std::shared_ptr<PPU> ppu, std::shared_ptr<APU> apu, std::shared_ptr<Timer> timer);
+
+    /**
+     * Resets the clock. The devices are updated and rescheduled after the first advance.
+     */
+    void reset();
+
+    /**
+     * Advances the clock after a CPU-instruction and updates the devices if an event has been reached.
+     * @param cycles cycles the CPU-instruction took.
+     * @return true if an event was reached and the devices have been updated.
+     */
+    bool advance(uint16_t cycles);
+
+    /**
+     * Updates all devices with the cycles that have passed since they were last updated.
+     * Needs to be called before a device register is accessed.
+     */
+    void synchronize();
+
+    /**
+     * Asks all devices for their next event.
+     * Needs to be called after a device register has been written, as that might move the next event.
+     */
+    void reschedule();
+
+    /**
+     * Returns the number of cycles until the next event, at least 1.
+     * Interrupts are only requested by events, so this is also how long a halted CPU can idle.
+     */
+    uint16_t cyclesUntilNextEvent() const;
+
+    /**
+     * Returns the number of cycles since reset, up to the start of the current CPU-instruction.
+     * Devices that compute their state from the time, like the cartridge RTC, use this instead of being updated.
+     */
+    uint64_t getCycles() const;
+
+    /**
+     * Sets the audio output passed on to the APU when it is updated.
+     * @param output receives the samples synthesized by the APU, or nullptr if no samples are needed.
+     */
+    void setAudioOutput(IAudioOutput* output);
+
+private:
+    enum Event {
+        PPU_MODE_TRANSITION,
+        TIMER_OVERFLOW,
+        APU_FRAME_SEQUENCER,
+        EVENT_AMOUNT
+    };
+
+    std::shared_ptr<PPU> ppu;
+    std::shared_ptr<APU> apu;
+    std::shared_ptr<Timer> timer;
+    IAudioOutput* audioOutput;
+
+    // Cycles since reset, and the cycle when the devices were last updated
+    uint64_t cycles;
+    uint64_t lastSynchronized;
+
+    // The cycle each event is due, and the earliest of them
+    std::array<uint64_t, EVENT_AMOUNT> eventCycles{};
+    uint64_t nextEventCycle;
+
+    void scheduleEvent(Event event, uint32_t cyclesUntilEvent);
+};
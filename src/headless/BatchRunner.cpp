@@ -0,0 +1,133 @@
+#include "BatchRunner.h"
+
+#include <algorithm> // stable_sort
+#include <chrono> // steady_clock
+#include <fstream> // ifstream
+#include <iostream> // cerr
+#include <sstream> // istringstream
+
+#include "../gameboy/GameBoy.h"
+#include "../gameboy/Hash.h"
+
+BatchRunner::BatchRunner(size_t threadCount) : pool(threadCount) {}
+
+std::vector<BatchResult> BatchRunner::run(const std::vector<BatchJob>& jobs) {
+    std::vector<BatchResult> results(jobs.size());
+    for (size_t i = 0; i < jobs.size(); i++) {
+        // Every job writes its own result, nothing else is shared
+        pool.submit([&jobs, &results, i]() {
+            results[i] = runJob(jobs[i]);
+        });
+    }
+    pool.wait();
+    return results;
+}
+
+size_t BatchRunner::getThreadCount() const {
+    return pool.getThreadCount();
+}
+
+BatchResult BatchRunner::runJob(const BatchJob& job) {
+    auto start = std::chrono::steady_clock::now();
+    BatchResult result;
+
+    GameBoy gameBoy;
+    gameBoy.loadRom(job.bootPath, job.romPath, false);
+    if (!gameBoy.isOn()) {
+        return result;
+    }
+    result.loaded = true;
+
+    size_t nextInput = 0;
+    for (long frame = 0; frame < job.frames; frame++) {
+        while (nextInput < job.inputs.size() && job.inputs[nextInput].frame <= frame) {
+            gameBoy.joypadInput(job.inputs[nextInput].key, job.inputs[nextInput].action);
+            nextInput++;
+        }
+        // Only the last frame is looked at
+        gameBoy.setRenderSkipping(frame + 1 < job.frames);
+        while (!gameBoy.isReadyToDraw()) {
+            gameBoy.step(nullptr);
+        }
+        gameBoy.confirmDraw();
+        result.frames++;
+    }
+
+    result.frameHash = Hash::compute(gameBoy.getFrameBuffer(), LCD_WIDTH * LCD_HEIGHT);
+    const uint8_t* ram = gameBoy.getWorkRam();
+    result.ram.assign(ram, ram + (WRAM_END - WRAM_START + 1));
+    result.serialOutput = gameBoy.getSerialOutput();
+    result.cycles = gameBoy.getCycles();
+    std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+    result.seconds = seconds.count();
+    return result;
+}
+
+bool BatchRunner::loadJobs(const std::string& path, std::vector<BatchJob>& jobs) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Unable to open file: " << path << std::endl;
+        return false;
+    }
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        std::istringstream words(line);
+        BatchJob job;
+        if (!(words >> job.romPath) || job.romPath[0] == '#') {
+            continue;
+        }
+        std::string inputScript;
+        if (!(words >> job.frames) || job.frames <= 0) {
+            std::cerr << path << ":" << lineNumber << ": expected a ROM and a number of frames" << std::endl;
+            return false;
+        }
+        if (words >> inputScript && !loadInputScript(inputScript, job.inputs)) {
+            return false;
+        }
+        jobs.push_back(std::move(job));
+    }
+    return true;
+}
+
+bool BatchRunner::loadInputScript(const std::string& path, std::vector<BatchInput>& inputs) {
+    static const char* const keyNames[] = {"right", "left", "up", "down", "a", "b", "select", "start"};
+
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Unable to open file: " << path << std::endl;
+        return false;
+    }
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        std::istringstream words(line);
+        std::string first;
+        if (!(words >> first) || first[0] == '#') {
+            continue;
+        }
+
+        BatchInput input{};
+        std::string action;
+        std::string key;
+        std::istringstream frame(first);
+        bool valid = frame >> input.frame && input.frame >= 0 && words >> action >> key &&
+                     (action == "press" || action == "release");
+        input.action = action == "press" ? JOYPAD_PRESS : JOYPAD_RELEASE;
+        auto keyName = std::find(std::begin(keyNames), std::end(keyNames), key);
+        if (!valid || keyName == std::end(keyNames)) {
+            std::cerr << path << ":" << lineNumber << ": expected a frame, press or release, and a key" << std::endl;
+            return false;
+        }
+        input.key = static_cast<uint8_t>(keyName - std::begin(keyNames));
+        inputs.push_back(input);
+    }
+    std::stable_sort(inputs.begin(), inputs.end(), [](const BatchInput& a, const BatchInput& b) {
+        return a.frame < b.frame;
+    });
+    return true;
+}
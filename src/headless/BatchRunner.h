@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef> // size_t
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../helpers/WorkStealingPool.h"
+
+/**
+ * A press or release of a joypad key, applied before the given frame is emulated.
+ */
+struct BatchInput {
+    long frame;
+    uint8_t key;
+    uint8_t action;
+};
+
+/**
+ * A game ROM to run for a number of frames with scripted input.
+ */
+struct BatchJob {
+    std::string romPath;
+    // Skipped if empty
+    std::string bootPath;
+    long frames = 0;
+    // Sorted by frame
+    std::vector<BatchInput> inputs;
+};
+
+/**
+ * The state of the emulation after a job.
+ */
+struct BatchResult {
+    bool loaded = false;
+    // Hash of the color numbers of the last frame
+    uint64_t frameHash = 0;
+    std::vector<uint8_t> ram;
+    std::string serialOutput;
+    // Machine cycles emulated
+    uint64_t cycles = 0;
+    long frames = 0;
+    double seconds = 0;
+};
+
+/**
+ * This class runs many independent emulation jobs in parallel, one Game Boy per job, on a work-stealing pool
+ * with one thread per core. The Game Boys share nothing but the ROM images, which are read-only, so a job gives
+ * the same result on any thread and with any number of threads. Save files are not loaded, as they are shared
+ * between the jobs of a game and the RTC saved in them depends on the clock of the host.
+ */
+class BatchRunner {
+public:
+    /**
+     * @param threadCount number of threads, or 0 for one per core of the host.
+     */
+    explicit BatchRunner(size_t threadCount = 0);
+
+    /**
+     * Runs jobs and waits for them to finish.
+     * @param jobs jobs to run.
+     * @return the result of each job, in the order of the jobs.
+     */
+    std::vector<BatchResult> run(const std::vector<BatchJob>& jobs);
+
+    /**
+     * Returns the number of threads jobs are run on.
+     */
+    size_t getThreadCount() const;
+
+    /**
+     * Runs a single job on the calling thread.
+     * @param job job to run.
+     * @return the result of the job, with loaded set to false if the ROM could not be loaded.
+     */
+    static BatchResult runJob(const BatchJob& job);
+
+    /**
+     * Reads jobs from a text file, one job per line written as: rom frames [input script]
+     * Empty lines and lines starting with # are ignored. Paths are relative to the working directory.
+     * @param path path of the file.
+     * @param jobs set to the jobs read.
+     * @return false if the file, or an input script, could not be read or is invalid.
+     */
+    static bool loadJobs(const std::string& path, std::vector<BatchJob>& jobs);
+
+    /**
+     * Reads an input script from a text file, one input per line written as: frame press|release key
+     * where key is one of right, left, up, down, a, b, select or start.
+     * Empty lines and lines starting with # are ignored.
+     * @param path path of the file.
+     * @param inputs set to the inputs read, sorted by frame.
+     * @return false if the file could not be read or is invalid.
+     */
+    static bool loadInputScript(const std::string& path, std::vector<BatchInput>& inputs);
+
+private:
+    WorkStealingPool pool;
+};
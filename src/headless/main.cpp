@@ -0,0 +1,270 @@
+#include "../gameboy/GameBoy.h"
+#include "../gameboy/Definitions.h"
+#include "../gameboy/Hash.h"
+#include "../gameboy/InputMovie.h"
+#include "BatchRunner.h"
+
+#include <algorithm> // max
+#include <chrono> // steady_clock
+#include <cstdlib> // strtol
+#include <fstream> // ofstream
+#include <iomanip> // setw
+#include <iostream> // cout
+#include <string> // string
+#include <thread> // hardware_concurrency
+
+/**
+ * Options given on the command line.
+ */
+struct Options {
+    std::string romPath;
+    std::string bootPath;
+    long frames = 600;
+    std::string untilSerial;
+    std::string frameDumpPath;
+    std::string serialDumpPath;
+    bool idleLoopSkipping = false;
+    std::string moviePath;
+    std::string batchPath;
+    long threads = 0;
+    std::string dumpDirectory;
+    bool scaling = false;
+};
+
+void printUsage() {
+    std::cout << "Usage: LameBoyHeadless <rom> [options]" << std::endl
+              << "       LameBoyHeadless --batch <jobs> [batch options]" << std::endl
+              << "  --frames <n>          Number of frames to run, default 600" << std::endl
+              << "  --until-serial <text> Stop early when the serial output contains text" << std::endl
+              << "  --boot <path>         Boot ROM, skipped if not given" << std::endl
+              << "  --dump-frame <path>   Write the last frame as a binary PGM image" << std::endl
+              << "  --dump-serial <path>  Write the serial output to a file" << std::endl
+              << "  --idle-skip           Skip idle loops polling LY, STAT or the timer" << std::endl
+              << "  --movie <path>        Replay an input movie to its end, recorded with the same ROM" << std::endl
+              << "Batch options:" << std::endl
+              << "  --batch <jobs>        Run the jobs in a file, one per line: rom frames [input script]" << std::endl
+              << "  --threads <n>         Number of threads, default one per core" << std::endl
+              << "  --dump-dir <path>     Write the RAM and serial output of every job to a directory" << std::endl
+              << "  --scaling             Run the jobs with 1, 2, 4... threads up to one per core, not with --threads"
+              << std::endl;
+}
+
+bool parseOptions(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--frames" && hasValue) {
+            options.frames = std::strtol(argv[++i], nullptr, 10);
+        } else if (arg == "--until-serial" && hasValue) {
+            options.untilSerial = argv[++i];
+        } else if (arg == "--boot" && hasValue) {
+            options.bootPath = argv[++i];
+        } else if (arg == "--dump-frame" && hasValue) {
+            options.frameDumpPath = argv[++i];
+        } else if (arg == "--dump-serial" && hasValue) {
+            options.serialDumpPath = argv[++i];
+        } else if (arg == "--idle-skip") {
+            options.idleLoopSkipping = true;
+        } else if (arg == "--movie" && hasValue) {
+            options.moviePath = argv[++i];
+        } else if (arg == "--batch" && hasValue) {
+            options.batchPath = argv[++i];
+        } else if (arg == "--threads" && hasValue) {
+            options.threads = std::strtol(argv[++i], nullptr, 10);
+        } else if (arg == "--dump-dir" && hasValue) {
+            options.dumpDirectory = argv[++i];
+        } else if (arg == "--scaling") {
+            options.scaling = true;
+        } else if (options.romPath.empty() && arg.rfind("--", 0) != 0) {
+            options.romPath = arg;
+        } else {
+            std::cerr << "Invalid argument: " << arg << std::endl;
+            return false;
+        }
+    }
+    if (!options.batchPath.empty()) {
+        if (options.scaling && options.threads != 0) {
+            std::cerr << "--scaling chooses the number of threads, it cannot be used with --threads" << std::endl;
+            return false;
+        }
+        return options.romPath.empty() && options.threads >= 0;
+    }
+    return !options.romPath.empty() && options.frames > 0;
+}
+
+bool dumpFrame(GameBoy& gameBoy, const std::string& path) {
+    std::ofstream file(path, std::ios::out | std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Unable to open file: " << path << std::endl;
+        return false;
+    }
+    auto texture = gameBoy.getScreenTexture();
+    file << "P5\n" << LCD_WIDTH << " " << LCD_HEIGHT << "\n255\n";
+    file.write(reinterpret_cast<const char*>(texture.get()), LCD_WIDTH * LCD_HEIGHT);
+    return true;
+}
+
+bool dumpSerial(GameBoy& gameBoy, const std::string& path) {
+    std::ofstream file(path, std::ios::out | std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Unable to open file: " << path << std::endl;
+        return false;
+    }
+    file << gameBoy.getSerialOutput();
+    return true;
+}
+
+bool dumpJob(const BatchResult& result, const std::string& directory, size_t index) {
+    std::string path = directory + "/job" + std::to_string(index);
+    std::ofstream ram(path + ".ram", std::ios::out | std::ios::binary);
+    std::ofstream serial(path + ".serial", std::ios::out | std::ios::binary);
+    if (!ram.is_open() || !serial.is_open()) {
+        std::cerr << "Unable to open files: " << path << std::endl;
+        return false;
+    }
+    ram.write(reinterpret_cast<const char*>(result.ram.data()), result.ram.size());
+    serial << result.serialOutput;
+    return true;
+}
+
+/**
+ * Runs the jobs and prints the frames emulated per second by all threads together, then the result of every job.
+ * With --scaling the jobs are run once per number of threads, and the frames per second are also compared to
+ * running them on one thread.
+ */
+int runBatch(const Options& options) {
+    std::vector<BatchJob> jobs;
+    if (!BatchRunner::loadJobs(options.batchPath, jobs)) {
+        return 1;
+    }
+
+    std::vector<size_t> threadCounts;
+    if (options.scaling) {
+        size_t cores = std::max(1u, std::thread::hardware_concurrency());
+        for (size_t threads = 1; threads < cores; threads *= 2) {
+            threadCounts.push_back(threads);
+        }
+        threadCounts.push_back(cores);
+    } else {
+        threadCounts.push_back(static_cast<size_t>(options.threads));
+    }
+
+    std::vector<BatchResult> results;
+    double singleThreadFps = 0;
+    for (size_t threadCount : threadCounts) {
+        BatchRunner runner(threadCount);
+        auto start = std::chrono::steady_clock::now();
+        results = runner.run(jobs);
+        std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+
+        long frames = 0;
+        for (const BatchResult& result : results) {
+            frames += result.frames;
+        }
+        double fps = frames / seconds.count();
+        std::cout << "Threads: " << runner.getThreadCount()
+                  << " Seconds: " << seconds.count()
+                  << " Frames per second: " << fps;
+        if (options.scaling) {
+            if (threadCount == 1) {
+                singleThreadFps = fps;
+            }
+            std::cout << " Scaling: " << fps / singleThreadFps;
+        }
+        std::cout << std::endl;
+    }
+
+    bool loaded = true;
+    for (size_t i = 0; i < results.size(); i++) {
+        const BatchResult& result = results[i];
+        std::cout << "Job " << i << " " << jobs[i].romPath;
+        if (!result.loaded) {
+            std::cout << " failed to load" << std::endl;
+            loaded = false;
+            continue;
+        }
+        std::cout << " frames: " << result.frames << " cycles: " << result.cycles << " frame hash: "
+                  << std::hex << std::setw(16) << std::setfill('0') << result.frameHash << std::dec
+                  << " serial bytes: " << result.serialOutput.size() << std::endl;
+        if (!options.dumpDirectory.empty() && !dumpJob(result, options.dumpDirectory, i)) {
+            return 1;
+        }
+    }
+    return loaded ? 0 : 1;
+}
+
+/**
+ * Runs a ROM as fast as possible without window, graphics context or audio device, and reports the
+ * number of frames emulated per second. A replayed movie also reports a hash of the last frame, which only
+ * changes if the emulation does. Returns 0 on success, 1 on invalid arguments or files, and 2 if
+ * --until-serial was given but the text never appeared.
+ */
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage();
+        return 1;
+    }
+    if (!options.batchPath.empty()) {
+        return runBatch(options);
+    }
+
+    // A movie starts from a save state, which includes the xRAM
+    InputMovie movie;
+    bool replaying = !options.moviePath.empty();
+    GameBoy gameBoy;
+    gameBoy.loadRom(options.bootPath, options.romPath, !replaying);
+    if (!gameBoy.isOn()) {
+        std::cerr << "Unable to load ROM: " << options.romPath << std::endl;
+        return 1;
+    }
+    if (replaying) {
+        if (!movie.load(options.moviePath) || !movie.startReplay(gameBoy)) {
+            return 1;
+        }
+        options.frames = static_cast<long>(movie.getFrameCount());
+    }
+    gameBoy.setIdleLoopSkipping(options.idleLoopSkipping);
+
+    bool conditionMet = false;
+    long frames = 0;
+    auto start = std::chrono::steady_clock::now();
+    while (frames < options.frames && !conditionMet) {
+        if (replaying) {
+            gameBoy.setJoypadState(movie.getKeys(frames));
+        }
+        while (!gameBoy.isReadyToDraw()) {
+            gameBoy.step(nullptr);
+        }
+        gameBoy.confirmDraw();
+        frames++;
+
+        if (!options.untilSerial.empty()) {
+            conditionMet = gameBoy.getSerialOutput().find(options.untilSerial) != std::string::npos;
+        }
+    }
+    std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+
+    std::cout << "Frames: " << frames << std::endl
+              << "Seconds: " << seconds.count() << std::endl
+              << "Frames per second: " << frames / seconds.count() << std::endl;
+    if (replaying) {
+        std::cout << "Cycles: " << gameBoy.getCycles() << std::endl
+                  << "Frame hash: " << std::hex << std::setw(16) << std::setfill('0')
+                  << Hash::compute(gameBoy.getFrameBuffer(), LCD_WIDTH * LCD_HEIGHT) << std::dec << std::endl;
+    }
+    if (options.idleLoopSkipping) {
+        std::cout << "Skipped idle loop cycles: " << gameBoy.getIdleLoopSkippedCycles() << std::endl;
+    }
+
+    if (!options.frameDumpPath.empty() && !dumpFrame(gameBoy, options.frameDumpPath)) {
+        return 1;
+    }
+    if (!options.serialDumpPath.empty() && !dumpSerial(gameBoy, options.serialDumpPath)) {
+        return 1;
+    }
+    if (!options.untilSerial.empty() && !conditionMet) {
+        return 2;
+    }
+    return 0;
+}
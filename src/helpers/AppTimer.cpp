@@ -1,12 +1,20 @@
 #include "AppTimer.h"
 
+#include <thread> // sleep
+
 void AppTimer::tick() {
-    this->timeTicked = std::chrono::system_clock::now();
+    this->timeTicked = std::chrono::steady_clock::now();
 }
 
 float AppTimer::msSinceTick() const {
-    auto now = std::chrono::system_clock::now();
+    auto now = std::chrono::steady_clock::now();
     std::chrono::duration<float, std::milli> elapsedTime = now - this->timeTicked;
 
     return elapsedTime.count();
-}
\ No newline at end of file
+}
+
+void AppTimer::sleepUntil(float ms) const {
+    auto duration = std::chrono::duration<float, std::milli>(ms);
+    std::this_thread::sleep_until(
+            this->timeTicked + std::chrono::duration_cast<std::chrono::steady_clock::duration>(duration));
+}
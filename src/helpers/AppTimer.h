@@ -2,7 +2,8 @@
 
 #include <chrono>
 /**
- * A simple helper class for keeping how much system clock time has elapsed. Measured in milliseconds.
+ * A simple helper class for keeping how much time has elapsed, by a steady clock that is not affected by changes
+ * to the system time. Measured in milliseconds.
  */
 
 class AppTimer {
@@ -19,6 +20,14 @@ public:
      */
     [[nodiscard]] float msSinceTick() const;
 
+    /**
+     * Sleeps until a time after the stopwatch was started, with the precision of the clock rather than whole
+     * milliseconds. Returns immediately if that time has passed.
+     *
+     * @param ms time since the stopwatch was started, in milliseconds.
+     */
+    void sleepUntil(float ms) const;
+
 private:
-    std::chrono::time_point<std::chrono::system_clock> timeTicked;
+    std::chrono::time_point<std::chrono::steady_clock> timeTicked;
 };
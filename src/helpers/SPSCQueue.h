@@ -0,0 +1,97 @@
+#pragma once
+
+#include <algorithm> // min
+#include <array>
+#include <atomic>
+#include <cstddef> // size_t
+
+/**
+ * A lock-free queue of fixed capacity with a single producer thread and a single consumer thread.
+ * @tparam T type of the elements, should be cheap to copy.
+ * @tparam Capacity maximum number of elements in the queue, must be a power of two.
+ */
+template<typename T, size_t Capacity>
+class SPSCQueue {
+    static_assert(Capacity && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    SPSCQueue() : head{0}, tail{0} {}
+
+    /**
+     * Adds an element to the queue. Only to be used by the producer.
+     * @param value element to add.
+     * @return false if the queue is full, in which case the element is not added.
+     */
+    bool push(const T& value) {
+        size_t currentTail = tail.load(std::memory_order_relaxed);
+        if (currentTail - head.load(std::memory_order_acquire) == Capacity) {
+            return false;
+        }
+        elements[currentTail & (Capacity - 1)] = value;
+        tail.store(currentTail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Removes the oldest element from the queue. Only to be used by the consumer.
+     * @param value set to the removed element.
+     * @return false if the queue is empty.
+     */
+    bool pop(T& value) {
+        size_t currentHead = head.load(std::memory_order_relaxed);
+        if (currentHead == tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        value = elements[currentHead & (Capacity - 1)];
+        head.store(currentHead + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Adds as many of a sequence of elements as fit in the queue. Only to be used by the producer.
+     * @param values elements to add, the oldest first.
+     * @param count number of elements.
+     * @return the number of elements added.
+     */
+    size_t push(const T* values, size_t count) {
+        size_t currentTail = tail.load(std::memory_order_relaxed);
+        size_t free = Capacity - (currentTail - head.load(std::memory_order_acquire));
+        count = std::min(count, free);
+        for (size_t i = 0; i < count; i++) {
+            elements[(currentTail + i) & (Capacity - 1)] = values[i];
+        }
+        tail.store(currentTail + count, std::memory_order_release);
+        return count;
+    }
+
+    /**
+     * Removes up to count of the oldest elements from the queue. Only to be used by the consumer.
+     * @param values set to the removed elements, the oldest first.
+     * @param count maximum number of elements to remove.
+     * @return the number of elements removed.
+     */
+    size_t pop(T* values, size_t count) {
+        size_t currentHead = head.load(std::memory_order_relaxed);
+        size_t available = tail.load(std::memory_order_acquire) - currentHead;
+        count = std::min(count, available);
+        for (size_t i = 0; i < count; i++) {
+            values[i] = elements[(currentHead + i) & (Capacity - 1)];
+        }
+        head.store(currentHead + count, std::memory_order_release);
+        return count;
+    }
+
+    /**
+     * Returns the number of elements in the queue. Exact only when called by the producer or the consumer while
+     * the other one is idle.
+     */
+    size_t size() const {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+
+private:
+    std::array<T, Capacity> elements{};
+    // Increase forever, the index of an element is found by masking
+    std::atomic<size_t> head;
+    std::atomic<size_t> tail;
+};
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+/**
+ * A lock-free triple buffer passing values, such as frames, from one producer thread to one consumer thread.
+ * The producer always has a buffer to write to and the consumer always has the latest complete buffer to read,
+ * so neither of them ever waits for the other. Values that are not consumed in time are replaced by newer ones.
+ */
+template<typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() : backIndex{0}, middleIndex{1}, frontIndex{2} {}
+
+    /**
+     * Returns the buffer the producer writes to. Only to be used by the producer.
+     */
+    T& back() {
+        return buffers[backIndex];
+    }
+
+    /**
+     * Makes the back buffer available to the consumer and gives the producer a new back buffer.
+     * Only to be used by the producer.
+     */
+    void publish() {
+        backIndex = middleIndex.exchange(backIndex | FRESH_BIT, std::memory_order_acq_rel) & INDEX_MASK;
+    }
+
+    /**
+     * Moves the latest published buffer to the front. Only to be used by the consumer.
+     * @return true if a buffer has been published since the last update.
+     */
+    bool update() {
+        if (!(middleIndex.load(std::memory_order_relaxed) & FRESH_BIT)) {
+            return false;
+        }
+        frontIndex = middleIndex.exchange(frontIndex, std::memory_order_acq_rel) & INDEX_MASK;
+        return true;
+    }
+
+    /**
+     * Returns the buffer the consumer reads from. Only to be used by the consumer.
+     */
+    const T& front() const {
+        return buffers[frontIndex];
+    }
+
+private:
+    // The middle index is marked when it holds a buffer the consumer has not yet seen
+    static constexpr uint8_t FRESH_BIT = 0x4;
+    static constexpr uint8_t INDEX_MASK = 0x3;
+
+    std::array<T, 3> buffers{};
+    uint8_t backIndex;
+    std::atomic<uint8_t> middleIndex;
+    uint8_t frontIndex;
+};
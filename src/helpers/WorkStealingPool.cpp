@@ -0,0 +1,96 @@
+#include "WorkStealingPool.h"
+
+#include <algorithm> // max
+
+WorkStealingPool::WorkStealingPool(size_t threadCount) :
+    nextWorker{0}, queued{0}, unfinished{0}, stopping{false}
+{
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (size_t i = 0; i < threadCount; i++) {
+        workers.push_back(std::make_unique<Worker>());
+    }
+    for (size_t i = 0; i < threadCount; i++) {
+        threads.emplace_back(&WorkStealingPool::run, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    wait();
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        stopping = true;
+    }
+    taskAdded.notify_all();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+void WorkStealingPool::submit(std::function<void()> task) {
+    {
+        // Counted under the lock the threads sleep with, so none of them misses the task
+        std::lock_guard<std::mutex> lock(stateMutex);
+        queued++;
+        unfinished++;
+    }
+    Worker& worker = *workers[nextWorker];
+    nextWorker = (nextWorker + 1) % workers.size();
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.tasks.push_back(std::move(task));
+    }
+    taskAdded.notify_one();
+}
+
+void WorkStealingPool::wait() {
+    std::unique_lock<std::mutex> lock(stateMutex);
+    tasksFinished.wait(lock, [this]() { return unfinished == 0; });
+}
+
+size_t WorkStealingPool::getThreadCount() const {
+    return threads.size();
+}
+
+void WorkStealingPool::run(size_t index) {
+    std::function<void()> task;
+    while (true) {
+        if (takeTask(index, task)) {
+            task();
+            task = nullptr;
+            std::lock_guard<std::mutex> lock(stateMutex);
+            if (--unfinished == 0) {
+                tasksFinished.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(stateMutex);
+        taskAdded.wait(lock, [this]() { return stopping || queued > 0; });
+        if (stopping && queued == 0) {
+            return;
+        }
+    }
+}
+
+bool WorkStealingPool::takeTask(size_t index, std::function<void()>& task) {
+    for (size_t i = 0; i < workers.size(); i++) {
+        Worker& worker = *workers[(index + i) % workers.size()];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (worker.tasks.empty()) {
+            continue;
+        }
+        // The most recent task of its own queue, the oldest of another
+        if (i == 0) {
+            task = std::move(worker.tasks.back());
+            worker.tasks.pop_back();
+        } else {
+            task = std::move(worker.tasks.front());
+            worker.tasks.pop_front();
+        }
+        queued--;
+        return true;
+    }
+    return false;
+}
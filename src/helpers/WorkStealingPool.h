@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef> // size_t
+#include <deque>
+#include <functional>
+#include <memory> // ptr
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * A pool of threads running independent tasks.
+ * Every thread has its own queue of tasks, which tasks are handed out to in turn. A thread takes the most recent
+ * task from its own queue, and when it runs out, steals the oldest task from the queue of another thread. So tasks
+ * of very different lengths still keep every thread busy, without the threads contending for one shared queue.
+ */
+class WorkStealingPool {
+public:
+    /**
+     * Starts the threads.
+     * @param threadCount number of threads, or 0 for one per core of the host.
+     */
+    explicit WorkStealingPool(size_t threadCount = 0);
+
+    /**
+     * Waits for the tasks that have been submitted to finish, then stops the threads.
+     */
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    /**
+     * Adds a task to be run by one of the threads. Only to be called by the thread that created the pool.
+     * @param task function to run, must not throw.
+     */
+    void submit(std::function<void()> task);
+
+    /**
+     * Waits until every task that has been submitted has finished.
+     */
+    void wait();
+
+    /**
+     * Returns the number of threads running tasks.
+     */
+    size_t getThreadCount() const;
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+    size_t nextWorker;
+
+    // Tasks in the queues, and tasks submitted but not finished
+    std::atomic<size_t> queued;
+    size_t unfinished;
+    bool stopping;
+    std::mutex stateMutex;
+    std::condition_variable taskAdded;
+    std::condition_variable tasksFinished;
+
+    /**
+     * Runs tasks until the pool is stopped.
+     * @param index index of the worker owning the thread.
+     */
+    void run(size_t index);
+
+    /**
+     * Takes the most recent task of a worker, or the oldest task of another one.
+     * @param index index of the worker looking for a task.
+     * @param task set to the task taken.
+     * @return false if every queue is empty.
+     */
+    bool takeTask(size_t index, std::function<void()>& task);
+};
@@ -0,0 +1,160 @@
+#include <cstdlib> // abs
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "../src/gameboy/APU/APU.h"
+#include "../src/gameboy/SaveState.h"
+
+// One sample every 128 clock cycles
+#define APU_TEST_SAMPLE_RATE 32768
+
+/**
+ * Audio output that keeps every sample it receives.
+ */
+class SampleRecorder : public IAudioOutput {
+public:
+    std::vector<StereoSample> samples;
+
+    void writeSamples(const StereoSample* samples, size_t count) override {
+        this->samples.insert(this->samples.end(), samples, samples + count);
+    }
+
+    double getSampleRate() const override {
+        return APU_TEST_SAMPLE_RATE;
+    }
+};
+
+void powerOn(APU& apu) {
+    apu.write(NR52_ADDRESS, 0x80);
+    apu.write(NR50_ADDRESS, 0x77);
+}
+
+/**
+ * The output is delayed by half the kernel, and needs a few samples to reach the level after a step.
+ * @return whether a sample in the middle of a run of equal levels is close to the level.
+ */
+bool nearLevel(int16_t sample, int level) {
+    return std::abs(sample - level) < std::abs(level) / 4;
+}
+
+TEST(BlipBuffer, step) {
+    BlipBuffer buffer(64);
+    buffer.setRates(128, 1);
+    // Half way between the fifth and sixth sample
+    buffer.addDelta(128 * 4 + 64, 10000);
+    buffer.endFrame(128 * 32);
+    ASSERT_EQ(buffer.samplesAvailable(), 32);
+
+    std::array<int16_t, 32> samples{};
+    ASSERT_EQ(buffer.readSamples(samples.data(), samples.size()), 32);
+    ASSERT_EQ(buffer.samplesAvailable(), 0);
+    // Silent before the step, half way at its center and close to the full step after the kernel
+    ASSERT_EQ(samples[0], 0);
+    ASSERT_NEAR(samples[4], 0, 50);
+    ASSERT_NEAR(samples[4 + BLIP_KERNEL_WIDTH / 2], 5000, 500);
+    for (size_t i = 4 + BLIP_KERNEL_WIDTH; i < samples.size(); i++) {
+        ASSERT_NEAR(samples[i], 10000, 500);
+    }
+}
+
+TEST(APU, square_wave) {
+    APU apu;
+    SampleRecorder recorder;
+    powerOn(apu);
+    apu.write(NR51_ADDRESS, 0x11);
+    apu.write(NR11_ADDRESS, 0x80); // Duty 0b10000111
+    apu.write(NR12_ADDRESS, 0xF0); // Volume 15
+    // A step every 2048 clock cycles, which is 16 samples
+    apu.write(NR13_ADDRESS, 0x00);
+    apu.write(NR14_ADDRESS, 0x86);
+
+    for (int i = 0; i < 4; i++) {
+        apu.update(2048, &recorder);
+    }
+    // 4 * 2048 CPU cycles are 256 samples
+    ASSERT_EQ(recorder.samples.size(), 256);
+
+    const int high = 15 * 8 * 64;
+    bool pattern[8] = {true, false, false, false, false, true, true, true};
+    for (size_t i = BLIP_KERNEL_WIDTH; i < recorder.samples.size(); i += 16) {
+        // The middle of a step
+        size_t step = (i - BLIP_KERNEL_WIDTH / 2) / 16;
+        int expected = pattern[step % 8] ? high : -high;
+        ASSERT_TRUE(nearLevel(recorder.samples[i].left, expected)) << i;
+        ASSERT_TRUE(nearLevel(recorder.samples[i].right, expected)) << i;
+    }
+}
+
+TEST(APU, wave_and_mixing) {
+    APU apu;
+    SampleRecorder recorder;
+    powerOn(apu);
+    apu.write(NR50_ADDRESS, 0x70);
+    apu.write(NR51_ADDRESS, 0x40); // Only to the left
+    apu.write(NR30_ADDRESS, 0x80);
+    apu.write(NR32_ADDRESS, 0x20); // Full volume
+    // A step every 1024 clock cycles, which is 8 samples
+    apu.write(NR33_ADDRESS, 0x00);
+    apu.write(NR34_ADDRESS, 0x86);
+
+    apu.update(4096, &recorder);
+    ASSERT_EQ(recorder.samples.size(), 128);
+    // The wave pattern RAM starts as 0x00, 0xff, 0x00, 0xff..., so the level changes every 16 samples
+    for (size_t i = BLIP_KERNEL_WIDTH; i < recorder.samples.size(); i += 16) {
+        int expected = ((i - BLIP_KERNEL_WIDTH / 2) / 16) % 2 ? 15 * 8 * 64 : -15 * 8 * 64;
+        ASSERT_TRUE(nearLevel(recorder.samples[i].left, expected)) << i;
+    }
+    for (const StereoSample& sample : recorder.samples) {
+        ASSERT_EQ(sample.right, 0);
+    }
+
+    // Without power the output falls back to silence, apart from what the high-pass filter has not removed yet
+    recorder.samples.clear();
+    apu.write(NR52_ADDRESS, 0x00);
+    apu.update(1024, &recorder);
+    for (size_t i = BLIP_KERNEL_WIDTH; i < recorder.samples.size(); i++) {
+        ASSERT_NEAR(recorder.samples[i].left, 0, 100);
+    }
+}
+
+std::vector<uint8_t> saveState(const APU& apu) {
+    StateWriter counter(nullptr, 0);
+    apu.saveState(counter);
+    std::vector<uint8_t> state(counter.getSize());
+    StateWriter writer(state.data(), state.size());
+    apu.saveState(writer);
+    return state;
+}
+
+TEST(APU, state_without_output) {
+    APU apu;
+    APU silent;
+    SampleRecorder recorder;
+    for (APU* unit : {&apu, &silent}) {
+        powerOn(*unit);
+        unit->write(NR51_ADDRESS, 0xFF);
+        unit->write(NR12_ADDRESS, 0xF0);
+        unit->write(NR13_ADDRESS, 0x37);
+        unit->write(NR14_ADDRESS, 0x83);
+        unit->write(NR30_ADDRESS, 0x80);
+        unit->write(NR32_ADDRESS, 0x20);
+        unit->write(NR33_ADDRESS, 0x91);
+        unit->write(NR34_ADDRESS, 0x87);
+        unit->write(NR42_ADDRESS, 0xF0);
+        unit->write(NR43_ADDRESS, 0x21);
+        unit->write(NR44_ADDRESS, 0x80);
+    }
+
+    // The channels advance the same whether samples are synthesized or not
+    for (int i = 0; i < 1000; i++) {
+        uint16_t cycles = 4 + (i * 37) % 300;
+        apu.update(cycles, &recorder);
+        silent.update(cycles, nullptr);
+        if (i == 500) {
+            apu.write(NR43_ADDRESS, 0x08);
+            silent.write(NR43_ADDRESS, 0x08);
+        }
+    }
+    ASSERT_FALSE(recorder.samples.empty());
+    ASSERT_EQ(saveState(apu), saveState(silent));
+}
@@ -1,96 +1,92 @@
 #include <chrono>
 #include <thread>
+#include <algorithm>
 #include <array>
 #include <cmath>
 #include "gtest/gtest.h"
 #include "../src/application/AppSettings.h"
 #include "../src/IO/AudioController.h"
+#include "../src/gameboy/APU/APU.h"
 
-TEST(AUDIO, START_SOUND) {
-    AppSettings setting;
-    AudioController a(setting);
-    a.playGBSquare(0, 2, 0x783, 0.1f);
-    std::this_thread::sleep_for(std::chrono::milliseconds(200));
-    a.playGBSquare(0, 2, 0x7C1, 0.1f);
-    std::this_thread::sleep_for(std::chrono::milliseconds(500));
-    a.stopSound();
-}
-
-TEST(AUDIO, SAWTOOTH_WAVE) {
-    std::array<uint8_t, 16> sawTooth{};
-    for(auto i = 0; i < 16; i++) {
-        sawTooth[i] =  ((0xF - i) << 4) + (0xF - i);
+/**
+ * Streams samples for a while, as the emulation loop does.
+ */
+void streamFor(AudioController& audio, int milliseconds) {
+    for (int i = 0; i < milliseconds / 5; i++) {
+        audio.streamSamples();
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
     }
+}
 
+TEST(AUDIO, STREAM_SINE) {
     AppSettings setting;
     AudioController a(setting);
-    a.playGBWave(0, sawTooth, 0x6D6, 0.1f);
-    std::this_thread::sleep_for(std::chrono::milliseconds(500));
-    a.stopSound();
-}
-
-TEST(AUDIO, SIN_WAVE) {
-    std::array<uint8_t, 16> sine{};
-    for(auto i = 0; i < 16; i++) {
-        sine[i] =  (((uint8_t)(8 + 8 * sin(3.141592 * 2 * ((double)i*2/32)))*16) & 0xF0) +
-                ((uint8_t)(8 + 8 * sin(3.141592 * 2 * ((double)(i*2+1)/32))) & 0xF);
+    std::array<StereoSample, AUDIO_SAMPLE_RATE / 2> samples{};
+    for (size_t i = 0; i < samples.size(); i++) {
+        auto value = (int16_t)(8000 * sin(3.141592 * 2 * 440 * i / AUDIO_SAMPLE_RATE));
+        samples[i] = {value, value};
     }
 
-    AppSettings setting;
-    AudioController a(setting);
-    a.playGBWave(0, sine, 0x6D6, 0.1f);
-    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    // Written in parts small enough for the queue
+    for (size_t i = 0; i < samples.size(); i += AUDIO_BUFFER_SIZE) {
+        a.writeSamples(samples.data() + i, std::min<size_t>(AUDIO_BUFFER_SIZE, samples.size() - i));
+        a.streamSamples();
+        std::this_thread::sleep_for(std::chrono::milliseconds(AUDIO_BUFFER_SIZE * 1000 / AUDIO_SAMPLE_RATE));
+    }
+    streamFor(a, 100);
     a.stopSound();
 }
 
-TEST(AUDIO, START_SOUND_B) {
+TEST(AUDIO, APU_SQUARE) {
     AppSettings setting;
     AudioController a(setting);
-    a.playGBSquare(1, 2, 0x783, 0.1f);
-    std::this_thread::sleep_for(std::chrono::milliseconds(200));
-    a.playGBSquare(1, 2, 0x7C1, 0.1f);
-    std::this_thread::sleep_for(std::chrono::milliseconds(500));
-    a.stopSound();
-}
+    APU apu;
+    apu.write(NR52_ADDRESS, 0x80);
+    apu.write(NR50_ADDRESS, 0x77);
+    apu.write(NR51_ADDRESS, 0x11);
+    apu.write(NR11_ADDRESS, 0x80);
+    apu.write(NR12_ADDRESS, 0xF3); // Fading out
+    apu.write(NR13_ADDRESS, 0x83);
+    apu.write(NR14_ADDRESS, 0x87);
 
-TEST(AUDIO, NOISE) {
-    const auto size = 10000;
-    unsigned char samples[size];
-    uint16_t lfsr = 0x7F;
-    auto xor_res = 0;
-    auto sample = 0;
-    for(auto i = 0; i < size; i++) {
-        xor_res = (lfsr ^ (lfsr >> 1)) & 1;
-        lfsr >>= 1;
-        lfsr &= 0xFFBF;
-        lfsr |= /*(xor_res << 14) |*/ (xor_res << 6);
-        sample = lfsr & 1;
-        //std::cout << std::hex << lfsr << ";" << sample << ";" << xor_res << "\n";
-        samples[i] = sample ? 0 : (char)0xFF;
-        //std::cout << (int)samples[i] << "\n";
+    // About half a second, a frame at a time
+    for (int frame = 0; frame < 30; frame++) {
+        for (int i = 0; i < 8; i++) {
+            apu.update(2048, &a);
+        }
+        a.streamSamples();
+        std::this_thread::sleep_for(std::chrono::milliseconds(16));
     }
-
-    AppSettings setting;
-    AudioController a(setting);
-    a.playSound(3, samples, size, 10000, 0.1);
-    std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+    streamFor(a, 100);
     a.stopSound();
 }
 
-TEST(AUDIO, PLAY_NOISE) {
+TEST(AUDIO, RATE_CONTROL) {
     AppSettings setting;
     AudioController a(setting);
-    uint8_t divisors[8] = {8,16,32,48,64,80,96,112};
-    for(unsigned char divisor : divisors){
-        a.playNoise(3, 0, (262144*2)/divisor, 0.1);
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
-    }
+    ASSERT_EQ(a.getSampleRate(), AUDIO_SAMPLE_RATE);
 
-    for(unsigned char divisor : divisors){
-        a.playNoise(3, 1, (262144*2)/divisor, 0.1);
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    // More samples queued than the target, the rate goes down a little
+    std::array<StereoSample, AUDIO_BUFFER_AMOUNT * AUDIO_BUFFER_SIZE> samples{};
+    a.writeSamples(samples.data(), samples.size());
+    // Only samples queued on the device count
+    ASSERT_EQ(a.getQueuedSamples(), 0);
+    a.streamSamples();
+    ASSERT_GT(a.getQueuedSamples(), AUDIO_TARGET_SAMPLES);
+    for (int frame = 0; frame < 60; frame++) {
+        a.updateSampleRate();
     }
+    ASSERT_LT(a.getSampleRate(), AUDIO_SAMPLE_RATE);
+    ASSERT_GE(a.getSampleRate(), AUDIO_SAMPLE_RATE * (1 - AUDIO_MAX_RATE_ADJUSTMENT));
+
+    // Nothing queued, the rate goes up a little
     a.stopSound();
+    ASSERT_EQ(a.getQueuedSamples(), 0);
+    for (int frame = 0; frame < 60; frame++) {
+        a.updateSampleRate();
+    }
+    ASSERT_GT(a.getSampleRate(), AUDIO_SAMPLE_RATE);
+    ASSERT_LE(a.getSampleRate(), AUDIO_SAMPLE_RATE * (1 + AUDIO_MAX_RATE_ADJUSTMENT));
 }
 
 TEST(AUDIO, GENERATE_NOISE) {
@@ -0,0 +1,70 @@
+#include <cstdio> // remove
+#include <fstream>
+
+#include "gtest/gtest.h"
+#include "../src/headless/BatchRunner.h"
+#include "../src/gameboy/GameBoy.h"
+
+#define BATCH_TEST_ROM "../../roms/cpu_instrs/cpu_instrs.gb"
+
+TEST(BatchRunner, run){
+    BatchJob job;
+    job.romPath = BATCH_TEST_ROM;
+    job.frames = 120;
+    BatchJob withInput = job;
+    withInput.inputs = {{10, JOYPAD_START, JOYPAD_PRESS}, {20, JOYPAD_START, JOYPAD_RELEASE}};
+    BatchJob missing = job;
+    missing.romPath = "missing.gb";
+
+    BatchRunner runner(2);
+    std::vector<BatchResult> results = runner.run({job, withInput, job, missing});
+    ASSERT_EQ(results.size(), 4);
+    ASSERT_FALSE(results[3].loaded);
+
+    // The same job gives the same result on any thread, and the same as on its own
+    BatchResult expected = BatchRunner::runJob(job);
+    for (int i = 0; i < 3; i += 2) {
+        ASSERT_TRUE(results[i].loaded);
+        ASSERT_EQ(results[i].frames, 120);
+        ASSERT_EQ(results[i].frameHash, expected.frameHash);
+        ASSERT_EQ(results[i].ram, expected.ram);
+        ASSERT_EQ(results[i].serialOutput, expected.serialOutput);
+        ASSERT_EQ(results[i].cycles, expected.cycles);
+    }
+    ASSERT_EQ(expected.ram.size(), WRAM_END - WRAM_START + 1);
+    ASSERT_FALSE(expected.serialOutput.empty());
+    ASSERT_GT(expected.cycles, 0);
+    ASSERT_TRUE(results[1].loaded);
+}
+
+TEST(BatchRunner, load_jobs){
+    {
+        std::ofstream script("batch_test_input.txt");
+        script << "# Skip the title\n30 release start\n\n20 press start\n";
+        std::ofstream jobs("batch_test_jobs.txt");
+        jobs << "# rom frames input\n" << BATCH_TEST_ROM << " 60\n" << BATCH_TEST_ROM << " 90 batch_test_input.txt\n";
+        std::ofstream invalid("batch_test_invalid.txt");
+        invalid << "20 push start\n";
+    }
+
+    std::vector<BatchJob> jobs;
+    ASSERT_TRUE(BatchRunner::loadJobs("batch_test_jobs.txt", jobs));
+    ASSERT_EQ(jobs.size(), 2);
+    ASSERT_EQ(jobs[0].frames, 60);
+    ASSERT_TRUE(jobs[0].inputs.empty());
+    ASSERT_EQ(jobs[1].romPath, BATCH_TEST_ROM);
+    ASSERT_EQ(jobs[1].frames, 90);
+    // Sorted by frame
+    ASSERT_EQ(jobs[1].inputs.size(), 2);
+    ASSERT_EQ(jobs[1].inputs[0].frame, 20);
+    ASSERT_EQ(jobs[1].inputs[0].key, JOYPAD_START);
+    ASSERT_EQ(jobs[1].inputs[0].action, JOYPAD_PRESS);
+    ASSERT_EQ(jobs[1].inputs[1].action, JOYPAD_RELEASE);
+
+    std::vector<BatchInput> inputs;
+    ASSERT_FALSE(BatchRunner::loadInputScript("batch_test_invalid.txt", inputs));
+
+    std::remove("batch_test_input.txt");
+    std::remove("batch_test_jobs.txt");
+    std::remove("batch_test_invalid.txt");
+}
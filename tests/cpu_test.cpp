@@ -1,6 +1,7 @@
 #include <memory>
 #include "gtest/gtest.h"
 #include "../src/gameboy/CPU/CPU.h"
+#include "../src/gameboy/PPU/PPU.h"
 
 TEST(CPU, Execute_NOP_Instruction) {
     std::shared_ptr<MMU> mmu = std::make_shared<MMU>();
@@ -417,3 +418,77 @@ TEST(CPU, sixteen_bit_ops) {
     ASSERT_EQ(cpu->swapBits(0xF0), 0x0F);
     ASSERT_EQ(cpu->swapBits(0xAB), 0xBA);
 }
+
+TEST(CPU, idle_loop_detection) {
+    std::shared_ptr<MMU> mmu = std::make_shared<MMU>();
+    std::unique_ptr<CPU> cpu(new CPU(mmu));
+    std::shared_ptr<PPU> ppu = std::make_shared<PPU>(mmu);
+    std::shared_ptr<Cartridge> cartridge = std::make_shared<Cartridge>();
+    mmu->linkDevices(ppu, nullptr, nullptr, nullptr, cartridge);
+
+    // Disable boot ROM
+    mmu->write(0xff50, 0x01);
+
+    // LDH A, (0x44); CP 0x90; JR NZ, -6
+    uint8_t loop[] = {0xF0, 0x44, 0xFE, 0x90, 0x20, 0xFA};
+    for (int i = 0; i < 6; i++) {
+        mmu->write_GAME_ROM_ONLY_IN_TESTS(i, loop[i]);
+    }
+    cpu->setIdleLoopDetection(true);
+
+    // First iteration only arms the detection
+    for (int i = 0; i < 3; i++) {
+        cpu->update();
+    }
+    ASSERT_EQ(cpu->getIdleLoopCycles(), 0);
+
+    // Second iteration ends in the same state
+    for (int i = 0; i < 3; i++) {
+        cpu->update();
+    }
+    ASSERT_EQ(cpu->getIdleLoopCycles(), 8);
+    ASSERT_FALSE(cpu->idleLoopReadsTimer());
+
+    // Changing a register in the loop is not idle
+    mmu->write_GAME_ROM_ONLY_IN_TESTS(0x02, 0x04); // INC B
+    mmu->write_GAME_ROM_ONLY_IN_TESTS(0x03, 0x00); // NOP
+    for (int i = 0; i < 8; i++) {
+        cpu->update();
+        ASSERT_EQ(cpu->getIdleLoopCycles(), 0);
+    }
+}
+
+TEST(CPU, idle_loop_detection_in_hram) {
+    std::shared_ptr<MMU> mmu = std::make_shared<MMU>();
+    std::unique_ptr<CPU> cpu(new CPU(mmu));
+    std::shared_ptr<PPU> ppu = std::make_shared<PPU>(mmu);
+    std::shared_ptr<Cartridge> cartridge = std::make_shared<Cartridge>();
+    mmu->linkDevices(ppu, nullptr, nullptr, nullptr, cartridge);
+
+    // Disable boot ROM
+    mmu->write(0xff50, 0x01);
+
+    // LDH A, (0x44); CP 0x90; JR NZ, -6
+    uint8_t loop[] = {0xF0, 0x44, 0xFE, 0x90, 0x20, 0xFA};
+    for (int i = 0; i < 6; i++) {
+        mmu->write(0xff80 + i, loop[i]);
+    }
+    // JP 0xff80
+    mmu->write_GAME_ROM_ONLY_IN_TESTS(0x00, 0xC3);
+    mmu->write_GAME_ROM_ONLY_IN_TESTS(0x01, 0x80);
+    mmu->write_GAME_ROM_ONLY_IN_TESTS(0x02, 0xFF);
+    cpu->setIdleLoopDetection(true);
+    for (int i = 0; i < 7; i++) {
+        cpu->update();
+    }
+    ASSERT_EQ(cpu->getIdleLoopCycles(), 8);
+
+    // The rewritten loop writes to memory, and is decoded again when it is entered in another state
+    mmu->write(0xff82, 0x77); // LD (HL), A
+    mmu->write(0xff83, 0x00); // NOP
+    cpu->BC.all_16 = 0x1234;
+    for (int i = 0; i < 8; i++) {
+        cpu->update();
+        ASSERT_EQ(cpu->getIdleLoopCycles(), 0);
+    }
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <algorithm> // equal
+
+#include "../src/gameboy/GameBoy.h"
+
+/**
+ * Runs the GameBoy until it has drawn a number of frames. Never returns if no game is loaded.
+ */
+inline void runFrames(GameBoy& gb, int frames) {
+    for (int i = 0; i < frames; i++) {
+        while (!gb.isReadyToDraw()) {
+            gb.step(nullptr);
+        }
+        gb.confirmDraw();
+    }
+}
+
+/**
+ * Returns whether two GameBoys show the same screen.
+ */
+inline bool screensEqual(GameBoy& a, GameBoy& b) {
+    auto textureA = a.getScreenTexture();
+    auto textureB = b.getScreenTexture();
+    return std::equal(textureA.get(), textureA.get() + LCD_WIDTH * LCD_HEIGHT, textureB.get());
+}
@@ -0,0 +1,46 @@
+#include "gtest/gtest.h"
+#include "../src/gameboy/GameBoy.h"
+#include "../src/gameboy/FrameInput.h"
+#include "../src/gameboy/InputMovie.h"
+#include "frame_helpers.h"
+
+#define FRAME_INPUT_TEST_ROM "../../roms/cpu_instrs/cpu_instrs.gb"
+
+TEST(FrameInput, tap_within_frame) {
+    GameBoy gb;
+    gb.loadRom("", FRAME_INPUT_TEST_ROM);
+    ASSERT_TRUE(gb.isOn());
+    runFrames(gb, 50);
+
+    InputMovie movie;
+    ASSERT_TRUE(movie.startRecording(gb));
+    FrameInput input;
+    input.press(JOYPAD_B);
+    ASSERT_EQ(input.nextFrame(), 1 << JOYPAD_B);
+
+    // A and B are tapped before the frame starts, B being held down since the last frame
+    input.press(JOYPAD_A);
+    input.release(JOYPAD_A);
+    input.release(JOYPAD_B);
+    gb.setJoypadState(input.nextFrame());
+    movie.recordFrame(gb.getJoypadState());
+    ASSERT_EQ(gb.getJoypadState(), 1 << JOYPAD_A);
+    runFrames(gb, 1);
+
+    // The release of A is deferred until this frame
+    gb.setJoypadState(input.nextFrame());
+    movie.recordFrame(gb.getJoypadState());
+    ASSERT_EQ(gb.getJoypadState(), 0);
+    runFrames(gb, 1);
+    ASSERT_EQ(movie.getKeys(0), 1 << JOYPAD_A);
+    ASSERT_EQ(movie.getKeys(1), 0);
+
+    // Pressing again in the same frame cancels the deferred release
+    input.press(JOYPAD_START);
+    input.release(JOYPAD_START);
+    input.press(JOYPAD_START);
+    ASSERT_EQ(input.nextFrame(), 1 << JOYPAD_START);
+    ASSERT_EQ(input.nextFrame(), 1 << JOYPAD_START);
+    input.release(JOYPAD_START);
+    ASSERT_EQ(input.nextFrame(), 0);
+}
@@ -0,0 +1,164 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "../src/helpers/SPSCQueue.h"
+#include "../src/helpers/TripleBuffer.h"
+#include "../src/helpers/WorkStealingPool.h"
+
+TEST(SPSCQueue, push_pop) {
+    SPSCQueue<int, 4> queue;
+    int value;
+    ASSERT_FALSE(queue.pop(value));
+
+    for (int i = 0; i < 4; i++) {
+        ASSERT_TRUE(queue.push(i));
+    }
+    // Full
+    ASSERT_FALSE(queue.push(4));
+    ASSERT_EQ(queue.size(), 4);
+
+    for (int i = 0; i < 4; i++) {
+        ASSERT_TRUE(queue.pop(value));
+        ASSERT_EQ(value, i);
+    }
+    ASSERT_FALSE(queue.pop(value));
+}
+
+TEST(SPSCQueue, push_pop_many) {
+    SPSCQueue<int, 8> queue;
+    int values[10] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+    int out[10] = {};
+
+    // Only what fits is added, also when wrapping around the end of the queue
+    ASSERT_EQ(queue.push(values, 5), 5);
+    ASSERT_EQ(queue.pop(out, 3), 3);
+    ASSERT_EQ(queue.push(values + 5, 5), 5);
+    ASSERT_EQ(queue.push(values, 10), 1);
+    ASSERT_EQ(queue.size(), 8);
+
+    ASSERT_EQ(queue.pop(out, 10), 8);
+    int expected[8] = {3, 4, 5, 6, 7, 8, 9, 0};
+    for (int i = 0; i < 8; i++) {
+        ASSERT_EQ(out[i], expected[i]);
+    }
+    ASSERT_EQ(queue.pop(out, 10), 0);
+}
+
+TEST(SPSCQueue, threads) {
+    SPSCQueue<int, 16> queue;
+    const int count = 100000;
+
+    std::thread producer([&queue]() {
+        for (int i = 0; i < count; i++) {
+            while (!queue.push(i)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    // Every element should arrive once and in order
+    int expected = 0;
+    int value;
+    while (expected < count) {
+        if (queue.pop(value)) {
+            ASSERT_EQ(value, expected);
+            expected++;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+}
+
+TEST(TripleBuffer, latest_value) {
+    TripleBuffer<int> buffer;
+    ASSERT_FALSE(buffer.update());
+
+    buffer.back() = 1;
+    buffer.publish();
+    buffer.back() = 2;
+    buffer.publish();
+
+    // Only the latest published value is seen
+    ASSERT_TRUE(buffer.update());
+    ASSERT_EQ(buffer.front(), 2);
+    ASSERT_FALSE(buffer.update());
+    ASSERT_EQ(buffer.front(), 2);
+}
+
+TEST(TripleBuffer, threads) {
+    struct Frame {
+        int first;
+        int data[64];
+        int last;
+    };
+    TripleBuffer<Frame> buffer;
+    const int count = 100000;
+
+    std::thread producer([&buffer]() {
+        for (int i = 1; i <= count; i++) {
+            Frame& frame = buffer.back();
+            frame.first = i;
+            for (int& value : frame.data) {
+                value = i;
+            }
+            frame.last = i;
+            buffer.publish();
+        }
+    });
+
+    // Frames should never be torn and never go backwards
+    int previous = 0;
+    while (previous < count) {
+        if (buffer.update()) {
+            const Frame& frame = buffer.front();
+            ASSERT_EQ(frame.first, frame.last);
+            ASSERT_EQ(frame.data[32], frame.first);
+            ASSERT_GT(frame.first, previous);
+            previous = frame.first;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+}
+
+TEST(WorkStealingPool, run_all) {
+    std::atomic<int> sum{0};
+    {
+        WorkStealingPool pool(4);
+        ASSERT_EQ(pool.getThreadCount(), 4);
+        for (int i = 1; i <= 1000; i++) {
+            pool.submit([&sum, i]() { sum += i; });
+        }
+        pool.wait();
+        ASSERT_EQ(sum, 500500);
+
+        // The pool can be reused after waiting, and finishes its tasks when destroyed
+        pool.submit([&sum]() { sum += 1; });
+    }
+    ASSERT_EQ(sum, 500501);
+}
+
+TEST(WorkStealingPool, steal) {
+    WorkStealingPool pool(2);
+    std::atomic<int> finished{0};
+    std::atomic<bool> blocked{true};
+    const int count = 10;
+
+    // Blocks one of the threads until the other tasks have finished, half of which were handed to the same thread
+    pool.submit([&finished, &blocked]() {
+        auto timeout = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (finished < count && std::chrono::steady_clock::now() < timeout) {
+            std::this_thread::yield();
+        }
+        blocked = finished < count;
+    });
+    for (int i = 0; i < count; i++) {
+        pool.submit([&finished]() { finished++; });
+    }
+    pool.wait();
+    ASSERT_FALSE(blocked);
+}
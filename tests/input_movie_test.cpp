@@ -0,0 +1,129 @@
+#include <cstdio> // remove
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "../src/gameboy/GameBoy.h"
+#include "../src/gameboy/InputMovie.h"
+#include "frame_helpers.h"
+
+#define INPUT_MOVIE_TEST_ROM "../../roms/cpu_instrs/cpu_instrs.gb"
+#define INPUT_MOVIE_TEST_BOOT_ROM "../../roms/gb/boot_lameboy_big.gb"
+
+TEST(InputMovie, replay_identically) {
+    GameBoy gb;
+    gb.loadRom("", INPUT_MOVIE_TEST_ROM);
+    ASSERT_TRUE(gb.isOn());
+    runFrames(gb, 50);
+
+    InputMovie movie;
+    ASSERT_TRUE(movie.startRecording(gb));
+    for (int i = 0; i < 300; i++) {
+        // Keys change every few frames, sometimes several at once
+        gb.setJoypadState(static_cast<uint8_t>((i / 7) * 0x25));
+        movie.recordFrame(gb.getJoypadState());
+        runFrames(gb, 1);
+    }
+    ASSERT_EQ(movie.getFrameCount(), 300);
+    ASSERT_EQ(movie.getKeys(0), 0);
+    ASSERT_EQ(movie.getKeys(7), 0x25);
+    ASSERT_EQ(movie.getKeys(299), static_cast<uint8_t>(42 * 0x25));
+
+    GameBoy replay;
+    replay.loadRom("", INPUT_MOVIE_TEST_ROM);
+    ASSERT_TRUE(replay.isOn());
+    ASSERT_TRUE(movie.startReplay(replay));
+    for (size_t frame = 0; frame < movie.getFrameCount(); frame++) {
+        replay.setJoypadState(movie.getKeys(frame));
+        runFrames(replay, 1);
+    }
+    ASSERT_TRUE(screensEqual(gb, replay));
+    std::vector<uint8_t> state(gb.saveStateSize());
+    std::vector<uint8_t> replayState(state.size());
+    gb.saveState(state.data(), state.size());
+    replay.saveState(replayState.data(), replayState.size());
+    ASSERT_EQ(state, replayState);
+}
+
+TEST(InputMovie, record_after_boot) {
+    GameBoy gb;
+    gb.loadRom(INPUT_MOVIE_TEST_BOOT_ROM, INPUT_MOVIE_TEST_ROM);
+    ASSERT_TRUE(gb.isOn());
+    runFrames(gb, 10);
+    ASSERT_TRUE(gb.isBooting());
+
+    // The boot ROM is not part of the start state, so a replay without it would differ
+    InputMovie movie;
+    ASSERT_FALSE(movie.startRecording(gb));
+    for (int i = 0; gb.isBooting(); i++) {
+        ASSERT_LT(i, 1000);
+        runFrames(gb, 1);
+    }
+    ASSERT_TRUE(movie.startRecording(gb));
+    size_t serialStart = gb.getSerialOutput().size();
+    for (int i = 0; i < 300; i++) {
+        movie.recordFrame(gb.getJoypadState());
+        runFrames(gb, 1);
+    }
+
+    GameBoy replay;
+    replay.loadRom("", INPUT_MOVIE_TEST_ROM);
+    ASSERT_TRUE(replay.isOn());
+    ASSERT_FALSE(replay.isBooting());
+    ASSERT_TRUE(movie.startReplay(replay));
+    for (size_t frame = 0; frame < movie.getFrameCount(); frame++) {
+        replay.setJoypadState(movie.getKeys(frame));
+        runFrames(replay, 1);
+    }
+    ASSERT_TRUE(screensEqual(gb, replay));
+    ASSERT_EQ(gb.getSerialOutput().substr(serialStart), replay.getSerialOutput());
+    ASSERT_FALSE(replay.getSerialOutput().empty());
+    std::vector<uint8_t> state(gb.saveStateSize());
+    std::vector<uint8_t> replayState(state.size());
+    gb.saveState(state.data(), state.size());
+    replay.saveState(replayState.data(), replayState.size());
+    ASSERT_EQ(state, replayState);
+}
+
+TEST(InputMovie, save_and_load) {
+    const std::string path = "input_movie_test.movie";
+    GameBoy gb;
+    gb.loadRom("", INPUT_MOVIE_TEST_ROM);
+    ASSERT_TRUE(gb.isOn());
+    InputMovie movie;
+    ASSERT_TRUE(movie.startRecording(gb));
+    for (int i = 0; i < 1000; i++) {
+        movie.recordFrame(i < 500 ? 0 : (i < 600 ? 0x81 : 0x04));
+    }
+    ASSERT_TRUE(movie.save(path));
+
+    // Three runs of frames and the start state
+    std::ifstream file(path, std::ios::in | std::ios::binary | std::ios::ate);
+    ASSERT_LT(static_cast<size_t>(file.tellg()), gb.saveStateSize() + 64);
+    file.close();
+
+    InputMovie loaded;
+    ASSERT_TRUE(loaded.load(path));
+    ASSERT_EQ(loaded.getFrameCount(), 1000);
+    ASSERT_EQ(loaded.getRomHash(), gb.getRomHash());
+    ASSERT_NE(loaded.getRomHash(), 0);
+    for (size_t frame = 0; frame < 1000; frame++) {
+        ASSERT_EQ(loaded.getKeys(frame), movie.getKeys(frame));
+    }
+    ASSERT_TRUE(loaded.startReplay(gb));
+
+    // Truncated files are rejected and leave the movie unchanged
+    std::ofstream truncated(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    truncated << "LBMV";
+    truncated.close();
+    ASSERT_FALSE(loaded.load(path));
+    ASSERT_EQ(loaded.getFrameCount(), 1000);
+    std::remove(path.c_str());
+
+    // Movies only replay on the game they were recorded with
+    GameBoy other;
+    other.loadRom("", "../../roms/instr_timing/instr_timing.gb");
+    ASSERT_TRUE(other.isOn());
+    ASSERT_FALSE(loaded.startReplay(other));
+}
@@ -1,10 +1,15 @@
+#include <cstring>
+#include <fstream>
 #include <memory>
+#include <sstream>
 
 #include "gtest/gtest.h"
 #include "../src/gameboy/MMU/MMU.h"
 #include "../src/gameboy/Joypad.h"
 #include "../src/gameboy/MMU/Timer.h"
 
+#define ROM_IMAGE_TEST_ROM "../../roms/cpu_instrs/cpu_instrs.gb"
+
 TEST(MMU, read_write){
     std::shared_ptr<MMU> mmu = std::make_shared<MMU>();
     std::shared_ptr<Cartridge> cartridge = std::make_shared<Cartridge>();
@@ -127,3 +132,196 @@ TEST(MMU, timer){
     ASSERT_EQ(mmu->read(0xff0f), (1 << 2));
     ASSERT_EQ(mmu->read(0xff05), 0x55);
 }
+
+TEST(MMU, timer_next_event){
+    std::shared_ptr<MMU> mmu = std::make_shared<MMU>();
+    std::shared_ptr<Timer> timer = std::make_shared<Timer>(mmu);
+    mmu->linkDevices(nullptr, nullptr, nullptr, timer, nullptr);
+
+    // No overflow while the timer is not activated
+    ASSERT_EQ(timer->cyclesUntilNextEvent(), NO_SCHEDULED_EVENT);
+
+    // Activate and set timer speed to 65,536Hz, counter increases every 4 cycles
+    mmu->write(0xff07, 0b101);
+    mmu->write(0xff05, 0xfe);
+    ASSERT_EQ(timer->cyclesUntilNextEvent(), 8);
+
+    // Overflow should happen exactly after the predicted number of cycles
+    timer->update(7);
+    ASSERT_EQ(mmu->read(0xff0f) & (1 << 2), 0);
+    ASSERT_EQ(timer->cyclesUntilNextEvent(), 1);
+    timer->update(1);
+    ASSERT_EQ(mmu->read(0xff0f) & (1 << 2), (1 << 2));
+}
+
+TEST(RomImage, load_file){
+    RomImage image(0x8000);
+    ASSERT_FALSE(image.loadFile("missing.gb"));
+    ASSERT_EQ(image.size(), 0x8000);
+    ASSERT_NE(image.writableData(), nullptr);
+
+    std::ifstream file(ROM_IMAGE_TEST_ROM, std::ios::in | std::ios::binary);
+    std::vector<uint8_t> contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    ASSERT_TRUE(image.loadFile(ROM_IMAGE_TEST_ROM));
+    ASSERT_EQ(image.size(), contents.size());
+    ASSERT_EQ(std::memcmp(image.data(), contents.data(), contents.size()), 0);
+#ifndef _WIN32
+    // Mapped from the file, not copied
+    ASSERT_TRUE(image.isMapped());
+    ASSERT_EQ(image.writableData(), nullptr);
+#endif
+
+    // A larger ROM size is copied, with the file at the end
+    size_t size = contents.size();
+    ASSERT_TRUE(image.resize(2 * size));
+    ASSERT_FALSE(image.isMapped());
+    ASSERT_EQ(image.data()[0], 0);
+    ASSERT_EQ(std::memcmp(image.data() + size, contents.data(), size), 0);
+    ASSERT_FALSE(image.resize(size));
+}
+
+TEST(RomImage, share){
+    size_t sharedBefore = RomImage::sharedCount();
+    {
+        Cartridge first;
+        Cartridge second;
+        ASSERT_TRUE(first.loadRom(ROM_IMAGE_TEST_ROM));
+        ASSERT_TRUE(second.loadRom(ROM_IMAGE_TEST_ROM));
+        // Both run on one copy of the ROM, but keep their own xRAM
+        ASSERT_EQ(first.romBank0(), second.romBank0());
+        ASSERT_EQ(RomImage::sharedCount(), sharedBefore + 1);
+        first.write(0x0000, 0x0a);
+        second.write(0x0000, 0x0a);
+        ASSERT_NE(first.ramBank(), second.ramBank());
+    }
+    // Released with the last cartridge using it
+    ASSERT_EQ(RomImage::sharedCount(), sharedBefore);
+
+    // Images are shared by contents, not by file
+    auto image = std::make_unique<RomImage>(0x8000);
+    image->writableData()[0x100] = 0x42;
+    auto other = std::make_unique<RomImage>(0x8000);
+    other->writableData()[0x100] = 0x42;
+    auto different = std::make_unique<RomImage>(0x8000);
+    std::shared_ptr<const RomImage> shared = RomImage::share(std::move(image));
+    ASSERT_EQ(RomImage::share(std::move(other)), shared);
+    ASSERT_NE(RomImage::share(std::move(different)), shared);
+}
+
+TEST(MBC1, banks){
+    // Eight ROM banks, each starting with its bank number
+    std::vector<uint8_t> rom(0x20000);
+    for (int bank = 0; bank < 8; bank++) {
+        rom[bank * 0x4000] = bank;
+    }
+    std::vector<uint8_t> ram(0x8000);
+    MBC1_MBC mbc(rom.data(), rom.size(), &ram);
+
+    ASSERT_EQ(mbc.romBank0(), rom.data());
+    ASSERT_EQ(mbc.read(0x4000), 1);
+    mbc.write(0x2000, 0x03);
+    ASSERT_EQ(mbc.romBankN(), rom.data() + 3 * 0x4000);
+    ASSERT_EQ(mbc.read(0x4000), 3);
+    // Bank 0 selects bank 1, banks past the end of the ROM wrap around
+    mbc.write(0x2000, 0x00);
+    ASSERT_EQ(mbc.read(0x4000), 1);
+    mbc.write(0x2000, 0x0d);
+    ASSERT_EQ(mbc.read(0x4000), 5);
+
+    // xRAM is only mapped while enabled, and banked in RAM Banking Mode
+    ASSERT_EQ(mbc.ramBank(), nullptr);
+    mbc.write(0x0000, 0x0a);
+    ASSERT_EQ(mbc.ramBank(), ram.data());
+    mbc.write(0x6000, 0x01);
+    mbc.write(0x4000, 0x02);
+    ASSERT_EQ(mbc.ramBank(), ram.data() + 2 * 0x2000);
+    mbc.write(0xa010, 0x42);
+    ASSERT_EQ(ram[2 * 0x2000 + 0x10], 0x42);
+    mbc.write(0x0000, 0x00);
+    ASSERT_EQ(mbc.ramBank(), nullptr);
+}
+
+/**
+ * Latches the RTC and reads its registers as seconds, minutes, hours and days.
+ */
+std::array<int, 4> readRtc(MBC3_MBC& mbc) {
+    mbc.write(0x6000, 0x00);
+    mbc.write(0x6000, 0x01);
+    std::array<int, 4> time{};
+    for (int i = 0; i < 3; i++) {
+        mbc.write(0x4000, 0x08 + i);
+        time[i] = mbc.read(0xa000);
+    }
+    mbc.write(0x4000, 0x0b);
+    time[3] = mbc.read(0xa000);
+    mbc.write(0x4000, 0x0c);
+    time[3] |= (mbc.read(0xa000) & 1) << 8;
+    return time;
+}
+
+TEST(MBC3, rtc){
+    std::vector<uint8_t> rom(0x8000);
+    std::vector<uint8_t> ram(0x2000);
+    uint64_t cycles = 0;
+    MBC3_MBC mbc(rom.data(), rom.size(), &ram, &cycles, true);
+    // Enable RAM and RTC
+    mbc.write(0x0000, 0x0a);
+
+    // The time is only computed when latched
+    cycles = (uint64_t)RTC_CYCLES_PER_SECOND * (2 * 86400 + 3 * 3600 + 4 * 60 + 5) + RTC_CYCLES_PER_SECOND / 2;
+    ASSERT_EQ(readRtc(mbc), (std::array<int, 4>{5, 4, 3, 2}));
+    // Half a second was left over
+    cycles += RTC_CYCLES_PER_SECOND / 2;
+    ASSERT_EQ(readRtc(mbc), (std::array<int, 4>{6, 4, 3, 2}));
+
+    // Halted, the time stands still
+    mbc.write(0x4000, 0x0c);
+    mbc.write(0xa000, 0x40);
+    cycles += RTC_CYCLES_PER_SECOND * 10;
+    ASSERT_EQ(readRtc(mbc), (std::array<int, 4>{6, 4, 3, 2}));
+
+    // Seconds set out of range wrap around at 64 without counting a minute
+    mbc.write(0x4000, 0x08);
+    mbc.write(0xa000, 62);
+    mbc.write(0x4000, 0x0c);
+    mbc.write(0xa000, 0x00);
+    cycles += RTC_CYCLES_PER_SECOND * 3;
+    ASSERT_EQ(readRtc(mbc), (std::array<int, 4>{1, 4, 3, 2}));
+}
+
+TEST(MBC3, rtc_save){
+    std::vector<uint8_t> rom(0x8000);
+    std::vector<uint8_t> ram(0x2000);
+    uint64_t cycles = 0;
+    MBC3_MBC mbc(rom.data(), rom.size(), &ram, &cycles, true);
+    mbc.write(0x0000, 0x0a);
+    cycles = (uint64_t)RTC_CYCLES_PER_SECOND * 30;
+
+    std::stringstream file;
+    mbc.saveRtc(file);
+    std::string saved = file.str();
+    ASSERT_EQ(saved.size(), RTC_SAVE_SIZE);
+
+    // Saved an hour ago, the time the emulator was closed is added when loaded
+    std::stringstream timestamp;
+    file.seekg(RTC_SAVE_SIZE - 8);
+    MBC::writeLittleEndian(timestamp, MBC::readLittleEndian(file, 8) - 3600, 8);
+    std::stringstream earlier(saved.substr(0, RTC_SAVE_SIZE - 8) + timestamp.str());
+
+    uint64_t otherCycles = 0;
+    MBC3_MBC other(rom.data(), rom.size(), &ram, &otherCycles, true);
+    other.write(0x0000, 0x0a);
+    file.seekg(0);
+    other.loadRtc(file, RTC_SAVE_SIZE);
+    std::array<int, 4> time = readRtc(other);
+    // The clock of the host may have moved on a second
+    ASSERT_GE(time[0], 30);
+    ASSERT_LE(time[0], 31);
+    ASSERT_EQ(time[1], 0);
+
+    other.loadRtc(earlier, RTC_SAVE_SIZE);
+    time = readRtc(other);
+    ASSERT_GE(time[0], 30);
+    ASSERT_LE(time[0], 31);
+    ASSERT_EQ(time[2], 1);
+}
@@ -5,6 +5,10 @@
 #include <array>
 #include <cstring>
 #include <memory>
+#include <vector>
+#include "frame_helpers.h"
+
+#define RENDER_SKIPPING_TEST_ROM "../../roms/cpu_instrs/cpu_instrs.gb"
 
 
 std::array<char, 64> getWhiteTile() {
@@ -480,3 +484,101 @@ TEST(PPU, g_tile_rom) {
     bufferFrame(gb.ppu);
     printScreen((std::shared_ptr<PPU> &) gb.ppu);
 }
+
+TEST(PPU, tile_cache) {
+    std::shared_ptr<MMU> mmu = std::make_shared<MMU>();
+    TileCache& tileCache = mmu->getTileCache();
+
+    // Row 3 of tile 1: pixel 0 has color 3, pixel 1 color 1, pixel 7 color 2
+    mmu->write(TILE_DATA_START + TILE_DATA_SIZE + 3 * 2, 0b11000000);
+    mmu->write(TILE_DATA_START + TILE_DATA_SIZE + 3 * 2 + 1, 0b10000001);
+    const uint8_t* row = tileCache.getRow(1, 3);
+    ASSERT_EQ(row[0], 3);
+    ASSERT_EQ(row[1], 1);
+    ASSERT_EQ(row[2], 0);
+    ASSERT_EQ(row[7], 2);
+
+    // Writing VRAM updates the decoded tile
+    mmu->write(TILE_DATA_START + TILE_DATA_SIZE + 3 * 2 + 1, 0x00);
+    row = tileCache.getRow(1, 3);
+    ASSERT_EQ(row[0], 1);
+    ASSERT_EQ(row[7], 0);
+
+    // The last tile is at the end of the signed tile set
+    mmu->write(TILE_DATA_END, 0xff);
+    ASSERT_EQ(tileCache.getRow(TILE_AMOUNT - 1, 7)[4], 2);
+
+    // Loading a state updates the decoded tiles it changes
+    StateWriter counter(nullptr, 0);
+    mmu->saveState(counter);
+    std::vector<uint8_t> state(counter.getSize());
+    StateWriter writer(state.data(), state.size());
+    mmu->saveState(writer);
+    mmu->write(TILE_DATA_START + TILE_DATA_SIZE + 3 * 2, 0x00);
+    ASSERT_EQ(tileCache.getRow(1, 3)[0], 0);
+    StateReader reader(state.data(), state.size());
+    mmu->loadState(reader);
+    ASSERT_EQ(tileCache.getRow(1, 3)[0], 1);
+    ASSERT_EQ(tileCache.getRow(TILE_AMOUNT - 1, 7)[4], 2);
+}
+
+TEST(PPU, sprite_table) {
+    std::shared_ptr<MMU> mmu = std::make_shared<MMU>();
+    const SpriteTable& spriteTable = mmu->getSpriteTable();
+
+    // Sprite 0 at x 20, sprite 1 and 2 at x 10 and sprite 3 above the line, all written through OAM
+    uint8_t sprites[4][4] = {{16, 28, 5, SPRITE_X_FLIP_BIT}, {12, 18, 6, 0}, {19, 18, 7, 0}, {40, 0, 8, 0}};
+    for (uint8_t sprite = 0; sprite < 4; sprite++) {
+        for (uint8_t byte = 0; byte < 4; byte++) {
+            mmu->write(OAM_START + sprite * 4 + byte, sprites[sprite][byte]);
+        }
+    }
+    ASSERT_EQ(spriteTable.getX(0), 20);
+    ASSERT_EQ(spriteTable.getY(1), -4);
+    ASSERT_EQ(spriteTable.getTileID(2), 7);
+    ASSERT_EQ(spriteTable.getFlags(0), SPRITE_X_FLIP_BIT);
+
+    // The lowest x has priority, then the first in OAM
+    std::array<uint8_t, SPRITES_PER_LINE> selected{};
+    ASSERT_EQ(spriteTable.selectLine(3, 8, selected), 3);
+    ASSERT_EQ(selected[0], 1);
+    ASSERT_EQ(selected[1], 2);
+    ASSERT_EQ(selected[2], 0);
+
+    // Only the ten first sprites in OAM on a line are selected
+    for (uint8_t sprite = 0; sprite < SPRITE_AMOUNT; sprite++) {
+        mmu->write(OAM_START + sprite * 4, 16);
+        mmu->write(OAM_START + sprite * 4 + 1, SPRITE_AMOUNT - sprite);
+    }
+    ASSERT_EQ(spriteTable.selectLine(0, 16, selected), SPRITES_PER_LINE);
+    ASSERT_EQ(selected[0], SPRITES_PER_LINE - 1);
+    ASSERT_EQ(selected[SPRITES_PER_LINE - 1], 0);
+    ASSERT_EQ(spriteTable.selectLine(8, 8, selected), 0);
+}
+
+TEST(GameBoy, render_skipping) {
+    GameBoy gb;
+    gb.loadRom("", RENDER_SKIPPING_TEST_ROM);
+    ASSERT_TRUE(gb.isOn());
+    GameBoy reference;
+    reference.loadRom("", RENDER_SKIPPING_TEST_ROM);
+    ASSERT_TRUE(reference.isOn());
+    runFrames(gb, 100);
+    runFrames(reference, 100);
+
+    // Skipped frames are not drawn
+    gb.setRenderSkipping(true);
+    runFrames(gb, 200);
+    runFrames(reference, 200);
+    ASSERT_FALSE(screensEqual(gb, reference));
+
+    // But the emulation is the same, so the next frame drawn is too
+    gb.setRenderSkipping(false);
+    runFrames(gb, 1);
+    runFrames(reference, 1);
+    std::vector<uint8_t> state(gb.saveStateSize());
+    std::vector<uint8_t> referenceState(state.size());
+    gb.saveState(state.data(), state.size());
+    reference.saveState(referenceState.data(), referenceState.size());
+    ASSERT_EQ(state, referenceState);
+}
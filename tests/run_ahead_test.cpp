@@ -0,0 +1,46 @@
+#include <algorithm> // equal
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "../src/gameboy/GameBoy.h"
+#include "../src/gameboy/RunAhead.h"
+#include "frame_helpers.h"
+
+#define RUN_AHEAD_TEST_ROM "../../roms/cpu_instrs/cpu_instrs.gb"
+
+TEST(RunAhead, shows_future_frame) {
+    GameBoy gb;
+    gb.loadRom("", RUN_AHEAD_TEST_ROM);
+    ASSERT_TRUE(gb.isOn());
+    GameBoy reference;
+    reference.loadRom("", RUN_AHEAD_TEST_ROM);
+    ASSERT_TRUE(reference.isOn());
+    // The test ROM is about to print a result, to the screen and the serial port
+    runFrames(gb, 155);
+    runFrames(reference, 155);
+
+    std::vector<uint8_t> state(gb.saveStateSize());
+    gb.saveState(state.data(), state.size());
+    std::string serialOutput = gb.getSerialOutput();
+
+    RunAhead runAhead;
+    std::vector<uint8_t> frame(LCD_WIDTH * LCD_HEIGHT);
+    ASSERT_TRUE(runAhead.run(gb, 3, frame.data()));
+
+    // The frame displayed is the one three frames ahead
+    runFrames(reference, 2);
+    ASSERT_FALSE(std::equal(frame.begin(), frame.end(), reference.getFrameBuffer()));
+    runFrames(reference, 1);
+    ASSERT_TRUE(std::equal(frame.begin(), frame.end(), reference.getFrameBuffer()));
+    ASSERT_GT(reference.getSerialOutput().size(), serialOutput.size());
+
+    // While the emulation is where it was
+    std::vector<uint8_t> stateAfter(state.size());
+    gb.saveState(stateAfter.data(), stateAfter.size());
+    ASSERT_EQ(stateAfter, state);
+    ASSERT_EQ(gb.getSerialOutput(), serialOutput);
+    runFrames(gb, 3);
+    ASSERT_TRUE(screensEqual(gb, reference));
+    ASSERT_EQ(gb.getSerialOutput(), reference.getSerialOutput());
+}
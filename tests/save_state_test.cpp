@@ -0,0 +1,128 @@
+#include <memory>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "../src/gameboy/GameBoy.h"
+#include "../src/gameboy/RewindBuffer.h"
+#include "frame_helpers.h"
+
+#define SAVE_STATE_TEST_ROM "../../roms/cpu_instrs/cpu_instrs.gb"
+
+TEST(SaveState, restore_continues_identically) {
+    GameBoy gb;
+    gb.loadRom("", SAVE_STATE_TEST_ROM);
+    ASSERT_TRUE(gb.isOn());
+    runFrames(gb, 100);
+
+    std::vector<uint8_t> state(gb.saveStateSize());
+    ASSERT_EQ(gb.saveState(state.data(), state.size()), state.size());
+
+    // Run ahead and remember the result
+    runFrames(gb, 200);
+    GameBoy reference;
+    reference.loadRom("", SAVE_STATE_TEST_ROM);
+    ASSERT_TRUE(reference.isOn());
+    ASSERT_TRUE(reference.loadState(state.data(), state.size()));
+    runFrames(reference, 200);
+    ASSERT_TRUE(screensEqual(gb, reference));
+
+    // Every unit should be in the same state
+    std::vector<uint8_t> stateAfter(state.size());
+    std::vector<uint8_t> referenceStateAfter(state.size());
+    gb.saveState(stateAfter.data(), stateAfter.size());
+    reference.saveState(referenceStateAfter.data(), referenceStateAfter.size());
+    ASSERT_EQ(stateAfter, referenceStateAfter);
+    ASSERT_NE(stateAfter, state);
+
+    // Restoring into the same emulator gives the same result again
+    ASSERT_TRUE(gb.loadState(state.data(), state.size()));
+    runFrames(gb, 200);
+    ASSERT_TRUE(screensEqual(gb, reference));
+}
+
+TEST(SaveState, reject_invalid) {
+    GameBoy gb;
+    gb.loadRom("", SAVE_STATE_TEST_ROM);
+    ASSERT_TRUE(gb.isOn());
+    std::vector<uint8_t> state(gb.saveStateSize());
+
+    // Too small buffer
+    ASSERT_EQ(gb.saveState(state.data(), state.size() - 1), 0);
+
+    ASSERT_EQ(gb.saveState(state.data(), state.size()), state.size());
+    ASSERT_FALSE(gb.loadState(state.data(), state.size() - 1));
+
+    // Wrong magic number
+    state[0] ^= 0xff;
+    ASSERT_FALSE(gb.loadState(state.data(), state.size()));
+    state[0] ^= 0xff;
+    ASSERT_TRUE(gb.loadState(state.data(), state.size()));
+
+    // No game loaded
+    GameBoy off;
+    ASSERT_FALSE(off.loadState(state.data(), state.size()));
+}
+
+TEST(SaveState, rewind) {
+    GameBoy gb;
+    gb.loadRom("", SAVE_STATE_TEST_ROM);
+    ASSERT_TRUE(gb.isOn());
+    RewindBuffer rewindBuffer(4 * 1024 * 1024, 10);
+    size_t stateSize = gb.saveStateSize();
+
+    // Record 25 frames and remember the exact state of the 13th
+    std::vector<uint8_t> expected(stateSize);
+    for (int i = 0; i < 25; i++) {
+        runFrames(gb, 1);
+        ASSERT_TRUE(rewindBuffer.record(gb));
+        if (i == 12) {
+            gb.saveState(expected.data(), expected.size());
+        }
+    }
+    ASSERT_EQ(rewindBuffer.getSnapshotCount(), 25);
+    // Snapshots that are not keyframes should be a lot smaller than the state
+    ASSERT_LT(rewindBuffer.getUsedBytes(), 3 * stateSize + 22 * stateSize / 4);
+
+    // The 13th snapshot is restored by the 13th step back
+    for (int i = 0; i < 13; i++) {
+        ASSERT_TRUE(rewindBuffer.stepBack(gb));
+    }
+    std::vector<uint8_t> actual(stateSize);
+    gb.saveState(actual.data(), actual.size());
+    ASSERT_EQ(actual, expected);
+
+    // Recording continues from the restored snapshot
+    ASSERT_TRUE(rewindBuffer.record(gb));
+    ASSERT_TRUE(rewindBuffer.stepBack(gb));
+    gb.saveState(actual.data(), actual.size());
+    ASSERT_EQ(actual, expected);
+
+    while (rewindBuffer.stepBack(gb));
+    ASSERT_EQ(rewindBuffer.getSnapshotCount(), 0);
+}
+
+TEST(SaveState, rewind_full_buffer) {
+    GameBoy gb;
+    gb.loadRom("", SAVE_STATE_TEST_ROM);
+    ASSERT_TRUE(gb.isOn());
+    // Only room for a few keyframes
+    size_t capacity = gb.saveStateSize() * 2;
+    RewindBuffer rewindBuffer(capacity, 5);
+
+    std::vector<uint8_t> expected(gb.saveStateSize());
+    for (int i = 0; i < 200; i++) {
+        runFrames(gb, 1);
+        ASSERT_TRUE(rewindBuffer.record(gb));
+        ASSERT_LE(rewindBuffer.getUsedBytes(), capacity);
+    }
+    gb.saveState(expected.data(), expected.size());
+
+    // Old snapshots have been dropped, the newest ones are still correct
+    ASSERT_LT(rewindBuffer.getSnapshotCount(), 200);
+    runFrames(gb, 10);
+    ASSERT_TRUE(rewindBuffer.stepBack(gb));
+    std::vector<uint8_t> actual(expected.size());
+    gb.saveState(actual.data(), actual.size());
+    ASSERT_EQ(actual, expected);
+    while (rewindBuffer.stepBack(gb));
+}